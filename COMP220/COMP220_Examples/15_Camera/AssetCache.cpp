@@ -0,0 +1,149 @@
+#include "AssetCache.h"
+
+//Frees the GPU objects owned by a mesh group
+static void destroyMeshGroup(MeshGroup * pMeshes)
+{
+	for (Mesh * pMesh : *pMeshes)
+	{
+		delete pMesh;
+	}
+	delete pMeshes;
+}
+
+void computeMeshGroupBounds(const MeshGroup * pMeshes, AABB & box, BoundingSphere & sphere)
+{
+	if (pMeshes == nullptr || pMeshes->empty())
+	{
+		box = { glm::vec3(0.0f), glm::vec3(0.0f) };
+		sphere = { glm::vec3(0.0f), 0.0f };
+		return;
+	}
+
+	box = (*pMeshes)[0]->getBoundingBox();
+	for (Mesh * pMesh : *pMeshes)
+	{
+		box = mergeBounds(box, pMesh->getBoundingBox());
+	}
+
+	sphere.centre = (box.min + box.max) * 0.5f;
+	sphere.radius = 0.0f;
+	for (Mesh * pMesh : *pMeshes)
+	{
+		const BoundingSphere& meshSphere = pMesh->getBoundingSphere();
+		float reach = glm::distance(sphere.centre, meshSphere.centre) + meshSphere.radius;
+		sphere.radius = glm::max(sphere.radius, reach);
+	}
+}
+
+AssetCache & AssetCache::get()
+{
+	static AssetCache instance;
+	return instance;
+}
+
+AssetCache::AssetCache()
+{
+}
+
+AssetCache::~AssetCache()
+{
+}
+
+MeshGroup * AssetCache::acquireMeshes(const std::string & filename)
+{
+	auto iter = m_Meshes.find(filename);
+	if (iter != m_Meshes.end())
+	{
+		iter->second.refCount++;
+		return iter->second.asset;
+	}
+
+	MeshGroup * pMeshes = new MeshGroup();
+	if (!loadMeshFromFile(filename, *pMeshes))
+	{
+		destroyMeshGroup(pMeshes);
+		return nullptr;
+	}
+
+	m_Meshes[filename] = { pMeshes, 1 };
+	return pMeshes;
+}
+
+GLuint AssetCache::acquireTexture(const std::string & filename)
+{
+	auto iter = m_Textures.find(filename);
+	if (iter != m_Textures.end())
+	{
+		iter->second.refCount++;
+		return iter->second.asset;
+	}
+
+	//Returns straight away with a placeholder, the pixels are filled in once the image has been decoded
+	GLuint textureID = AsyncTextureLoader::get().load(filename);
+	if (textureID == 0)
+	{
+		return 0;
+	}
+
+	m_Textures[filename] = { textureID, 1 };
+	return textureID;
+}
+
+ShaderProgram * AssetCache::acquireShaderProgram(const std::string & vertexShaderFilename, const std::string & fragmentShaderFilename)
+{
+	return ShaderLibrary::get().acquire(vertexShaderFilename, fragmentShaderFilename);
+}
+
+void AssetCache::releaseMeshes(MeshGroup * pMeshes)
+{
+	for (auto iter = m_Meshes.begin(); iter != m_Meshes.end(); iter++)
+	{
+		if (iter->second.asset == pMeshes)
+		{
+			if (--iter->second.refCount == 0)
+			{
+				destroyMeshGroup(pMeshes);
+				m_Meshes.erase(iter);
+			}
+			return;
+		}
+	}
+}
+
+void AssetCache::releaseTexture(GLuint textureID)
+{
+	for (auto iter = m_Textures.begin(); iter != m_Textures.end(); iter++)
+	{
+		if (iter->second.asset == textureID)
+		{
+			if (--iter->second.refCount == 0)
+			{
+				AsyncTextureLoader::get().cancel(textureID);
+				glDeleteTextures(1, &textureID);
+				m_Textures.erase(iter);
+			}
+			return;
+		}
+	}
+}
+
+void AssetCache::releaseShaderProgram(ShaderProgram * pProgram)
+{
+	ShaderLibrary::get().release(pProgram);
+}
+
+void AssetCache::clear()
+{
+	for (auto& meshes : m_Meshes)
+	{
+		destroyMeshGroup(meshes.second.asset);
+	}
+	m_Meshes.clear();
+
+	for (auto& texture : m_Textures)
+	{
+		AsyncTextureLoader::get().cancel(texture.second.asset);
+		glDeleteTextures(1, &texture.second.asset);
+	}
+	m_Textures.clear();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include "Mesh.h"
+#include "Model.h"
+#include "Texture.h"
+#include "AsyncTextureLoader.h"
+#include "ShaderLibrary.h"
+
+//All the meshes loaded from one model file
+typedef std::vector<Mesh*> MeshGroup;
+
+//Merges the bounds of every mesh in the group, the sphere is centred on the box. Empty groups get zero sized bounds
+void computeMeshGroupBounds(const MeshGroup * pMeshes, AABB& box, BoundingSphere& sphere);
+
+//Reference counted store of meshes, textures and shader programs keyed by their file names.
+//Loading the same file twice hands back the same GPU objects, which are only freed when the last user releases them.
+//Shader programs are passed through to the ShaderLibrary, which shares them by source rather than file name
+class AssetCache
+{
+public:
+	static AssetCache& get();
+
+	MeshGroup * acquireMeshes(const std::string& filename);
+	GLuint acquireTexture(const std::string& filename);
+	ShaderProgram * acquireShaderProgram(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename);
+
+	void releaseMeshes(MeshGroup * pMeshes);
+	void releaseTexture(GLuint textureID);
+	void releaseShaderProgram(ShaderProgram * pProgram);
+
+	//Frees anything still held, called once at shutdown
+	void clear();
+
+private:
+	AssetCache();
+	~AssetCache();
+
+	template<typename T>
+	struct Entry
+	{
+		T asset;
+		int refCount;
+	};
+
+	std::map<std::string, Entry<MeshGroup*>> m_Meshes;
+	std::map<std::string, Entry<GLuint>> m_Textures;
+};
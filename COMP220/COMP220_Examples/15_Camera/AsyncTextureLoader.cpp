@@ -0,0 +1,371 @@
+#include "AsyncTextureLoader.h"
+#include "Texture.h"
+#include "Profiler.h"
+
+#include <cstring>
+
+//Mid grey shown until the real pixels arrive
+static const unsigned char placeholderPixel[4] = { 128, 128, 128, 255 };
+
+AsyncTextureLoader & AsyncTextureLoader::get()
+{
+	static AsyncTextureLoader instance;
+	return instance;
+}
+
+AsyncTextureLoader::AsyncTextureLoader()
+{
+	m_Initialised = false;
+	m_PersistentMapping = false;
+	m_CompressedTextures = false;
+	m_Quit = false;
+	m_StagingBuffer = 0;
+	m_pStagingMemory = nullptr;
+	m_StagingHead = 0;
+}
+
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+}
+
+void AsyncTextureLoader::init()
+{
+	glGenBuffers(1, &m_StagingBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+
+	//With buffer storage the staging ring stays mapped for its whole life, otherwise each upload maps just its own range
+	m_PersistentMapping = GLEW_ARB_buffer_storage != 0;
+	if (m_PersistentMapping)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, TEXTURE_STAGING_BUFFER_SIZE, NULL, flags);
+		m_pStagingMemory = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, TEXTURE_STAGING_BUFFER_SIZE, flags);
+		if (m_pStagingMemory == nullptr)
+		{
+			printf("Unable to persistently map texture staging buffer, falling back to mapping each upload\n");
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(1, &m_StagingBuffer);
+			glGenBuffers(1, &m_StagingBuffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+			m_PersistentMapping = false;
+		}
+	}
+	if (!m_PersistentMapping)
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, TEXTURE_STAGING_BUFFER_SIZE, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	m_StagingHead = 0;
+
+	m_CompressedTextures = GLEW_EXT_texture_compression_s3tc != 0;
+
+	m_Quit = false;
+	for (int i = 0; i < TEXTURE_DECODE_THREADS; i++)
+	{
+		m_Threads.push_back(std::thread(&AsyncTextureLoader::decodeThread, this));
+	}
+	m_Initialised = true;
+}
+
+void AsyncTextureLoader::destroy()
+{
+	if (!m_Initialised)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_JobAvailable.notify_all();
+	for (std::thread& thread : m_Threads)
+	{
+		thread.join();
+	}
+	m_Threads.clear();
+
+	//Every job is in one of the queues once the threads have stopped
+	for (Job * pJob : m_DecodeQueue)
+	{
+		delete pJob;
+	}
+	m_DecodeQueue.clear();
+	for (Job * pJob : m_UploadQueue)
+	{
+		delete pJob;
+	}
+	m_UploadQueue.clear();
+	m_Pending.clear();
+
+	for (StagingRegion& region : m_StagingRegions)
+	{
+		glDeleteSync(region.fence);
+	}
+	m_StagingRegions.clear();
+
+	if (m_PersistentMapping)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		m_pStagingMemory = nullptr;
+	}
+	glDeleteBuffers(1, &m_StagingBuffer);
+	m_StagingBuffer = 0;
+
+	m_Initialised = false;
+}
+
+GLuint AsyncTextureLoader::load(const std::string & filename)
+{
+	if (!m_Initialised)
+	{
+		return loadTextureFromFile(filename);
+	}
+
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	Job * pJob = new Job();
+	pJob->filename = filename;
+	pJob->textureID = textureID;
+	pJob->cancelled = false;
+	pJob->failed = false;
+	pJob->width = 0;
+	pJob->height = 0;
+	pJob->requestTime = SDL_GetPerformanceCounter();
+	pJob->decodeMilliseconds = 0.0;
+	m_Pending[textureID] = pJob;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_DecodeQueue.push_back(pJob);
+	}
+	m_JobAvailable.notify_one();
+	return textureID;
+}
+
+void AsyncTextureLoader::cancel(GLuint textureID)
+{
+	auto iter = m_Pending.find(textureID);
+	if (iter != m_Pending.end())
+	{
+		iter->second->cancelled = true;
+		m_Pending.erase(iter);
+	}
+}
+
+void AsyncTextureLoader::update()
+{
+	if (!m_Initialised)
+	{
+		return;
+	}
+
+	//Retire the staging ranges the GPU has finished with so the ring doesn't have to wait on them later
+	while (!m_StagingRegions.empty())
+	{
+		GLenum result = glClientWaitSync(m_StagingRegions.front().fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+		{
+			break;
+		}
+		glDeleteSync(m_StagingRegions.front().fence);
+		m_StagingRegions.pop_front();
+	}
+
+	GLsizeiptr uploadedBytes = 0;
+	while (true)
+	{
+		Job * pJob = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_UploadQueue.empty())
+			{
+				break;
+			}
+
+			GLsizeiptr size = (GLsizeiptr)m_UploadQueue.front()->getUploadData().size();
+			if (uploadedBytes > 0 && uploadedBytes + size > TEXTURE_UPLOAD_BUDGET)
+			{
+				break;
+			}
+			pJob = m_UploadQueue.front();
+			m_UploadQueue.pop_front();
+		}
+
+		//A cancelled texture may have been deleted and its name handed out again, so only this job's own entry is removed
+		auto iter = m_Pending.find(pJob->textureID);
+		if (iter != m_Pending.end() && iter->second == pJob)
+		{
+			m_Pending.erase(iter);
+		}
+
+		if (pJob->failed)
+		{
+			printf("Could not load texture %s, keeping the placeholder\n", pJob->filename.c_str());
+		}
+		else if (!pJob->cancelled)
+		{
+			upload(pJob);
+			uploadedBytes += (GLsizeiptr)pJob->getUploadData().size();
+		}
+		delete pJob;
+	}
+}
+
+unsigned int AsyncTextureLoader::getPendingCount()
+{
+	return (unsigned int)m_Pending.size();
+}
+
+//Only touches the job it took off the queue, so no locking is needed while decoding
+void AsyncTextureLoader::decodeThread()
+{
+	Profiler::get().setThreadName("Texture decode");
+	while (true)
+	{
+		Job * pJob = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobAvailable.wait(lock, [this]()
+			{
+				return m_Quit || !m_DecodeQueue.empty();
+			});
+			if (m_Quit)
+			{
+				return;
+			}
+			pJob = m_DecodeQueue.front();
+			m_DecodeQueue.pop_front();
+		}
+
+		Uint64 decodeStart = SDL_GetPerformanceCounter();
+		bool decodeZone = Profiler::get().beginZone("Decode texture");
+
+		if (m_CompressedTextures)
+		{
+			pJob->failed = !loadCompressedTexture(pJob->filename, pJob->compressed);
+			if (!pJob->failed)
+			{
+				pJob->width = pJob->compressed.levels[0].width;
+				pJob->height = pJob->compressed.levels[0].height;
+			}
+		}
+		else
+		{
+			pJob->failed = !loadImagePixels(pJob->filename, pJob->pixels, pJob->width, pJob->height);
+		}
+
+		if (decodeZone)
+		{
+			Profiler::get().endZone();
+		}
+		pJob->decodeMilliseconds = toMilliseconds(SDL_GetPerformanceCounter() - decodeStart);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_UploadQueue.push_back(pJob);
+	}
+}
+
+void AsyncTextureLoader::upload(Job * pJob)
+{
+	Uint64 uploadStart = SDL_GetPerformanceCounter();
+	const std::vector<unsigned char>& data = pJob->getUploadData();
+	GLsizeiptr size = (GLsizeiptr)data.size();
+
+	//With a pixel unpack buffer bound the data pointers are offsets into it and the copy to the texture happens on the GPU
+	const unsigned char * pSource = data.data();
+	bool staged = size <= TEXTURE_STAGING_BUFFER_SIZE;
+	if (staged)
+	{
+		GLsizeiptr offset = allocateStaging(size);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+
+		if (m_PersistentMapping)
+		{
+			memcpy(m_pStagingMemory + offset, data.data(), size);
+		}
+		else
+		{
+			//The fences already guarantee the range is free, so there's no need for the driver to synchronise
+			void * pMemory = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			memcpy(pMemory, data.data(), size);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		pSource = (const unsigned char*)(uintptr_t)offset;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, pJob->textureID);
+	if (!pJob->compressed.levels.empty())
+	{
+		uploadCompressedTexture(pJob->compressed, pSource);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pJob->width, pJob->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pSource);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (staged)
+	{
+		StagingRegion region;
+		region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region.start = (GLsizeiptr)(uintptr_t)pSource;
+		region.end = region.start + size;
+		m_StagingRegions.push_back(region);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	Uint64 uploadEnd = SDL_GetPerformanceCounter();
+	printf("Loaded texture %s %dx%d %s decode %.2fms upload %.2fms ready after %.2fms\n", pJob->filename.c_str(), pJob->width, pJob->height,
+		pJob->compressed.levels.empty() ? "RGBA8" : "DXT", pJob->decodeMilliseconds, toMilliseconds(uploadEnd - uploadStart), toMilliseconds(uploadEnd - pJob->requestTime));
+}
+
+GLsizeiptr AsyncTextureLoader::allocateStaging(GLsizeiptr size)
+{
+	if (m_StagingHead + size > TEXTURE_STAGING_BUFFER_SIZE)
+	{
+		m_StagingHead = 0;
+	}
+	GLsizeiptr start = m_StagingHead;
+	GLsizeiptr end = start + size;
+
+	//Regions retire in the order they were submitted, so wait on the oldest until nothing overlaps
+	while (!m_StagingRegions.empty())
+	{
+		bool overlaps = false;
+		for (StagingRegion& region : m_StagingRegions)
+		{
+			if (region.start < end && start < region.end)
+			{
+				overlaps = true;
+				break;
+			}
+		}
+		if (!overlaps)
+		{
+			break;
+		}
+
+		glClientWaitSync(m_StagingRegions.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(m_StagingRegions.front().fence);
+		m_StagingRegions.pop_front();
+	}
+
+	m_StagingHead = end;
+	return start;
+}
+
+double AsyncTextureLoader::toMilliseconds(Uint64 counts)
+{
+	return (double)counts * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+#include <SDL.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "TextureCooker.h"
+
+//Size of the staging ring the decoded pixels are copied through, textures bigger than this are uploaded straight from memory
+#define TEXTURE_STAGING_BUFFER_SIZE (32 * 1024 * 1024)
+//Bytes uploaded per update(), at least one texture is always uploaded so a big one can't get stuck
+#define TEXTURE_UPLOAD_BUDGET (8 * 1024 * 1024)
+#define TEXTURE_DECODE_THREADS 2
+
+//Loads textures without blocking the main thread. load() hands back a texture straight away holding a
+//1x1 placeholder, worker threads read the cooked DDS (cooking it first if needed), and update() copies the levels into the same texture
+//through a pixel buffer object, so the handle never changes and nothing has to be told when it's ready
+class AsyncTextureLoader
+{
+public:
+	static AsyncTextureLoader& get();
+
+	//Starts the decode threads and creates the staging buffer, needs a current GL context
+	void init();
+	void destroy();
+
+	//Until init() has been called this loads synchronously like loadTextureFromFile
+	GLuint load(const std::string& filename);
+	//Stops a texture that is being deleted from being written to when its decode finishes
+	void cancel(GLuint textureID);
+
+	//Uploads decoded textures, called once a frame on the thread that owns the GL context
+	void update();
+
+	unsigned int getPendingCount();
+
+private:
+	AsyncTextureLoader();
+	~AsyncTextureLoader();
+
+	struct Job
+	{
+		std::string filename;
+		GLuint textureID;
+		bool cancelled;
+		bool failed;
+
+		//Filled in by the decode thread, the cooked DXT mip chain when the driver supports it,
+		//otherwise tightly packed RGBA8 that gets its mips generated on the GPU
+		CompressedTexture compressed;
+		std::vector<unsigned char> pixels;
+		int width;
+		int height;
+
+		const std::vector<unsigned char>& getUploadData()
+		{
+			return compressed.levels.empty() ? pixels : compressed.data;
+		};
+
+		Uint64 requestTime;
+		double decodeMilliseconds;
+	};
+
+	//A range of the staging buffer the GPU may still be reading from
+	struct StagingRegion
+	{
+		GLsync fence;
+		GLsizeiptr start;
+		GLsizeiptr end;
+	};
+
+	void decodeThread();
+	void upload(Job * pJob);
+	//Returns the offset to copy size bytes to, waiting for the GPU to finish with that part of the ring if needed
+	GLsizeiptr allocateStaging(GLsizeiptr size);
+	double toMilliseconds(Uint64 counts);
+
+	bool m_Initialised;
+	bool m_PersistentMapping;
+	bool m_CompressedTextures;
+
+	std::vector<std::thread> m_Threads;
+	std::mutex m_Mutex;
+	std::condition_variable m_JobAvailable;
+	bool m_Quit;
+
+	//Both protected by m_Mutex
+	std::deque<Job*> m_DecodeQueue;
+	std::deque<Job*> m_UploadQueue;
+	//Every job not yet uploaded, keyed by texture so it can be cancelled
+	std::map<GLuint, Job*> m_Pending;
+
+	GLuint m_StagingBuffer;
+	unsigned char * m_pStagingMemory;
+	GLsizeiptr m_StagingHead;
+	std::deque<StagingRegion> m_StagingRegions;
+};
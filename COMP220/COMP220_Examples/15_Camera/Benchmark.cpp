@@ -0,0 +1,755 @@
+#include "Benchmark.h"
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include <SDL.h>
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+#include <glm\gtx\transform.hpp>
+
+#include "GameObject.h"
+#include "EntityStore.h"
+#include "FrustumCuller.h"
+#include "RenderQueue.h"
+#include "TransformHierarchy.h"
+#include "Texture.h"
+#include "TextureCooker.h"
+#include "Shader.h"
+#include "JobSystem.h"
+#include "JobTaskScheduler.h"
+#include "SphereEmitter.h"
+#include "AssetCache.h"
+#include "GeometryArena.h"
+#include "ShaderLibrary.h"
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics\Dynamics\btDiscreteDynamicsWorldMt.h>
+#include <BulletCollision\CollisionDispatch\btCollisionDispatcherMt.h>
+
+#define BENCHMARK_FRAMES 100
+//One object in this many moves each frame, the rest stay still like most scenery does
+#define BENCHMARK_MOVING_STRIDE 10
+//Every other GameObject rides this far above the one before it, so moving a parent has to reach its child through the hierarchy
+#define BENCHMARK_CHILD_OFFSET glm::vec3(0.0f, 1.0f, 0.0f)
+//The render queue only takes meshes that live in a geometry arena, so the entity benchmarks draw the scene's trees
+#define BENCHMARK_MESH "lowpolytree.fbx"
+#define BENCHMARK_VERTEX_SHADER "lightingVert.glsl"
+#define BENCHMARK_FRAGMENT_SHADER "lightingFrag.glsl"
+
+static double elapsedMilliseconds(Uint64 start, Uint64 end)
+{
+	return (double)(end - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+//Objects are spread over a square grid centred on the origin, the camera only sees part of it
+static glm::vec3 gridPosition(unsigned int i, unsigned int numberOfObjects)
+{
+	unsigned int side = (unsigned int)glm::ceil(glm::sqrt((float)numberOfObjects));
+	return glm::vec3((float)(i % side) - side * 0.5f, 0.0f, (float)(i / side) - side * 0.5f) * 2.0f;
+}
+
+//Where a GameObject sits relative to its parent, children are the odd ones
+static glm::vec3 localPosition(unsigned int i, unsigned int numberOfObjects)
+{
+	return i % 2 == 1 ? BENCHMARK_CHILD_OFFSET : gridPosition(i, numberOfObjects);
+}
+
+//Uploading meshes and compiling programs needs a GL context, a hidden window is enough. Returns null on failure
+static SDL_Window * createHiddenContext(const char * title, int width, int height, SDL_GLContext& context)
+{
+	context = nullptr;
+	if (SDL_Init(SDL_INIT_VIDEO) < 0)
+	{
+		printf("SDL_Init failed %s\n", SDL_GetError());
+		return nullptr;
+	}
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_Window * window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+	context = window != nullptr ? SDL_GL_CreateContext(window) : nullptr;
+	if (context == nullptr)
+	{
+		printf("Unable to create a GL context for %s %s\n", title, SDL_GetError());
+		if (window != nullptr)
+		{
+			SDL_DestroyWindow(window);
+		}
+		SDL_Quit();
+		return nullptr;
+	}
+	glewExperimental = GL_TRUE;
+	glewInit();
+	return window;
+}
+
+static void destroyHiddenContext(SDL_Window * window, SDL_GLContext context)
+{
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+}
+
+//Loads the benchmark assets into a hidden context, the references returned keep them cached while the objects come and go
+static SDL_Window * loadBenchmarkAssets(const char * title, SDL_GLContext& context, MeshGroup *& pMeshes, ShaderProgram *& pProgram)
+{
+	SDL_Window * window = createHiddenContext(title, 64, 64, context);
+	if (window == nullptr)
+	{
+		return nullptr;
+	}
+
+	pMeshes = AssetCache::get().acquireMeshes(BENCHMARK_MESH);
+	pProgram = AssetCache::get().acquireShaderProgram(BENCHMARK_VERTEX_SHADER, BENCHMARK_FRAGMENT_SHADER);
+	if (pMeshes == nullptr || pProgram == nullptr)
+	{
+		printf("Unable to load %s with %s and %s for %s\n", BENCHMARK_MESH, BENCHMARK_VERTEX_SHADER, BENCHMARK_FRAGMENT_SHADER, title);
+		AssetCache::get().clear();
+		GeometryArena::destroyAll();
+		ShaderLibrary::get().destroy();
+		destroyHiddenContext(window, context);
+		return nullptr;
+	}
+	return window;
+}
+
+static void unloadBenchmarkAssets(SDL_Window * window, SDL_GLContext context, MeshGroup * pMeshes, ShaderProgram * pProgram)
+{
+	AssetCache::get().releaseMeshes(pMeshes);
+	AssetCache::get().releaseShaderProgram(pProgram);
+	AssetCache::get().clear();
+	GeometryArena::destroyAll();
+	ShaderLibrary::get().destroy();
+	destroyHiddenContext(window, context);
+}
+
+static double timeGameObjects(unsigned int numberOfObjects, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	std::vector<GameObject*> gameObjectList;
+	gameObjectList.reserve(numberOfObjects);
+	for (unsigned int i = 0; i < numberOfObjects; i++)
+	{
+		GameObject * pObj = new GameObject();
+		pObj->loadMeshesFromFile(BENCHMARK_MESH);
+		pObj->loadShaderProgram(BENCHMARK_VERTEX_SHADER, BENCHMARK_FRAGMENT_SHADER);
+		pObj->setPosition(localPosition(i, numberOfObjects));
+		if (i % 2 == 1)
+		{
+			pObj->setParent(gameObjectList[i - 1]);
+		}
+		gameObjectList.push_back(pObj);
+	}
+
+	FrustumCuller frustumCuller;
+	RenderQueue renderQueue;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+	{
+		for (unsigned int i = frame % BENCHMARK_MOVING_STRIDE; i < numberOfObjects; i += BENCHMARK_MOVING_STRIDE)
+		{
+			gameObjectList[i]->setPosition(localPosition(i, numberOfObjects) + glm::vec3(0.0f, glm::sin((float)frame), 0.0f));
+		}
+
+		for (GameObject * pObj : gameObjectList)
+		{
+			pObj->update();
+		}
+		TransformHierarchy::get().update();
+		for (GameObject * pObj : gameObjectList)
+		{
+			pObj->syncWorldTransform();
+		}
+
+		frustumCuller.begin(projectionMatrix * viewMatrix);
+		for (GameObject * pObj : gameObjectList)
+		{
+			frustumCuller.addSphere(pObj->getWorldBoundingSphere());
+		}
+		frustumCuller.cull();
+
+		renderQueue.begin(viewMatrix, projectionMatrix, 100.0f);
+		for (unsigned int i = 0; i < numberOfObjects; i++)
+		{
+			if (frustumCuller.isVisible(i))
+			{
+				renderQueue.submit(gameObjectList[i]);
+			}
+		}
+		renderQueue.sort();
+	}
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	//Every child should have followed its parent, wherever the last frame left them
+	unsigned int misplacedChildren = 0;
+	for (unsigned int i = 1; i < numberOfObjects; i += 2)
+	{
+		glm::vec3 expected = glm::vec3(gameObjectList[i - 1]->getModelMatrix() * glm::vec4(gameObjectList[i]->getPosition(), 1.0f));
+		if (glm::distance(glm::vec3(gameObjectList[i]->getModelMatrix()[3]), expected) > 0.001f)
+		{
+			misplacedChildren++;
+		}
+	}
+	if (misplacedChildren > 0)
+	{
+		printf("Hierarchy check failed, %u of %u children are not where their parent put them\n", misplacedChildren, numberOfObjects / 2);
+	}
+
+	for (GameObject * pObj : gameObjectList)
+	{
+		pObj->destroy();
+		delete pObj;
+	}
+	return elapsedMilliseconds(start, end) / BENCHMARK_FRAMES;
+}
+
+static double timeEntityStore(unsigned int numberOfObjects, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	EntityStore entityStore;
+	std::vector<Entity> entities;
+	entities.reserve(numberOfObjects);
+	for (unsigned int i = 0; i < numberOfObjects; i++)
+	{
+		Entity entity = entityStore.createEntity(gridPosition(i, numberOfObjects));
+		entityStore.addRenderable(entity, AssetCache::get().acquireMeshes(BENCHMARK_MESH),
+			AssetCache::get().acquireShaderProgram(BENCHMARK_VERTEX_SHADER, BENCHMARK_FRAGMENT_SHADER), 0);
+		entities.push_back(entity);
+	}
+
+	FrustumCuller frustumCuller;
+	RenderQueue renderQueue;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+	{
+		for (unsigned int i = frame % BENCHMARK_MOVING_STRIDE; i < numberOfObjects; i += BENCHMARK_MOVING_STRIDE)
+		{
+			entityStore.setPosition(entities[i], gridPosition(i, numberOfObjects) + glm::vec3(0.0f, glm::sin((float)frame), 0.0f));
+		}
+
+		entityStore.update();
+
+		frustumCuller.begin(projectionMatrix * viewMatrix);
+		unsigned int firstCullIndex = entityStore.addToCuller(frustumCuller);
+		frustumCuller.cull();
+
+		renderQueue.begin(viewMatrix, projectionMatrix, 100.0f);
+		entityStore.submit(renderQueue, frustumCuller, firstCullIndex);
+		renderQueue.sort();
+	}
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	entityStore.clear();
+	return elapsedMilliseconds(start, end) / BENCHMARK_FRAMES;
+}
+
+int runEntityBenchmark()
+{
+	glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(50.0f, 0.0f, 50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 800.0f / 640.0f, 0.1f, 100.0f);
+
+	SDL_GLContext context;
+	MeshGroup * pMeshes = nullptr;
+	ShaderProgram * pProgram = nullptr;
+	SDL_Window * window = loadBenchmarkAssets("Entity Benchmark", context, pMeshes, pProgram);
+	if (window == nullptr)
+	{
+		return 1;
+	}
+
+	printf("%10s %16s %16s %8s\n", "objects", "GameObject ms", "EntityStore ms", "speedup");
+	for (unsigned int numberOfObjects = 10000; numberOfObjects <= 100000; numberOfObjects += 10000)
+	{
+		double gameObjectTime = timeGameObjects(numberOfObjects, viewMatrix, projectionMatrix);
+		double entityStoreTime = timeEntityStore(numberOfObjects, viewMatrix, projectionMatrix);
+		printf("%10u %16.3f %16.3f %7.2fx\n", numberOfObjects, gameObjectTime, entityStoreTime, gameObjectTime / entityStoreTime);
+	}
+
+	unloadBenchmarkAssets(window, context, pMeshes, pProgram);
+	return 0;
+}
+
+#define JOB_BENCHMARK_OBJECTS 200000
+
+int runJobBenchmark()
+{
+	glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(50.0f, 0.0f, 50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 800.0f / 640.0f, 0.1f, 100.0f);
+
+	SDL_GLContext context;
+	MeshGroup * pMeshes = nullptr;
+	ShaderProgram * pProgram = nullptr;
+	SDL_Window * window = loadBenchmarkAssets("Job Benchmark", context, pMeshes, pProgram);
+	if (window == nullptr)
+	{
+		return 1;
+	}
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	printf("%u objects on %u cores\n", JOB_BENCHMARK_OBJECTS, cores);
+	printf("%10s %12s %10s %10s\n", "threads", "frame ms", "speedup", "stolen");
+
+	double singleThreadTime = 0.0;
+	for (unsigned int threads = 1; threads <= 16 && threads <= glm::max(cores, 1u); threads *= 2)
+	{
+		//1 thread is the calling thread on its own, which runs every job itself
+		if (threads > 1)
+		{
+			JobSystem::get().init(threads - 1);
+		}
+
+		double frameTime = timeEntityStore(JOB_BENCHMARK_OBJECTS, viewMatrix, projectionMatrix);
+		if (threads == 1)
+		{
+			singleThreadTime = frameTime;
+		}
+
+		unsigned int jobsRun = 0;
+		unsigned int jobsStolen = 0;
+		for (unsigned int i = 0; i < JobSystem::get().getThreadCount(); i++)
+		{
+			jobsRun += JobSystem::get().getJobsRun(i);
+			jobsStolen += JobSystem::get().getJobsStolen(i);
+		}
+		printf("%10u %12.3f %9.2fx %9.1f%%\n", threads, frameTime, singleThreadTime / frameTime, jobsRun > 0 ? 100.0 * jobsStolen / jobsRun : 0.0);
+
+		JobSystem::get().destroy();
+	}
+
+	unloadBenchmarkAssets(window, context, pMeshes, pProgram);
+	return 0;
+}
+
+//Average of the 1 to 10 second lifetimes, emitting the pool size over this keeps it roughly full
+#define PARTICLE_BENCHMARK_AVERAGE_LIFETIME 5.5f
+
+//Average update time in milliseconds, and the average number of particles updated
+static double timeParticles(unsigned int numberOfParticles, double& averageParticles)
+{
+	ParticleSettings settings = {};
+	settings.maxParticles = numberOfParticles;
+	settings.emissionRate = numberOfParticles / PARTICLE_BENCHMARK_AVERAGE_LIFETIME;
+	settings.minLifetime = 1.0f;
+	settings.maxLifetime = 10.0f;
+	settings.minSpeed = 1.0f;
+	settings.maxSpeed = 5.0f;
+	settings.acceleration = glm::vec3(0.0f, -9.81f, 0.0f);
+	settings.startSize = 0.1f;
+	settings.endSize = 0.0f;
+	settings.startColour = glm::vec4(1.0f, 0.8f, 0.2f, 1.0f);
+	settings.endColour = glm::vec4(1.0f, 0.1f, 0.0f, 0.0f);
+
+	SphereEmitter emitter;
+	emitter.init(settings);
+	emitter.burst(numberOfParticles);
+
+	double totalParticles = 0.0;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+	{
+		totalParticles += emitter.getParticleCount();
+		emitter.update(1.0f / 60.0f);
+	}
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	averageParticles = totalParticles / BENCHMARK_FRAMES;
+	return elapsedMilliseconds(start, end) / BENCHMARK_FRAMES;
+}
+
+int runParticleBenchmark()
+{
+	printf("%10s %14s %16s %14s %16s\n", "particles", "1 thread ms", "particles/ms", "jobs ms", "particles/ms");
+	for (unsigned int numberOfParticles = 100000; numberOfParticles <= 1000000; numberOfParticles *= 2)
+	{
+		double averageParticles = 0.0;
+		double singleThreadTime = timeParticles(numberOfParticles, averageParticles);
+		double singleThreadRate = averageParticles / singleThreadTime;
+
+		JobSystem::get().init();
+		double jobTime = timeParticles(numberOfParticles, averageParticles);
+		double jobRate = averageParticles / jobTime;
+		JobSystem::get().destroy();
+
+		printf("%10u %14.3f %16.0f %14.3f %16.0f\n", numberOfParticles, singleThreadTime, singleThreadRate, jobTime, jobRate);
+	}
+	return 0;
+}
+
+//Boxes dropped in a square of columns onto a static floor, they land and pile up partway through the run
+#define PHYSICS_BENCHMARK_COLUMNS 16
+#define PHYSICS_BENCHMARK_HEIGHT 12
+#define PHYSICS_BENCHMARK_STEPS 300
+
+//Average milliseconds per fixed 60Hz step with whatever task scheduler is current
+static double timePhysics(int numberOfThreads)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btDbvtBroadphase broadphase;
+#if BT_THREADSAFE
+	btCollisionDispatcherMt dispatcher(&collisionConfiguration);
+	btConstraintSolverPoolMt solver(numberOfThreads);
+	btDiscreteDynamicsWorldMt world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+#else
+	(void)numberOfThreads;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btSequentialImpulseConstraintSolver solver;
+	btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+#endif
+	world.setGravity(btVector3(0, -9.81, 0));
+
+	btBoxShape groundShape(btVector3(100, 1, 100));
+	btRigidBody ground(btRigidBody::btRigidBodyConstructionInfo(0.0, nullptr, &groundShape));
+	ground.setWorldTransform(btTransform(btQuaternion::getIdentity(), btVector3(0, -1, 0)));
+	world.addRigidBody(&ground);
+
+	btBoxShape boxShape(btVector3(0.5, 0.5, 0.5));
+	btVector3 boxInertia(0, 0, 0);
+	boxShape.calculateLocalInertia(1.0, boxInertia);
+
+	std::vector<btRigidBody*> boxes;
+	for (int y = 0; y < PHYSICS_BENCHMARK_HEIGHT; y++)
+	{
+		for (int x = 0; x < PHYSICS_BENCHMARK_COLUMNS; x++)
+		{
+			for (int z = 0; z < PHYSICS_BENCHMARK_COLUMNS; z++)
+			{
+				//Every other layer is nudged so the columns topple into each other rather than stacking perfectly
+				btScalar offset = (y % 2) * 0.3;
+				btVector3 position(x * 1.5 - PHYSICS_BENCHMARK_COLUMNS * 0.75 + offset, 2.0 + y * 1.2, z * 1.5 - PHYSICS_BENCHMARK_COLUMNS * 0.75 + offset);
+				btRigidBody * pBox = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(1.0, nullptr, &boxShape, boxInertia));
+				pBox->setWorldTransform(btTransform(btQuaternion::getIdentity(), position));
+				world.addRigidBody(pBox);
+				boxes.push_back(pBox);
+			}
+		}
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int step = 0; step < PHYSICS_BENCHMARK_STEPS; step++)
+	{
+		world.stepSimulation(1.0 / 60.0, 1, 1.0 / 60.0);
+	}
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	for (btRigidBody * pBox : boxes)
+	{
+		world.removeRigidBody(pBox);
+		delete pBox;
+	}
+	world.removeRigidBody(&ground);
+
+	return elapsedMilliseconds(start, end) / PHYSICS_BENCHMARK_STEPS;
+}
+
+int runPhysicsBenchmark()
+{
+	unsigned int cores = std::thread::hardware_concurrency();
+	printf("%d boxes, %d steps on %u cores\n", PHYSICS_BENCHMARK_COLUMNS * PHYSICS_BENCHMARK_COLUMNS * PHYSICS_BENCHMARK_HEIGHT, PHYSICS_BENCHMARK_STEPS, cores);
+#if !BT_THREADSAFE
+	printf("Built without BT_THREADSAFE, as the project's configurations are, so every scheduler runs the step on one thread\n");
+	printf("and the thread count makes no difference. Rebuild Bullet with BT_THREADSAFE=ON and define it to measure scaling\n");
+#endif
+	btITaskScheduler * pOpenMPScheduler = btGetOpenMPTaskScheduler();
+	if (pOpenMPScheduler == nullptr)
+	{
+		printf("Bullet was built without BT_USE_OPENMP, there is no OpenMP scheduler to compare against\n");
+	}
+	printf("%10s %12s %10s %14s %12s %10s\n", "threads", "jobs ms", "speedup", "no spin ms", "OpenMP ms", "speedup");
+
+	double singleThreadTime = 0.0;
+	for (unsigned int threads = 1; threads <= 16 && threads <= glm::max(cores, 1u); threads *= 2)
+	{
+		//1 thread is the calling thread on its own, which runs every job itself
+		if (threads > 1)
+		{
+			JobSystem::get().init(threads - 1);
+		}
+
+		JobTaskScheduler jobTaskScheduler;
+		btSetTaskScheduler(&jobTaskScheduler);
+		double jobTime = timePhysics(threads);
+		if (threads == 1)
+		{
+			singleThreadTime = jobTime;
+		}
+
+		//The same again with workers going straight to sleep, to show what the spinning is worth
+		unsigned int spinCount = JobSystem::get().getSpinCount();
+		JobSystem::get().setSpinCount(0);
+		double noSpinTime = timePhysics(threads);
+		JobSystem::get().setSpinCount(spinCount);
+
+		btSetTaskScheduler(btGetSequentialTaskScheduler());
+		JobSystem::get().destroy();
+
+		if (pOpenMPScheduler != nullptr)
+		{
+			pOpenMPScheduler->setNumThreads(threads);
+			btSetTaskScheduler(pOpenMPScheduler);
+			double openMPTime = timePhysics(threads);
+			btSetTaskScheduler(btGetSequentialTaskScheduler());
+			printf("%10u %12.3f %9.2fx %14.3f %12.3f %9.2fx\n", threads, jobTime, singleThreadTime / jobTime, noSpinTime, openMPTime, singleThreadTime / openMPTime);
+		}
+		else
+		{
+			printf("%10u %12.3f %9.2fx %14.3f %12s %10s\n", threads, jobTime, singleThreadTime / jobTime, noSpinTime, "-", "-");
+		}
+	}
+	return 0;
+}
+
+#define TEXTURE_BENCHMARK_TARGET_SIZE 256
+#define TEXTURE_BENCHMARK_DRAWS 200
+
+//Draws the texture over the whole target many times and returns the GPU time per draw
+static double timeSampling(GLuint textureID, GLuint programID, GLuint quadVAO)
+{
+	GLuint query;
+	glGenQueries(1, &query);
+
+	glUseProgram(programID);
+	glBindVertexArray(quadVAO);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	//One untimed draw so any lazy texture setup in the driver isn't counted
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glFinish();
+
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	for (int i = 0; i < TEXTURE_BENCHMARK_DRAWS; i++)
+	{
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+
+	GLuint64 elapsedNanoseconds = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNanoseconds);
+	glDeleteQueries(1, &query);
+	return (double)elapsedNanoseconds / 1000000.0 / TEXTURE_BENCHMARK_DRAWS;
+}
+
+int runTextureBenchmark(int numberOfFiles, char ** filenames)
+{
+	SDL_GLContext context;
+	SDL_Window * window = createHiddenContext("Texture Benchmark", TEXTURE_BENCHMARK_TARGET_SIZE, TEXTURE_BENCHMARK_TARGET_SIZE, context);
+	if (window == nullptr)
+	{
+		return 1;
+	}
+
+	bool canSampleCompressed = GLEW_EXT_texture_compression_s3tc != 0;
+	if (!canSampleCompressed)
+	{
+		printf("Driver has no S3TC support, DXT sampling will be skipped\n");
+	}
+
+	//Render into a small target so every texture is minified, which is where mips and compression pay off
+	GLuint targetTexture = createTexture(TEXTURE_BENCHMARK_TARGET_SIZE, TEXTURE_BENCHMARK_TARGET_SIZE);
+	GLuint frameBufferID;
+	glGenFramebuffers(1, &frameBufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBufferID);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, targetTexture, 0);
+	glViewport(0, 0, TEXTURE_BENCHMARK_TARGET_SIZE, TEXTURE_BENCHMARK_TARGET_SIZE);
+
+	GLfloat quadVerts[] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+	GLuint quadVBO;
+	glGenBuffers(1, &quadVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVerts), quadVerts, GL_STATIC_DRAW);
+	GLuint quadVAO;
+	glGenVertexArrays(1, &quadVAO);
+	glBindVertexArray(quadVAO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+
+	GLuint programID = LoadShaders("passThroughVert.glsl", "postTextureFrag.glsl");
+
+	printf("%-24s %10s %8s %12s %12s %12s %6s %9s %10s %10s %10s\n", "texture", "size", "format", "RGBA8 KB", "RGBA8+mip KB", "DXT+mip KB", "ratio",
+		"cook ms", "RGBA8 ms", "mip ms", "DXT ms");
+
+	int failures = 0;
+	for (int i = 0; i < numberOfFiles; i++)
+	{
+		std::vector<unsigned char> pixels;
+		int width = 0;
+		int height = 0;
+		if (!loadImagePixels(filenames[i], pixels, width, height))
+		{
+			failures++;
+			continue;
+		}
+
+		Uint64 cookStart = SDL_GetPerformanceCounter();
+		CompressedTexture compressed;
+		if (!compressTexture(pixels.data(), width, height, compressed))
+		{
+			failures++;
+			continue;
+		}
+		double cookMilliseconds = elapsedMilliseconds(cookStart, SDL_GetPerformanceCounter());
+
+		//Level sizes are the same whichever way the chain is stored
+		size_t uncompressedBytes = (size_t)width * height * 4;
+		size_t mippedBytes = 0;
+		for (const CompressedLevel& level : compressed.levels)
+		{
+			mippedBytes += (size_t)level.width * level.height * 4;
+		}
+
+		GLuint textures[3];
+		glGenTextures(3, textures);
+
+		glBindTexture(GL_TEXTURE_2D, textures[0]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+		glBindTexture(GL_TEXTURE_2D, textures[1]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+		double compressedSampling = 0.0;
+		if (canSampleCompressed)
+		{
+			glBindTexture(GL_TEXTURE_2D, textures[2]);
+			uploadCompressedTexture(compressed, compressed.data.data());
+		}
+
+		double uncompressedSampling = timeSampling(textures[0], programID, quadVAO);
+		double mippedSampling = timeSampling(textures[1], programID, quadVAO);
+		if (canSampleCompressed)
+		{
+			compressedSampling = timeSampling(textures[2], programID, quadVAO);
+		}
+		glDeleteTextures(3, textures);
+
+		char size[32];
+		snprintf(size, sizeof(size), "%dx%d", width, height);
+		printf("%-24s %10s %8s %12.1f %12.1f %12.1f %5.1fx %9.2f %10.4f %10.4f %10.4f\n", filenames[i], size,
+			compressed.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? "DXT5" : "DXT1",
+			uncompressedBytes / 1024.0, mippedBytes / 1024.0, compressed.data.size() / 1024.0, (double)mippedBytes / compressed.data.size(),
+			cookMilliseconds, uncompressedSampling, mippedSampling, compressedSampling);
+	}
+
+	glDeleteProgram(programID);
+	glDeleteVertexArrays(1, &quadVAO);
+	glDeleteBuffers(1, &quadVBO);
+	glDeleteFramebuffers(1, &frameBufferID);
+	glDeleteTextures(1, &targetTexture);
+	destroyHiddenContext(window, context);
+	return failures == 0 ? 0 : 1;
+}
+
+bool parseHeadlessBenchmarkSettings(int argc, char ** args, HeadlessBenchmarkSettings & settings)
+{
+	settings.enabled = argc > 1 && std::string(args[1]) == "-headless";
+	settings.frames = 600;
+	settings.warmupFrames = 30;
+	settings.captureInterval = 0;
+	settings.reportFilename = "";
+	settings.cameraPathFilename = "";
+	settings.traceFilename = "";
+
+	for (int i = 2; settings.enabled && i + 1 < argc; i += 2)
+	{
+		std::string option = args[i];
+		if (option == "-frames")
+		{
+			settings.frames = atoi(args[i + 1]);
+		}
+		else if (option == "-warmup")
+		{
+			settings.warmupFrames = atoi(args[i + 1]);
+		}
+		else if (option == "-capture")
+		{
+			settings.captureInterval = atoi(args[i + 1]);
+		}
+		else if (option == "-report")
+		{
+			settings.reportFilename = args[i + 1];
+		}
+		else if (option == "-path")
+		{
+			settings.cameraPathFilename = args[i + 1];
+		}
+		else if (option == "-trace")
+		{
+			settings.traceFilename = args[i + 1];
+		}
+		else
+		{
+			printf("Unknown headless option %s\n", option.c_str());
+		}
+	}
+	return settings.enabled;
+}
+
+void FrameReport::addFrame(const FrameSample & sample)
+{
+	m_Samples.push_back(sample);
+}
+
+//Nearest rank percentile of an already sorted list
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+	size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+void FrameReport::print(const char * rendererName)
+{
+	if (m_Samples.empty())
+	{
+		printf("No frames recorded\n");
+		return;
+	}
+
+	std::vector<double> cpuTimes;
+	std::vector<double> frameTimes;
+	double drawCalls = 0.0;
+	double instances = 0.0;
+	double triangles = 0.0;
+	double fullDetailTriangles = 0.0;
+	for (const FrameSample& sample : m_Samples)
+	{
+		cpuTimes.push_back(sample.cpuMilliseconds);
+		frameTimes.push_back(sample.frameMilliseconds);
+		drawCalls += sample.drawCalls;
+		instances += sample.instances;
+		triangles += sample.triangles;
+		fullDetailTriangles += sample.fullDetailTriangles;
+	}
+	std::sort(cpuTimes.begin(), cpuTimes.end());
+	std::sort(frameTimes.begin(), frameTimes.end());
+
+	double frames = (double)m_Samples.size();
+	printf("Renderer %s, %u frames\n", rendererName, (unsigned int)m_Samples.size());
+	printf("%-12s %9s %9s %9s %9s %9s\n", "", "min", "p50", "p95", "p99", "max");
+	printf("%-12s %9.3f %9.3f %9.3f %9.3f %9.3f\n", "cpu ms", cpuTimes.front(), percentile(cpuTimes, 0.5), percentile(cpuTimes, 0.95), percentile(cpuTimes, 0.99), cpuTimes.back());
+	printf("%-12s %9.3f %9.3f %9.3f %9.3f %9.3f\n", "frame ms", frameTimes.front(), percentile(frameTimes, 0.5), percentile(frameTimes, 0.95), percentile(frameTimes, 0.99), frameTimes.back());
+	printf("Average per frame: %.1f draws %.1f instances %.0f triangles (%.0f without LODs)\n", drawCalls / frames, instances / frames, triangles / frames, fullDetailTriangles / frames);
+}
+
+bool FrameReport::writeCSV(const std::string & filename)
+{
+	FILE * pFile = fopen(filename.c_str(), "w");
+	if (pFile == nullptr)
+	{
+		printf("Unable to write benchmark report %s\n", filename.c_str());
+		return false;
+	}
+
+	fprintf(pFile, "frame,cpu_ms,frame_ms,draw_calls,instances,triangles,full_detail_triangles\n");
+	for (size_t i = 0; i < m_Samples.size(); i++)
+	{
+		const FrameSample& sample = m_Samples[i];
+		fprintf(pFile, "%u,%.4f,%.4f,%u,%u,%u,%u\n", (unsigned int)i, sample.cpuMilliseconds, sample.frameMilliseconds, sample.drawCalls, sample.instances, sample.triangles, sample.fullDetailTriangles);
+	}
+	fclose(pFile);
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//Offline benchmarks run from the command line before any window is opened, each returns the process exit code
+
+//Times a frame of update, cull and render queue submission for 10k to 100k copies of the scene's tree,
+//stored as GameObjects with half of them parented to the other half, and as EntityStore entities. Checks that the
+//children followed their parents. Opens a hidden GL context to load the tree. "15_Camera -bench-entities"
+int runEntityBenchmark();
+
+//Times the EntityStore frame from -bench-entities at 200k objects with the JobSystem running 1, 2, 4, 8 and 16 threads,
+//up to the number of cores, and reports the speedup over one thread. "15_Camera -bench-jobs"
+int runJobBenchmark();
+
+//Runs a sphere emitter at a steady 100k to 800k particles and reports update throughput in particles per millisecond,
+//first on one thread and then across the JobSystem. "15_Camera -bench-particles"
+int runParticleBenchmark();
+
+//Steps a world of a few thousand falling boxes with Bullet's parallel loops on the JobSystem at 1, 2, 4, 8 and 16 threads,
+//with and without idle workers spinning, next to Bullet's OpenMP scheduler when it was built with one. Only shows scaling when
+//Bullet and this project are built with BT_THREADSAFE, which the shipped configurations aren't. "15_Camera -bench-physics"
+int runPhysicsBenchmark();
+
+//Reports the memory each texture takes uncompressed, uncompressed with mips and cooked to DXT with mips,
+//then times sampling each version minified onto a small target. "15_Camera -bench-textures Tank1DF.png ..."
+int runTextureBenchmark(int numberOfFiles, char ** filenames);
+
+//Options for "15_Camera -headless", which runs the normal scene offscreen along a scripted camera path.
+//"-frames 600 -warmup 30 -capture 120 -report frames.csv -path camera.txt -trace profile.json", all optional
+struct HeadlessBenchmarkSettings
+{
+	bool enabled;
+	int frames;
+	//Frames rendered before recording starts, so shader compiles and first uploads aren't counted
+	int warmupFrames;
+	//Saves capture_NNNN.png every this many recorded frames, 0 for none
+	int captureInterval;
+	std::string reportFilename;
+	std::string cameraPathFilename;
+	//Chrome trace of the last frames, written by the profiler when the run ends
+	std::string traceFilename;
+};
+
+//Returns false if the arguments don't ask for a headless run
+bool parseHeadlessBenchmarkSettings(int argc, char ** args, HeadlessBenchmarkSettings& settings);
+
+struct FrameSample
+{
+	//Simulation, culling, submission and issuing every GL call
+	double cpuMilliseconds;
+	//The same plus waiting for the GPU to finish, so it includes the actual rendering
+	double frameMilliseconds;
+	unsigned int drawCalls;
+	unsigned int instances;
+	unsigned int triangles;
+	//Triangles with every object at full detail, against triangles shows what the LODs saved
+	unsigned int fullDetailTriangles;
+};
+
+//Collects per frame numbers from a headless run, prints a summary with percentiles and writes every frame out as CSV
+class FrameReport
+{
+public:
+	void addFrame(const FrameSample& sample);
+	void print(const char * rendererName);
+	bool writeCSV(const std::string& filename);
+
+private:
+	std::vector<FrameSample> m_Samples;
+};
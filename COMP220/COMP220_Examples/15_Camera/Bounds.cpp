@@ -0,0 +1,70 @@
+#include "Bounds.h"
+
+#include <cfloat>
+
+void computeBounds(const PackedVertex * pVerts, unsigned int numberOfVerts, AABB & box, BoundingSphere & sphere)
+{
+	if (numberOfVerts == 0)
+	{
+		box.min = glm::vec3(0.0f);
+		box.max = glm::vec3(0.0f);
+		sphere.centre = glm::vec3(0.0f);
+		sphere.radius = 0.0f;
+		return;
+	}
+
+	box.min = glm::vec3(FLT_MAX);
+	box.max = glm::vec3(-FLT_MAX);
+	for (unsigned int i = 0; i < numberOfVerts; i++)
+	{
+		glm::vec3 position(pVerts[i].x, pVerts[i].y, pVerts[i].z);
+		box.min = glm::min(box.min, position);
+		box.max = glm::max(box.max, position);
+	}
+
+	//Radius from the furthest vertex rather than the box corner, which is noticeably tighter for round models
+	sphere.centre = (box.min + box.max) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (unsigned int i = 0; i < numberOfVerts; i++)
+	{
+		glm::vec3 offset = glm::vec3(pVerts[i].x, pVerts[i].y, pVerts[i].z) - sphere.centre;
+		radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+	}
+	sphere.radius = glm::sqrt(radiusSquared);
+}
+
+AABB mergeBounds(const AABB & a, const AABB & b)
+{
+	AABB merged;
+	merged.min = glm::min(a.min, b.min);
+	merged.max = glm::max(a.max, b.max);
+	return merged;
+}
+
+AABB transformBounds(const AABB & box, const glm::mat4 & matrix)
+{
+	glm::vec3 centre = (box.min + box.max) * 0.5f;
+	glm::vec3 extents = (box.max - box.min) * 0.5f;
+
+	glm::vec3 transformedCentre = glm::vec3(matrix * glm::vec4(centre, 1.0f));
+	glm::vec3 transformedExtents = glm::abs(glm::vec3(matrix[0])) * extents.x +
+		glm::abs(glm::vec3(matrix[1])) * extents.y +
+		glm::abs(glm::vec3(matrix[2])) * extents.z;
+
+	AABB transformed;
+	transformed.min = transformedCentre - transformedExtents;
+	transformed.max = transformedCentre + transformedExtents;
+	return transformed;
+}
+
+BoundingSphere transformBounds(const BoundingSphere & sphere, const glm::mat4 & matrix)
+{
+	float scaleX = glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0]));
+	float scaleY = glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]));
+	float scaleZ = glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]));
+
+	BoundingSphere transformed;
+	transformed.centre = glm::vec3(matrix * glm::vec4(sphere.centre, 1.0f));
+	transformed.radius = sphere.radius * glm::sqrt(glm::max(scaleX, glm::max(scaleY, scaleZ)));
+	return transformed;
+}
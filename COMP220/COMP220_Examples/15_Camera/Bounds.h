@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm\glm.hpp>
+
+#include "VertexFormat.h"
+
+struct AABB
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+struct BoundingSphere
+{
+	glm::vec3 centre;
+	float radius;
+};
+
+//Box and sphere around a set of vertex positions, the sphere is centred on the box
+void computeBounds(const PackedVertex * pVerts, unsigned int numberOfVerts, AABB& box, BoundingSphere& sphere);
+
+//Smallest box containing both boxes
+AABB mergeBounds(const AABB& a, const AABB& b);
+
+//Box around a transformed box, using the absolute value of the rotation part of the matrix
+AABB transformBounds(const AABB& box, const glm::mat4& matrix);
+
+//Moves the sphere with the matrix and grows its radius by the largest axis scale
+BoundingSphere transformBounds(const BoundingSphere& sphere, const glm::mat4& matrix);
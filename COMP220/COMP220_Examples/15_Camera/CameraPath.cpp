@@ -0,0 +1,81 @@
+#include "CameraPath.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+	return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+void CameraPath::addKeyframe(float time, const glm::vec3 & position, const glm::vec3 & target)
+{
+	m_Keyframes.push_back({ time, position, target });
+}
+
+bool CameraPath::loadFromFile(const std::string & filename)
+{
+	std::ifstream pathStream(filename);
+	if (!pathStream.is_open())
+	{
+		printf("Unable to open camera path %s\n", filename.c_str());
+		return false;
+	}
+
+	m_Keyframes.clear();
+	std::string line;
+	while (std::getline(pathStream, line))
+	{
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+
+		CameraKeyframe keyframe;
+		std::istringstream lineStream(line);
+		if (lineStream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.target.x >> keyframe.target.y >> keyframe.target.z)
+		{
+			m_Keyframes.push_back(keyframe);
+		}
+	}
+	return !m_Keyframes.empty();
+}
+
+void CameraPath::evaluate(float time, glm::vec3 & position, glm::vec3 & target) const
+{
+	if (m_Keyframes.empty())
+	{
+		return;
+	}
+	if (time <= m_Keyframes.front().time || m_Keyframes.size() == 1)
+	{
+		position = m_Keyframes.front().position;
+		target = m_Keyframes.front().target;
+		return;
+	}
+	if (time >= m_Keyframes.back().time)
+	{
+		position = m_Keyframes.back().position;
+		target = m_Keyframes.back().target;
+		return;
+	}
+
+	size_t next = 1;
+	while (m_Keyframes[next].time < time)
+	{
+		next++;
+	}
+
+	//The neighbours either side shape the curve, the end keyframes stand in for themselves
+	const CameraKeyframe& k0 = m_Keyframes[next > 1 ? next - 2 : 0];
+	const CameraKeyframe& k1 = m_Keyframes[next - 1];
+	const CameraKeyframe& k2 = m_Keyframes[next];
+	const CameraKeyframe& k3 = m_Keyframes[next + 1 < m_Keyframes.size() ? next + 1 : next];
+
+	float t = (time - k1.time) / (k2.time - k1.time);
+	position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+	target = catmullRom(k0.target, k1.target, k2.target, k3.target, t);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm\glm.hpp>
+
+struct CameraKeyframe
+{
+	float time;
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+//Scripted camera movement for benchmarks, so every run looks at exactly the same frames
+class CameraPath
+{
+public:
+	//Keyframes have to be added in time order
+	void addKeyframe(float time, const glm::vec3& position, const glm::vec3& target);
+
+	//One keyframe per line, "time px py pz tx ty tz". Lines starting with # are skipped
+	bool loadFromFile(const std::string& filename);
+
+	//Catmull-Rom through the keyframes, held at the ends
+	void evaluate(float time, glm::vec3& position, glm::vec3& target) const;
+
+	float getDuration() const
+	{
+		return m_Keyframes.empty() ? 0.0f : m_Keyframes.back().time;
+	};
+
+	bool isEmpty() const
+	{
+		return m_Keyframes.empty();
+	};
+
+private:
+	std::vector<CameraKeyframe> m_Keyframes;
+};
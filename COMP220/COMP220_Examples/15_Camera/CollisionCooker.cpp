@@ -0,0 +1,291 @@
+#include "CollisionCooker.h"
+#include "MeshCooker.h"
+#include "Model.h"
+
+#include <cstdio>
+#include <SDL.h>
+#include <BulletCollision\CollisionShapes\btShapeHull.h>
+#include <BulletCollision\CollisionShapes\btScaledBvhTriangleMeshShape.h>
+
+std::string getCookedBvhFilename(const std::string & meshFilename)
+{
+	return meshFilename + COOKED_BVH_EXTENSION;
+}
+
+static double getMillisecondsSince(Uint64 start)
+{
+	return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+CollisionMesh::CollisionMesh()
+{
+	m_pTriangles = nullptr;
+	m_pTriangleMeshShape = nullptr;
+	m_pCookedBvhBuffer = nullptr;
+	m_pCookedBvh = nullptr;
+}
+
+CollisionMesh::~CollisionMesh()
+{
+	destroy();
+}
+
+bool CollisionMesh::load(const std::string & meshFilename)
+{
+	destroy();
+
+	std::vector<MeshData> meshData;
+	std::string cookedMeshFilename = getCookedMeshFilename(meshFilename);
+	bool loaded = !isCookedFileStale(meshFilename, cookedMeshFilename) && loadCookedMeshData(cookedMeshFilename, meshData);
+	if (!loaded && !importMeshData(meshFilename, meshData))
+	{
+		printf("Unable to load collision mesh %s\n", meshFilename.c_str());
+		return false;
+	}
+
+	//Every mesh goes into one triangle list, only the full detail LOD is used
+	for (const MeshData& data : meshData)
+	{
+		int firstVertex = (int)(m_Positions.size() / 3);
+		for (const PackedVertex& vertex : data.vertices)
+		{
+			m_Positions.push_back(vertex.x);
+			m_Positions.push_back(vertex.y);
+			m_Positions.push_back(vertex.z);
+		}
+
+		unsigned int numberOfIndices = data.lodIndexCounts.empty() ? (unsigned int)data.indices.size() : data.lodIndexCounts[0];
+		for (unsigned int i = 0; i < numberOfIndices; i++)
+		{
+			m_Indices.push_back(firstVertex + (int)data.indices[i]);
+		}
+	}
+
+	if (m_Indices.empty())
+	{
+		printf("Collision mesh %s has no triangles\n", meshFilename.c_str());
+		return false;
+	}
+
+	//Bullet reads the arrays where they are, the float positions are converted as it reads each triangle
+	btIndexedMesh indexedMesh;
+	indexedMesh.m_numTriangles = (int)m_Indices.size() / 3;
+	indexedMesh.m_triangleIndexBase = (const unsigned char*)m_Indices.data();
+	indexedMesh.m_triangleIndexStride = 3 * sizeof(int);
+	indexedMesh.m_numVertices = (int)m_Positions.size() / 3;
+	indexedMesh.m_vertexBase = (const unsigned char*)m_Positions.data();
+	indexedMesh.m_vertexStride = 3 * sizeof(float);
+	indexedMesh.m_vertexType = PHY_FLOAT;
+
+	m_pTriangles = new btTriangleIndexVertexArray();
+	m_pTriangles->addIndexedMesh(indexedMesh, PHY_INTEGER);
+
+	m_MeshFilename = meshFilename;
+	return true;
+}
+
+void CollisionMesh::destroy()
+{
+	//Scaled shapes were created after the shape they wrap, so go backwards
+	for (auto iter = m_Shapes.rbegin(); iter != m_Shapes.rend(); iter++)
+	{
+		delete (*iter);
+	}
+	m_Shapes.clear();
+	m_pTriangleMeshShape = nullptr;
+
+	//A tree built at runtime belongs to its shape, a cooked one lives in our buffer
+	if (m_pCookedBvh != nullptr)
+	{
+		m_pCookedBvh->~btOptimizedBvh();
+		m_pCookedBvh = nullptr;
+	}
+	if (m_pCookedBvhBuffer != nullptr)
+	{
+		btAlignedFree(m_pCookedBvhBuffer);
+		m_pCookedBvhBuffer = nullptr;
+	}
+
+	if (m_pTriangles != nullptr)
+	{
+		delete m_pTriangles;
+		m_pTriangles = nullptr;
+	}
+
+	m_Positions.clear();
+	m_Indices.clear();
+	m_MeshFilename.clear();
+}
+
+btCollisionShape * CollisionMesh::createConvexHullShape(const glm::vec3 & scale)
+{
+	if (m_pTriangles == nullptr)
+	{
+		return nullptr;
+	}
+
+	btConvexHullShape fullHull;
+	for (size_t i = 0; i < m_Positions.size(); i += 3)
+	{
+		fullHull.addPoint(btVector3(m_Positions[i], m_Positions[i + 1], m_Positions[i + 2]), false);
+	}
+	fullHull.recalcLocalAabb();
+
+	//Keeps only the points on the hull's surface that matter, thousands of render vertices become a few dozen
+	btShapeHull shapeHull(&fullHull);
+	if (!shapeHull.buildHull(fullHull.getMargin()))
+	{
+		printf("Unable to build convex hull for %s\n", m_MeshFilename.c_str());
+		return nullptr;
+	}
+
+	btConvexHullShape * pShape = new btConvexHullShape((const btScalar*)shapeHull.getVertexPointer(), shapeHull.numVertices(), sizeof(btVector3));
+	pShape->setLocalScaling(btVector3(scale.x, scale.y, scale.z));
+	m_Shapes.push_back(pShape);
+
+	printf("%s convex hull: %u vertices -> %d\n", m_MeshFilename.c_str(), (unsigned int)m_Positions.size() / 3, shapeHull.numVertices());
+	return pShape;
+}
+
+btCollisionShape * CollisionMesh::createTriangleMeshShape(const glm::vec3 & scale)
+{
+	if (m_pTriangles == nullptr)
+	{
+		return nullptr;
+	}
+
+	if (m_pTriangleMeshShape == nullptr)
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		std::string cookedFilename = getCookedBvhFilename(m_MeshFilename);
+		if (!isCookedFileStale(m_MeshFilename, cookedFilename) && loadCookedBvh(cookedFilename))
+		{
+			m_pTriangleMeshShape = new btBvhTriangleMeshShape(m_pTriangles, true, false);
+			m_pTriangleMeshShape->setOptimizedBvh(m_pCookedBvh);
+			printf("%s: loaded cooked BVH for %u triangles in %.2fms\n", m_MeshFilename.c_str(), getNumberOfTriangles(), getMillisecondsSince(start));
+		}
+		else
+		{
+			m_pTriangleMeshShape = new btBvhTriangleMeshShape(m_pTriangles, true, true);
+			printf("%s: built BVH for %u triangles in %.2fms\n", m_MeshFilename.c_str(), getNumberOfTriangles(), getMillisecondsSince(start));
+			writeCookedBvh(cookedFilename);
+		}
+		m_Shapes.push_back(m_pTriangleMeshShape);
+	}
+
+	if (scale == glm::vec3(1.0f))
+	{
+		return m_pTriangleMeshShape;
+	}
+
+	btScaledBvhTriangleMeshShape * pScaledShape = new btScaledBvhTriangleMeshShape(m_pTriangleMeshShape, btVector3(scale.x, scale.y, scale.z));
+	m_Shapes.push_back(pScaledShape);
+	return pScaledShape;
+}
+
+bool CollisionMesh::cookBvh()
+{
+	if (m_pTriangles == nullptr)
+	{
+		return false;
+	}
+
+	if (m_pTriangleMeshShape == nullptr)
+	{
+		m_pTriangleMeshShape = new btBvhTriangleMeshShape(m_pTriangles, true, true);
+		m_Shapes.push_back(m_pTriangleMeshShape);
+	}
+	return writeCookedBvh(getCookedBvhFilename(m_MeshFilename));
+}
+
+bool CollisionMesh::loadCookedBvh(const std::string & cookedFilename)
+{
+	FILE * pFile = fopen(cookedFilename.c_str(), "rb");
+	if (pFile == nullptr)
+	{
+		return false;
+	}
+
+	CookedBvhHeader header;
+	if (fread(&header, 1, sizeof(CookedBvhHeader), pFile) != sizeof(CookedBvhHeader) ||
+		header.magic != COOKED_BVH_MAGIC || header.version != COOKED_BVH_VERSION || header.scalarSize != sizeof(btScalar))
+	{
+		printf("Cooked BVH %s is out of date, ignoring it\n", cookedFilename.c_str());
+		fclose(pFile);
+		return false;
+	}
+
+	if (header.numberOfVertices != m_Positions.size() / 3 || header.numberOfTriangles != getNumberOfTriangles())
+	{
+		printf("Cooked BVH %s was built for different triangles, ignoring it\n", cookedFilename.c_str());
+		fclose(pFile);
+		return false;
+	}
+
+	//Deserialising fixes up the tree's pointers and vtable inside the buffer, so it is read into writable memory rather than mapped
+	m_pCookedBvhBuffer = btAlignedAlloc(header.bvhSize, COOKED_BVH_ALIGNMENT);
+	size_t read = fread(m_pCookedBvhBuffer, 1, header.bvhSize, pFile);
+	fclose(pFile);
+
+	if (read == header.bvhSize)
+	{
+		m_pCookedBvh = btOptimizedBvh::deSerializeInPlace(m_pCookedBvhBuffer, header.bvhSize, false);
+	}
+	if (m_pCookedBvh == nullptr)
+	{
+		printf("Cooked BVH %s is truncated\n", cookedFilename.c_str());
+		btAlignedFree(m_pCookedBvhBuffer);
+		m_pCookedBvhBuffer = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool CollisionMesh::writeCookedBvh(const std::string & cookedFilename)
+{
+	btOptimizedBvh * pBvh = m_pTriangleMeshShape->getOptimizedBvh();
+
+	CookedBvhHeader header = {};
+	header.magic = COOKED_BVH_MAGIC;
+	header.version = COOKED_BVH_VERSION;
+	header.scalarSize = sizeof(btScalar);
+	header.numberOfVertices = (uint32_t)m_Positions.size() / 3;
+	header.numberOfTriangles = getNumberOfTriangles();
+	header.bvhSize = pBvh->calculateSerializeBufferSize();
+
+	void * pBuffer = btAlignedAlloc(header.bvhSize, COOKED_BVH_ALIGNMENT);
+	bool serialised = pBvh->serializeInPlace(pBuffer, header.bvhSize, false);
+
+	FILE * pFile = serialised ? fopen(cookedFilename.c_str(), "wb") : nullptr;
+	if (pFile == nullptr)
+	{
+		printf("Could not write cooked BVH %s\n", cookedFilename.c_str());
+		btAlignedFree(pBuffer);
+		return false;
+	}
+
+	size_t written = fwrite(&header, 1, sizeof(CookedBvhHeader), pFile);
+	written += fwrite(pBuffer, 1, header.bvhSize, pFile);
+	fclose(pFile);
+	btAlignedFree(pBuffer);
+
+	if (written != sizeof(CookedBvhHeader) + header.bvhSize)
+	{
+		printf("Failed writing cooked BVH %s\n", cookedFilename.c_str());
+		remove(cookedFilename.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool cookCollisionFile(const std::string & sourceFilename)
+{
+	CollisionMesh collisionMesh;
+	if (!collisionMesh.load(sourceFilename) || !collisionMesh.cookBvh())
+	{
+		return false;
+	}
+
+	printf("Cooked %s -> %s (%u triangles)\n", sourceFilename.c_str(), getCookedBvhFilename(sourceFilename).c_str(), collisionMesh.getNumberOfTriangles());
+	return true;
+}
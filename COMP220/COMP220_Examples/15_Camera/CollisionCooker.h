@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glm\glm.hpp>
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision\CollisionShapes\btOptimizedBvh.h>
+
+//Static triangle mesh shapes keep their quantised BVH in a cooked file next to the model, so big meshes don't
+//rebuild the tree every launch. The file is a small header followed by the tree exactly as Bullet serialises it
+#define COOKED_BVH_MAGIC 0x48564243
+#define COOKED_BVH_VERSION 1
+#define COOKED_BVH_EXTENSION ".bvh"
+//Bullet's in place serialisation needs the tree on a 16 byte boundary
+#define COOKED_BVH_ALIGNMENT 16
+
+struct CookedBvhHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	//The tree's layout changes with Bullet's double precision build option
+	uint32_t scalarSize;
+	//Must match the triangles the tree was built over
+	uint32_t numberOfVertices;
+	uint32_t numberOfTriangles;
+	uint32_t bvhSize;
+	//Keeps the tree aligned after the header
+	uint32_t padding[2];
+};
+
+std::string getCookedBvhFilename(const std::string& meshFilename);
+
+//Collision geometry built from the full detail triangles of a model's render meshes. Shapes created from it
+//point into its vertex and index arrays, so it owns every shape it creates and deletes them in destroy
+class CollisionMesh
+{
+public:
+	CollisionMesh();
+	~CollisionMesh();
+
+	//Reads the model through its cooked mesh when that is up to date, otherwise through Assimp
+	bool load(const std::string& meshFilename);
+	void destroy();
+
+	//Convex hull of every vertex, cut down by btShapeHull to a few dozen points. Suited to dynamic bodies
+	btCollisionShape * createConvexHullShape(const glm::vec3& scale = glm::vec3(1.0f));
+
+	//The exact triangles, for static bodies only. Every call shares one tree, scaled shapes wrap it rather than rebuilding.
+	//The tree comes from the cooked file when that is newer than the model, otherwise it is built and cooked for next time
+	btCollisionShape * createTriangleMeshShape(const glm::vec3& scale = glm::vec3(1.0f));
+
+	//Writes the triangle mesh's tree to the cooked file, building it first if no shape has been created yet
+	bool cookBvh();
+
+	unsigned int getNumberOfTriangles()
+	{
+		return (unsigned int)m_Indices.size() / 3;
+	};
+
+private:
+	bool loadCookedBvh(const std::string& cookedFilename);
+	bool writeCookedBvh(const std::string& cookedFilename);
+
+	std::string m_MeshFilename;
+	std::vector<float> m_Positions;
+	std::vector<int> m_Indices;
+	btTriangleIndexVertexArray * m_pTriangles;
+
+	btBvhTriangleMeshShape * m_pTriangleMeshShape;
+	//A cooked tree is patched in place, so its buffer has to live as long as the shape using it
+	void * m_pCookedBvhBuffer;
+	btOptimizedBvh * m_pCookedBvh;
+
+	std::vector<btCollisionShape*> m_Shapes;
+};
+
+//Offline cook of a model's collision tree, used by -cook alongside cookMeshFile
+bool cookCollisionFile(const std::string& sourceFilename);
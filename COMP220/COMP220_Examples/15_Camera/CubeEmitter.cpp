@@ -0,0 +1,25 @@
+#include "CubeEmitter.h"
+
+CubeEmitter::CubeEmitter()
+{
+	m_HalfExtents = glm::vec3(1.0f);
+	m_Direction = glm::vec3(0.0f, 1.0f, 0.0f);
+	m_Spread = 0.0f;
+}
+
+void CubeEmitter::emitParticles(unsigned int first, unsigned int count)
+{
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		glm::vec3 offset(randomRange(-m_HalfExtents.x, m_HalfExtents.x), randomRange(-m_HalfExtents.y, m_HalfExtents.y), randomRange(-m_HalfExtents.z, m_HalfExtents.z));
+
+		//Blending towards a random direction tilts the particle by roughly the spread angle
+		glm::vec3 direction = m_Direction;
+		if (m_Spread > 0.0f)
+		{
+			direction = glm::normalize(m_Direction + randomDirection() * glm::tan(glm::min(m_Spread, 1.5f)) * randomFloat());
+		}
+
+		setParticle(i, m_Position + offset, direction * randomRange(m_Settings.minSpeed, m_Settings.maxSpeed));
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ParticleEmitter.h"
+
+//Spawns particles anywhere inside a box centred on the emitter, all heading roughly the same way. Snow,
+//rain or dust drifting over an area
+class CubeEmitter : public ParticleEmitter
+{
+public:
+	CubeEmitter();
+
+	void setHalfExtents(const glm::vec3& halfExtents)
+	{
+		m_HalfExtents = halfExtents;
+	};
+
+	//Particles head along direction, turned away from it by up to spread radians
+	void setDirection(const glm::vec3& direction, float spread)
+	{
+		m_Direction = glm::normalize(direction);
+		m_Spread = spread;
+	};
+
+protected:
+	void emitParticles(unsigned int first, unsigned int count) override;
+
+private:
+	glm::vec3 m_HalfExtents;
+	glm::vec3 m_Direction;
+	float m_Spread;
+};
@@ -0,0 +1,535 @@
+#include "EntityStore.h"
+
+//Same material GameObject starts with
+static const glm::vec4 defaultAmbientColour = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+static const glm::vec4 defaultDiffuseColour = glm::vec4(0.6f, 0.6f, 0.6f, 1.0f);
+static const glm::vec4 defaultSpecularColour = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+static const float defaultSpecularPower = 25.0f;
+
+//Fills a hole in a pool array with its last element
+template<typename T>
+static void removeAt(std::vector<T>& values, uint32_t slot)
+{
+	values[slot] = values.back();
+	values.pop_back();
+}
+
+uint32_t SparseIndex::add(Entity entity)
+{
+	uint32_t entityIndex = entity & ENTITY_INDEX_MASK;
+	if (entityIndex >= m_Slots.size())
+	{
+		m_Slots.resize(entityIndex + 1, INVALID_SLOT);
+	}
+
+	uint32_t slot = (uint32_t)m_Entities.size();
+	m_Slots[entityIndex] = slot;
+	m_Entities.push_back(entity);
+	return slot;
+}
+
+uint32_t SparseIndex::remove(Entity entity)
+{
+	uint32_t slot = find(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return INVALID_SLOT;
+	}
+
+	//Moving the last entity before clearing the removed one also works when they are the same
+	Entity lastEntity = m_Entities.back();
+	m_Entities[slot] = lastEntity;
+	m_Slots[lastEntity & ENTITY_INDEX_MASK] = slot;
+	m_Entities.pop_back();
+	m_Slots[entity & ENTITY_INDEX_MASK] = INVALID_SLOT;
+	return slot;
+}
+
+uint32_t SparseIndex::find(Entity entity) const
+{
+	uint32_t entityIndex = entity & ENTITY_INDEX_MASK;
+	if (entityIndex >= m_Slots.size())
+	{
+		return INVALID_SLOT;
+	}
+
+	uint32_t slot = m_Slots[entityIndex];
+	if (slot == INVALID_SLOT || m_Entities[slot] != entity)
+	{
+		return INVALID_SLOT;
+	}
+	return slot;
+}
+
+void SparseIndex::clear()
+{
+	m_Slots.clear();
+	m_Entities.clear();
+}
+
+EntityStore::EntityStore()
+{
+}
+
+EntityStore::~EntityStore()
+{
+}
+
+Entity EntityStore::createEntity(const glm::vec3 & position, const glm::quat & orientation, const glm::vec3 & scale)
+{
+	uint32_t entityIndex;
+	if (!m_FreeIndices.empty())
+	{
+		entityIndex = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+	}
+	else
+	{
+		entityIndex = (uint32_t)m_Generations.size();
+		m_Generations.push_back(0);
+	}
+
+	Entity entity = ((uint32_t)m_Generations[entityIndex] << ENTITY_INDEX_BITS) | entityIndex;
+
+	m_Transforms.index.add(entity);
+	m_Transforms.positions.push_back(position);
+	m_Transforms.orientations.push_back(orientation);
+	m_Transforms.scales.push_back(scale);
+	m_Transforms.worldMatrices.push_back(glm::mat4(1.0f));
+	m_Transforms.dirty.push_back(1);
+	m_Transforms.moved.push_back(0);
+	return entity;
+}
+
+void EntityStore::destroyEntity(Entity entity)
+{
+	if (!isAlive(entity))
+	{
+		return;
+	}
+
+	removeRenderable(entity);
+	removeRigidBody(entity);
+	removeMaterial(entity);
+	removeTransform(entity);
+
+	uint32_t entityIndex = entity & ENTITY_INDEX_MASK;
+	m_Generations[entityIndex]++;
+	m_FreeIndices.push_back(entityIndex);
+}
+
+bool EntityStore::isAlive(Entity entity) const
+{
+	return m_Transforms.index.find(entity) != INVALID_SLOT;
+}
+
+void EntityStore::setPosition(Entity entity, const glm::vec3 & position)
+{
+	uint32_t slot = m_Transforms.index.find(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	m_Transforms.positions[slot] = position;
+	m_Transforms.dirty[slot] = 1;
+}
+
+void EntityStore::setOrientation(Entity entity, const glm::quat & orientation)
+{
+	uint32_t slot = m_Transforms.index.find(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	m_Transforms.orientations[slot] = orientation;
+	m_Transforms.dirty[slot] = 1;
+}
+
+void EntityStore::setScale(Entity entity, const glm::vec3 & scale)
+{
+	uint32_t slot = m_Transforms.index.find(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	m_Transforms.scales[slot] = scale;
+	m_Transforms.dirty[slot] = 1;
+}
+
+const glm::mat4 & EntityStore::getWorldMatrix(Entity entity)
+{
+	//Entities without a transform sit at the origin
+	static const glm::mat4 identity(1.0f);
+	uint32_t slot = m_Transforms.index.find(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return identity;
+	}
+
+	return m_Transforms.worldMatrices[slot];
+}
+
+void EntityStore::addRenderable(Entity entity, MeshGroup * pMeshes, ShaderProgram * pProgram, GLuint texture)
+{
+	//Renderables are placed by their transform, so the entity needs one first
+	uint32_t transformSlot = m_Transforms.index.find(entity);
+	if (transformSlot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	removeRenderable(entity);
+
+	AABB box;
+	BoundingSphere sphere;
+	computeMeshGroupBounds(pMeshes, box, sphere);
+
+	m_Renderables.index.add(entity);
+	m_Renderables.meshes.push_back(pMeshes);
+	m_Renderables.programs.push_back(pProgram);
+	m_Renderables.textures.push_back(texture);
+	m_Renderables.localSpheres.push_back(sphere);
+	m_Renderables.worldSpheres.push_back(sphere);
+	m_Renderables.lods.push_back(0);
+	m_Renderables.transformSlots.push_back(transformSlot);
+	m_Renderables.materialSlots.push_back(m_Materials.index.find(entity));
+
+	//Resolving the program variants now means submit never has to build one, so it can run on any thread
+	if (pMeshes != nullptr && pProgram != nullptr)
+	{
+		for (Mesh * pMesh : *pMeshes)
+		{
+			pProgram->getVariant(pMesh->getVertexFormat());
+		}
+	}
+
+	//Forces the bounds pass to place the new sphere
+	m_Transforms.dirty[transformSlot] = 1;
+}
+
+void EntityStore::setLocalBounds(Entity entity, const BoundingSphere & sphere)
+{
+	uint32_t slot = m_Renderables.index.find(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	m_Renderables.localSpheres[slot] = sphere;
+	m_Transforms.dirty[m_Renderables.transformSlots[slot]] = 1;
+}
+
+void EntityStore::addMaterial(Entity entity, const glm::vec4 & ambient, const glm::vec4 & diffuse, const glm::vec4 & specular, float specularPower)
+{
+	uint32_t slot = m_Materials.index.find(entity);
+	if (slot == INVALID_SLOT)
+	{
+		slot = m_Materials.index.add(entity);
+		m_Materials.ambientColours.push_back(ambient);
+		m_Materials.diffuseColours.push_back(diffuse);
+		m_Materials.specularColours.push_back(specular);
+		m_Materials.specularPowers.push_back(specularPower);
+
+		uint32_t renderSlot = m_Renderables.index.find(entity);
+		if (renderSlot != INVALID_SLOT)
+		{
+			m_Renderables.materialSlots[renderSlot] = slot;
+		}
+		return;
+	}
+
+	m_Materials.ambientColours[slot] = ambient;
+	m_Materials.diffuseColours[slot] = diffuse;
+	m_Materials.specularColours[slot] = specular;
+	m_Materials.specularPowers[slot] = specularPower;
+}
+
+void EntityStore::addRigidBody(Entity entity, btRigidBody * pBody, btDynamicsWorld * pWorld)
+{
+	uint32_t transformSlot = m_Transforms.index.find(entity);
+	if (transformSlot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	removeRigidBody(entity);
+
+	m_RigidBodies.index.add(entity);
+	m_RigidBodies.bodies.push_back(pBody);
+	m_RigidBodies.worlds.push_back(pWorld);
+	m_RigidBodies.transformSlots.push_back(transformSlot);
+	pWorld->addRigidBody(pBody);
+}
+
+void EntityStore::update()
+{
+	//Bullet only moves active bodies, sleeping ones keep the transform they already have
+	//Every body has its own transform slot, so the jobs never write the same one
+	JobSystem::get().parallelFor(0, m_RigidBodies.index.size(), ENTITY_JOB_GRAIN, [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			btRigidBody * pBody = m_RigidBodies.bodies[i];
+			if (!pBody->isActive())
+			{
+				continue;
+			}
+
+			//The motion state holds the transform interpolated between the last two physics steps
+			btTransform transform = pBody->getWorldTransform();
+			if (pBody->getMotionState() != nullptr)
+			{
+				pBody->getMotionState()->getWorldTransform(transform);
+			}
+
+			const btVector3& origin = transform.getOrigin();
+			btQuaternion rotation = transform.getRotation();
+
+			uint32_t slot = m_RigidBodies.transformSlots[i];
+			m_Transforms.positions[slot] = glm::vec3(origin.getX(), origin.getY(), origin.getZ());
+			m_Transforms.orientations[slot] = glm::quat(rotation.getW(), rotation.getX(), rotation.getY(), rotation.getZ());
+			m_Transforms.dirty[slot] = 1;
+		}
+	});
+
+	//Rotation matrix with the scale folded into its columns, then the translation, without any full matrix multiplies
+	JobSystem::get().parallelFor(0, m_Transforms.index.size(), ENTITY_JOB_GRAIN, [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			if (!m_Transforms.dirty[i])
+			{
+				m_Transforms.moved[i] = 0;
+				continue;
+			}
+
+			const glm::vec3& scale = m_Transforms.scales[i];
+			glm::mat4 worldMatrix = glm::mat4_cast(m_Transforms.orientations[i]);
+			worldMatrix[0] *= scale.x;
+			worldMatrix[1] *= scale.y;
+			worldMatrix[2] *= scale.z;
+			worldMatrix[3] = glm::vec4(m_Transforms.positions[i], 1.0f);
+
+			m_Transforms.worldMatrices[i] = worldMatrix;
+			m_Transforms.dirty[i] = 0;
+			m_Transforms.moved[i] = 1;
+		}
+	});
+
+	JobSystem::get().parallelFor(0, m_Renderables.index.size(), ENTITY_JOB_GRAIN, [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			uint32_t transformSlot = m_Renderables.transformSlots[i];
+			if (m_Transforms.moved[transformSlot])
+			{
+				m_Renderables.worldSpheres[i] = transformBounds(m_Renderables.localSpheres[i], m_Transforms.worldMatrices[transformSlot]);
+			}
+		}
+	});
+}
+
+unsigned int EntityStore::addToCuller(FrustumCuller & culler)
+{
+	unsigned int firstCullIndex = 0;
+	uint32_t numberOfRenderables = m_Renderables.index.size();
+	for (uint32_t i = 0; i < numberOfRenderables; i++)
+	{
+		unsigned int cullIndex = culler.addSphere(m_Renderables.worldSpheres[i]);
+		if (i == 0)
+		{
+			firstCullIndex = cullIndex;
+		}
+	}
+	return firstCullIndex;
+}
+
+void EntityStore::submit(RenderQueue & renderQueue, FrustumCuller & culler, unsigned int firstCullIndex)
+{
+	uint32_t numberOfRenderables = m_Renderables.index.size();
+	unsigned int numberOfChunks = (numberOfRenderables + ENTITY_JOB_GRAIN - 1) / ENTITY_JOB_GRAIN;
+	if (numberOfChunks <= 1)
+	{
+		submitRange(renderQueue, culler, firstCullIndex, 0, numberOfRenderables);
+		return;
+	}
+
+	if (m_SubmitQueues.size() < numberOfChunks)
+	{
+		m_SubmitQueues.resize(numberOfChunks);
+	}
+
+	JobSystem::get().parallelFor(0, numberOfChunks, 1, [&](unsigned int firstChunk, unsigned int lastChunk)
+	{
+		for (unsigned int chunk = firstChunk; chunk < lastChunk; chunk++)
+		{
+			uint32_t begin = chunk * ENTITY_JOB_GRAIN;
+			uint32_t end = begin + ENTITY_JOB_GRAIN < numberOfRenderables ? begin + ENTITY_JOB_GRAIN : numberOfRenderables;
+			m_SubmitQueues[chunk].begin(renderQueue.getViewMatrix(), renderQueue.getProjectionMatrix(), renderQueue.getFarPlane());
+			submitRange(m_SubmitQueues[chunk], culler, firstCullIndex, begin, end);
+		}
+	});
+
+	for (unsigned int chunk = 0; chunk < numberOfChunks; chunk++)
+	{
+		renderQueue.append(m_SubmitQueues[chunk]);
+	}
+}
+
+void EntityStore::submitRange(RenderQueue & renderQueue, FrustumCuller & culler, unsigned int firstCullIndex, uint32_t begin, uint32_t end)
+{
+	InstanceData instance;
+	instance.ambientMaterialColour = defaultAmbientColour;
+	instance.diffuseMaterialColour = defaultDiffuseColour;
+	instance.specularMaterialColour = defaultSpecularColour;
+	instance.specularPower = defaultSpecularPower;
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		if (!culler.isVisible(firstCullIndex + i))
+		{
+			continue;
+		}
+
+		instance.modelMatrix = m_Transforms.worldMatrices[m_Renderables.transformSlots[i]];
+
+		uint32_t materialSlot = m_Renderables.materialSlots[i];
+		if (materialSlot != INVALID_SLOT)
+		{
+			instance.ambientMaterialColour = m_Materials.ambientColours[materialSlot];
+			instance.diffuseMaterialColour = m_Materials.diffuseColours[materialSlot];
+			instance.specularMaterialColour = m_Materials.specularColours[materialSlot];
+			instance.specularPower = m_Materials.specularPowers[materialSlot];
+		}
+		else
+		{
+			instance.ambientMaterialColour = defaultAmbientColour;
+			instance.diffuseMaterialColour = defaultDiffuseColour;
+			instance.specularMaterialColour = defaultSpecularColour;
+			instance.specularPower = defaultSpecularPower;
+		}
+
+		unsigned int lod = selectLod(renderQueue.getScreenCoverage(m_Renderables.worldSpheres[i]), m_Renderables.lods[i], MAX_MESH_LODS);
+		m_Renderables.lods[i] = (unsigned char)lod;
+
+		renderQueue.submit(m_Renderables.meshes[i], m_Renderables.programs[i], m_Renderables.textures[i], instance, RENDER_PASS_OPAQUE, lod);
+	}
+}
+
+void EntityStore::clear()
+{
+	while (m_Transforms.index.size() > 0)
+	{
+		destroyEntity(m_Transforms.index.getEntity(m_Transforms.index.size() - 1));
+	}
+	m_Generations.clear();
+	m_FreeIndices.clear();
+}
+
+//Removing from a pool moves its last entity into the freed slot, so any other pool caching that slot is patched
+void EntityStore::removeTransform(Entity entity)
+{
+	uint32_t slot = m_Transforms.index.remove(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	removeAt(m_Transforms.positions, slot);
+	removeAt(m_Transforms.orientations, slot);
+	removeAt(m_Transforms.scales, slot);
+	removeAt(m_Transforms.worldMatrices, slot);
+	removeAt(m_Transforms.dirty, slot);
+	removeAt(m_Transforms.moved, slot);
+
+	if (slot < m_Transforms.index.size())
+	{
+		Entity movedEntity = m_Transforms.index.getEntity(slot);
+
+		uint32_t renderSlot = m_Renderables.index.find(movedEntity);
+		if (renderSlot != INVALID_SLOT)
+		{
+			m_Renderables.transformSlots[renderSlot] = slot;
+		}
+
+		uint32_t bodySlot = m_RigidBodies.index.find(movedEntity);
+		if (bodySlot != INVALID_SLOT)
+		{
+			m_RigidBodies.transformSlots[bodySlot] = slot;
+		}
+	}
+}
+
+void EntityStore::removeRenderable(Entity entity)
+{
+	uint32_t slot = m_Renderables.index.find(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	//Releasing handles the cache never gave out is harmless, so entities built without assets are fine
+	AssetCache::get().releaseMeshes(m_Renderables.meshes[slot]);
+	AssetCache::get().releaseShaderProgram(m_Renderables.programs[slot]);
+	AssetCache::get().releaseTexture(m_Renderables.textures[slot]);
+
+	m_Renderables.index.remove(entity);
+	removeAt(m_Renderables.meshes, slot);
+	removeAt(m_Renderables.programs, slot);
+	removeAt(m_Renderables.textures, slot);
+	removeAt(m_Renderables.localSpheres, slot);
+	removeAt(m_Renderables.worldSpheres, slot);
+	removeAt(m_Renderables.lods, slot);
+	removeAt(m_Renderables.transformSlots, slot);
+	removeAt(m_Renderables.materialSlots, slot);
+}
+
+void EntityStore::removeMaterial(Entity entity)
+{
+	uint32_t slot = m_Materials.index.remove(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	removeAt(m_Materials.ambientColours, slot);
+	removeAt(m_Materials.diffuseColours, slot);
+	removeAt(m_Materials.specularColours, slot);
+	removeAt(m_Materials.specularPowers, slot);
+
+	uint32_t renderSlot = m_Renderables.index.find(entity);
+	if (renderSlot != INVALID_SLOT)
+	{
+		m_Renderables.materialSlots[renderSlot] = INVALID_SLOT;
+	}
+
+	if (slot < m_Materials.index.size())
+	{
+		uint32_t movedRenderSlot = m_Renderables.index.find(m_Materials.index.getEntity(slot));
+		if (movedRenderSlot != INVALID_SLOT)
+		{
+			m_Renderables.materialSlots[movedRenderSlot] = slot;
+		}
+	}
+}
+
+void EntityStore::removeRigidBody(Entity entity)
+{
+	uint32_t slot = m_RigidBodies.index.remove(entity);
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+
+	btRigidBody * pBody = m_RigidBodies.bodies[slot];
+	m_RigidBodies.worlds[slot]->removeRigidBody(pBody);
+	delete pBody->getMotionState();
+	delete pBody;
+
+	removeAt(m_RigidBodies.bodies, slot);
+	removeAt(m_RigidBodies.worlds, slot);
+	removeAt(m_RigidBodies.transformSlots, slot);
+}
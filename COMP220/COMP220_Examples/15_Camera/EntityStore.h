@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm\glm.hpp>
+#include <glm\gtc\quaternion.hpp>
+#include <btBulletDynamicsCommon.h>
+
+#include "AssetCache.h"
+#include "Bounds.h"
+#include "FrustumCuller.h"
+#include "RenderQueue.h"
+#include "JobSystem.h"
+
+//Entities handed to each job by the update and submit passes
+#define ENTITY_JOB_GRAIN 1024
+
+//Handle to an entity, the low 24 bits are its index and the top 8 a generation
+//that is bumped when the index is reused, so stale handles can be detected
+typedef uint32_t Entity;
+#define INVALID_ENTITY 0xFFFFFFFF
+#define ENTITY_INDEX_BITS 24
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+
+#define INVALID_SLOT 0xFFFFFFFF
+
+//Maps entity indices to packed slots in a pool. Removing swaps the last slot into the hole so the pool stays dense
+class SparseIndex
+{
+public:
+	uint32_t add(Entity entity);
+	//Returns the slot the entity had, the last entity has been moved into it unless it was the last itself
+	uint32_t remove(Entity entity);
+	uint32_t find(Entity entity) const;
+
+	Entity getEntity(uint32_t slot) const
+	{
+		return m_Entities[slot];
+	};
+
+	uint32_t size() const
+	{
+		return (uint32_t)m_Entities.size();
+	};
+
+	void clear();
+
+private:
+	std::vector<uint32_t> m_Slots;
+	std::vector<Entity> m_Entities;
+};
+
+//Every entity has a transform
+struct TransformPool
+{
+	SparseIndex index;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> orientations;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::mat4> worldMatrices;
+	//Set by the setters, cleared once the world matrix has been rebuilt
+	std::vector<unsigned char> dirty;
+	//Set for one update when the world matrix changed, read by the bounds pass
+	std::vector<unsigned char> moved;
+};
+
+//Mesh, program and texture come from the asset cache and are released with the entity
+struct RenderPool
+{
+	SparseIndex index;
+	std::vector<MeshGroup*> meshes;
+	std::vector<ShaderProgram*> programs;
+	std::vector<GLuint> textures;
+	std::vector<BoundingSphere> localSpheres;
+	std::vector<BoundingSphere> worldSpheres;
+	//LOD drawn last frame, each submit job only touches its own range
+	std::vector<unsigned char> lods;
+	//Slots of the same entity in the other pools, so the render sweep never searches
+	std::vector<uint32_t> transformSlots;
+	std::vector<uint32_t> materialSlots;
+};
+
+//Entities without a material use the GameObject defaults
+struct MaterialPool
+{
+	SparseIndex index;
+	std::vector<glm::vec4> ambientColours;
+	std::vector<glm::vec4> diffuseColours;
+	std::vector<glm::vec4> specularColours;
+	std::vector<float> specularPowers;
+};
+
+//The store owns each body and its motion state and takes the body out of its world before deleting it.
+//Collision shapes are usually shared between bodies, so they stay with whoever created them
+struct RigidBodyPool
+{
+	SparseIndex index;
+	std::vector<btRigidBody*> bodies;
+	std::vector<btDynamicsWorld*> worlds;
+	std::vector<uint32_t> transformSlots;
+};
+
+//Structure of arrays storage for large numbers of simple objects. Each kind of component lives in its own
+//densely packed pool and every pass is a linear sweep over one or two of them, instead of chasing a
+//pointer to a separately allocated GameObject per object
+class EntityStore
+{
+public:
+	EntityStore();
+	~EntityStore();
+
+	Entity createEntity(const glm::vec3& position = glm::vec3(0.0f), const glm::quat& orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+	//Releases the entity's assets and deletes its rigid body if it has one
+	void destroyEntity(Entity entity);
+	bool isAlive(Entity entity) const;
+
+	void setPosition(Entity entity, const glm::vec3& position);
+	void setOrientation(Entity entity, const glm::quat& orientation);
+	void setScale(Entity entity, const glm::vec3& scale);
+	const glm::mat4& getWorldMatrix(Entity entity);
+
+	//Takes over references already acquired from the asset cache. Entities that aren't alive are ignored and the caller keeps them
+	void addRenderable(Entity entity, MeshGroup * pMeshes, ShaderProgram * pProgram, GLuint texture);
+	//Bounds to use when the entity has no meshes to take them from
+	void setLocalBounds(Entity entity, const BoundingSphere& sphere);
+	void addMaterial(Entity entity, const glm::vec4& ambient, const glm::vec4& diffuse, const glm::vec4& specular, float specularPower);
+	//Adds the body to pWorld and takes ownership of it and its motion state, but not its collision shape.
+	//Removing or destroying the entity takes the body out of the world again before deleting it
+	void addRigidBody(Entity entity, btRigidBody * pBody, btDynamicsWorld * pWorld);
+
+	//Copies active rigid bodies into their transforms, rebuilds dirty world matrices and moves the bounds of anything that moved.
+	//Each pass is split across the JobSystem
+	void update();
+
+	//Adds every renderable's bounds to the culler, returns the culler index of the first one
+	unsigned int addToCuller(FrustumCuller& culler);
+	//Submits the renderables that survived culling, firstCullIndex is the value addToCuller returned.
+	//Jobs fill a queue each and they're appended in order, so the result is the same as submitting on one thread
+	void submit(RenderQueue& renderQueue, FrustumCuller& culler, unsigned int firstCullIndex);
+
+	uint32_t getEntityCount()
+	{
+		return m_Transforms.index.size();
+	};
+
+	//Destroys every entity
+	void clear();
+
+private:
+	void removeTransform(Entity entity);
+	void removeRenderable(Entity entity);
+	void removeMaterial(Entity entity);
+	void removeRigidBody(Entity entity);
+
+	void submitRange(RenderQueue& renderQueue, FrustumCuller& culler, unsigned int firstCullIndex, uint32_t begin, uint32_t end);
+
+	std::vector<uint8_t> m_Generations;
+	std::vector<uint32_t> m_FreeIndices;
+
+	TransformPool m_Transforms;
+	RenderPool m_Renderables;
+	MaterialPool m_Materials;
+	RigidBodyPool m_RigidBodies;
+
+	//One per submit job, kept between frames so their arrays don't have to grow again
+	std::vector<RenderQueue> m_SubmitQueues;
+};
@@ -0,0 +1,77 @@
+#include "FrameTimer.h"
+
+FrameTimer::FrameTimer()
+{
+	m_Frequency = 1;
+	m_FrameStart = 0;
+	m_TargetFrameCounts = 0;
+	m_FixedTimeStep = DEFAULT_FIXED_TIME_STEP;
+	m_MaxSubSteps = DEFAULT_MAX_SUB_STEPS;
+	m_DeltaTime = 0.0f;
+	m_FrameTime = 0.0f;
+}
+
+FrameTimer::~FrameTimer()
+{
+}
+
+void FrameTimer::init(float fixedTimeStep, int maxSubSteps)
+{
+	m_Frequency = SDL_GetPerformanceFrequency();
+	m_FrameStart = SDL_GetPerformanceCounter();
+	m_FixedTimeStep = fixedTimeStep;
+	m_MaxSubSteps = maxSubSteps > 0 ? maxSubSteps : 1;
+	m_DeltaTime = 0.0f;
+	m_FrameTime = 0.0f;
+}
+
+void FrameTimer::setFrameRateLimit(int framesPerSecond)
+{
+	if (framesPerSecond <= 0)
+	{
+		m_TargetFrameCounts = 0;
+		return;
+	}
+	m_TargetFrameCounts = m_Frequency / framesPerSecond;
+}
+
+void FrameTimer::beginFrame()
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	m_FrameTime = (float)toSeconds(now - m_FrameStart);
+	m_FrameStart = now;
+
+	//Anything past this is dropped rather than simulated, otherwise a slow frame makes the next one slower
+	float maxDeltaTime = m_FixedTimeStep * m_MaxSubSteps;
+	m_DeltaTime = m_FrameTime < maxDeltaTime ? m_FrameTime : maxDeltaTime;
+}
+
+void FrameTimer::endFrame()
+{
+	if (m_TargetFrameCounts == 0)
+	{
+		return;
+	}
+
+	Uint64 frameEnd = m_FrameStart + m_TargetFrameCounts;
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (now >= frameEnd)
+	{
+		return;
+	}
+
+	//SDL_Delay can oversleep by a millisecond or two, so sleep short and spin for the remainder
+	Uint32 sleepMilliseconds = (Uint32)(toSeconds(frameEnd - now) * 1000.0);
+	if (sleepMilliseconds > 2)
+	{
+		SDL_Delay(sleepMilliseconds - 2);
+	}
+	while (SDL_GetPerformanceCounter() < frameEnd)
+	{
+	}
+}
+
+double FrameTimer::toSeconds(Uint64 counts)
+{
+	return (double)counts / (double)m_Frequency;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <SDL.h>
+
+//Default physics rate and the most fixed steps a single frame may run to catch up
+#define DEFAULT_FIXED_TIME_STEP (1.0f / 60.0f)
+#define DEFAULT_MAX_SUB_STEPS 4
+
+//Measures frame times with the high resolution counter and paces the main loop.
+//The simulation always advances in fixed steps, the frame delta just decides how many are due.
+//Bullet keeps the accumulator itself when given (deltaTime, maxSubSteps, fixedTimeStep) and interpolates
+//the motion states between its last two steps, so rendering is smooth at any frame rate
+class FrameTimer
+{
+public:
+	FrameTimer();
+	~FrameTimer();
+
+	void init(float fixedTimeStep = DEFAULT_FIXED_TIME_STEP, int maxSubSteps = DEFAULT_MAX_SUB_STEPS);
+
+	//0 turns the limiter off, otherwise endFrame() sleeps until the frame has taken 1/framesPerSecond
+	void setFrameRateLimit(int framesPerSecond);
+
+	//Measures the time since the last beginFrame(), clamped so a long stall can't queue up more than maxSubSteps of simulation
+	void beginFrame();
+
+	//Waits out the rest of the frame when the limiter is on
+	void endFrame();
+
+	float getDeltaTime()
+	{
+		return m_DeltaTime;
+	};
+
+	float getFixedTimeStep()
+	{
+		return m_FixedTimeStep;
+	};
+
+	int getMaxSubSteps()
+	{
+		return m_MaxSubSteps;
+	};
+
+	//Real time the last frame took in milliseconds, including any limiter wait
+	float getFrameTimeMilliseconds()
+	{
+		return m_FrameTime * 1000.0f;
+	};
+
+private:
+	double toSeconds(Uint64 counts);
+
+	Uint64 m_Frequency;
+	Uint64 m_FrameStart;
+	Uint64 m_TargetFrameCounts;
+
+	float m_FixedTimeStep;
+	int m_MaxSubSteps;
+
+	float m_DeltaTime;
+	float m_FrameTime;
+};
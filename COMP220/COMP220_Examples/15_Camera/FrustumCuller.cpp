@@ -0,0 +1,117 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define FRUSTUM_CULLER_SSE
+#endif
+
+FrustumCuller::FrustumCuller()
+{
+	m_SphereCount = 0;
+	m_CulledCount = 0;
+}
+
+void FrustumCuller::begin(const glm::mat4 & viewProjectionMatrix)
+{
+	//Gribb and Hartmann plane extraction, each plane is a sum or difference of the fourth row with another row
+	glm::vec4 row0(viewProjectionMatrix[0][0], viewProjectionMatrix[1][0], viewProjectionMatrix[2][0], viewProjectionMatrix[3][0]);
+	glm::vec4 row1(viewProjectionMatrix[0][1], viewProjectionMatrix[1][1], viewProjectionMatrix[2][1], viewProjectionMatrix[3][1]);
+	glm::vec4 row2(viewProjectionMatrix[0][2], viewProjectionMatrix[1][2], viewProjectionMatrix[2][2], viewProjectionMatrix[3][2]);
+	glm::vec4 row3(viewProjectionMatrix[0][3], viewProjectionMatrix[1][3], viewProjectionMatrix[2][3], viewProjectionMatrix[3][3]);
+
+	m_Planes[0] = row3 + row0;
+	m_Planes[1] = row3 - row0;
+	m_Planes[2] = row3 + row1;
+	m_Planes[3] = row3 - row1;
+	m_Planes[4] = row3 + row2;
+	m_Planes[5] = row3 - row2;
+
+	//Normalise so the plane distance is in world units and can be compared with a radius
+	for (int i = 0; i < 6; i++)
+	{
+		m_Planes[i] /= glm::length(glm::vec3(m_Planes[i]));
+	}
+
+	m_CentreX.clear();
+	m_CentreY.clear();
+	m_CentreZ.clear();
+	m_Radius.clear();
+	m_SphereCount = 0;
+	m_CulledCount = 0;
+}
+
+unsigned int FrustumCuller::addSphere(const BoundingSphere & sphere)
+{
+	m_CentreX.push_back(sphere.centre.x);
+	m_CentreY.push_back(sphere.centre.y);
+	m_CentreZ.push_back(sphere.centre.z);
+	m_Radius.push_back(sphere.radius);
+	return m_SphereCount++;
+}
+
+void FrustumCuller::cull()
+{
+	//Pad to a multiple of four so the SIMD loop never needs a scalar tail, padding spheres are never read back
+	unsigned int paddedCount = (m_SphereCount + 3) & ~3u;
+	m_CentreX.resize(paddedCount, 0.0f);
+	m_CentreY.resize(paddedCount, 0.0f);
+	m_CentreZ.resize(paddedCount, 0.0f);
+	m_Radius.resize(paddedCount, 0.0f);
+	m_Visible.resize(paddedCount);
+
+	//Groups of four spheres are independent, so they're split across the JobSystem
+	JobSystem::get().parallelFor(0, paddedCount / 4, FRUSTUM_CULLER_JOB_GRAIN, [this](unsigned int firstGroup, unsigned int lastGroup)
+	{
+#ifdef FRUSTUM_CULLER_SSE
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; p++)
+		{
+			planeX[p] = _mm_set1_ps(m_Planes[p].x);
+			planeY[p] = _mm_set1_ps(m_Planes[p].y);
+			planeZ[p] = _mm_set1_ps(m_Planes[p].z);
+			planeW[p] = _mm_set1_ps(m_Planes[p].w);
+		}
+
+		for (unsigned int i = firstGroup * 4; i < lastGroup * 4; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&m_CentreX[i]);
+			__m128 y = _mm_loadu_ps(&m_CentreY[i]);
+			__m128 z = _mm_loadu_ps(&m_CentreZ[i]);
+			__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_Radius[i]));
+
+			//A sphere is outside if it is further than its radius behind any plane
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+					_mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+			}
+
+			int outsideMask = _mm_movemask_ps(outside);
+			m_Visible[i] = (outsideMask & 1) == 0;
+			m_Visible[i + 1] = (outsideMask & 2) == 0;
+			m_Visible[i + 2] = (outsideMask & 4) == 0;
+			m_Visible[i + 3] = (outsideMask & 8) == 0;
+		}
+#else
+		for (unsigned int i = firstGroup * 4; i < lastGroup * 4; i++)
+		{
+			bool visible = true;
+			for (int p = 0; p < 6 && visible; p++)
+			{
+				float distance = m_CentreX[i] * m_Planes[p].x + m_CentreY[i] * m_Planes[p].y + m_CentreZ[i] * m_Planes[p].z + m_Planes[p].w;
+				visible = distance >= -m_Radius[i];
+			}
+			m_Visible[i] = visible;
+		}
+#endif
+	});
+
+	m_CulledCount = 0;
+	for (unsigned int i = 0; i < m_SphereCount; i++)
+	{
+		m_CulledCount += m_Visible[i] == 0;
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include <glm\glm.hpp>
+
+#include "Bounds.h"
+
+//Groups of four spheres handed to each culling job
+#define FRUSTUM_CULLER_JOB_GRAIN 1024
+
+//Tests bounding spheres against the six planes of the view frustum. Spheres are stored as packed
+//arrays of x, y, z and radius so four of them can be tested against a plane with one SSE instruction,
+//and large batches are split across the JobSystem
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	//Extracts the frustum planes from projection * view and clears last frame's spheres
+	void begin(const glm::mat4& viewProjectionMatrix);
+	//Returns the index used to look up the result after cull()
+	unsigned int addSphere(const BoundingSphere& sphere);
+	void cull();
+
+	bool isVisible(unsigned int index)
+	{
+		return m_Visible[index] != 0;
+	};
+
+	unsigned int getCulledCount()
+	{
+		return m_CulledCount;
+	};
+
+private:
+	//xyz is the plane normal pointing into the frustum, w the distance
+	glm::vec4 m_Planes[6];
+
+	std::vector<float> m_CentreX;
+	std::vector<float> m_CentreY;
+	std::vector<float> m_CentreZ;
+	std::vector<float> m_Radius;
+	std::vector<unsigned char> m_Visible;
+
+	unsigned int m_SphereCount;
+	unsigned int m_CulledCount;
+};
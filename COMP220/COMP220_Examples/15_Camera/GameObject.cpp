@@ -2,10 +2,23 @@
 
 GameObject::GameObject()
 {
+	m_Meshes = nullptr;
+
 	m_Position = glm::vec3(0.0f, 0.0f, 0.0f);
 	m_Scale = glm::vec3(1.0f, 1.0f, 1.0f);
 	m_Rotation = glm::vec3(0.0f, 0.0f, 0.0f);
+	m_Orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
 	m_ModelMatrix = glm::mat4(1.0f);
+	m_TransformDirty = true;
+	m_BoundsDirty = true;
+	m_TransformID = TransformHierarchy::get().create();
+	m_Parent = nullptr;
+
+	m_LocalBoundingBox = { glm::vec3(0.0f), glm::vec3(0.0f) };
+	m_LocalBoundingSphere = { glm::vec3(0.0f), 0.0f };
+	m_WorldBoundingBox = m_LocalBoundingBox;
+	m_WorldBoundingSphere = m_LocalBoundingSphere;
+	m_Lod = 0;
 
 	m_DiffuseMap = 0;
 
@@ -14,7 +27,7 @@ GameObject::GameObject()
 	m_SpecularMaterialColour = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 	m_SpecularPower = 25.0f;
 
-	m_ShaderProgramID = 0;
+	m_ShaderProgram = nullptr;
 
 	m_CollisionShape = nullptr;
 	m_Rigidbody = nullptr;
@@ -24,104 +37,121 @@ GameObject::~GameObject()
 {
 }
 
+//Assets come from the shared cache, anything previously held is released first
 void GameObject::loadMeshesFromFile(const std::string & filename)
 {
-	
-	loadMeshFromFile(filename, m_Meshes);
+	if (m_Meshes != nullptr)
+	{
+		AssetCache::get().releaseMeshes(m_Meshes);
+	}
+	m_Meshes = AssetCache::get().acquireMeshes(filename);
+	m_MeshFilename = filename;
+	computeLocalBounds();
+	m_BoundsDirty = true;
 }
 
 void GameObject::loadDiffuseTextureFromFile(const std::string & filename)
 {
-	m_DiffuseMap = loadTextureFromFile(filename);
+	AssetCache::get().releaseTexture(m_DiffuseMap);
+	m_DiffuseMap = AssetCache::get().acquireTexture(filename);
 }
 
 void GameObject::loadShaderProgram(const std::string & vertexShaderFilename, const std::string & fragmentShaderFilename)
 {
-	m_ShaderProgramID = LoadShaders(vertexShaderFilename.c_str(), fragmentShaderFilename.c_str());
+	if (m_ShaderProgram != nullptr)
+	{
+		AssetCache::get().releaseShaderProgram(m_ShaderProgram);
+	}
+	m_ShaderProgram = AssetCache::get().acquireShaderProgram(vertexShaderFilename, fragmentShaderFilename);
 }
 
+//Only rebuilds the local matrix when a setter has changed the transform since the last frame,
+//physics driven objects are kept up to date by their motion state instead
 void GameObject::update()
 {
-	if (m_Rigidbody != nullptr)
+	if (!m_TransformDirty)
 	{
-		btTransform transform = m_Rigidbody->getWorldTransform();
-		btVector3 origin = transform.getOrigin();
-		btQuaternion rotation = transform.getRotation();
-		//printf("Position %f\n", carOrigin.getY());
-
-		m_Position = glm::vec3(origin.getX(), origin.getY(), origin.getZ());
+		return;
 	}
-	
+
 	glm::mat4 translationMatrix = glm::translate(m_Position);
 	glm::mat4 scaleMatrix = glm::scale(m_Scale);
-	glm::mat4 rotationMatrix = glm::rotate(m_Rotation.x, glm::vec3(1.0f, 0.0f, 0.0f))*
-		glm::rotate(m_Rotation.y, glm::vec3(0.0f, 1.0f, 0.0f))*glm::rotate(m_Rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::mat4 rotationMatrix = glm::mat4_cast(m_Orientation);
 
-	m_ModelMatrix = translationMatrix*rotationMatrix*scaleMatrix;
+	TransformHierarchy::get().setLocalMatrix(m_TransformID, translationMatrix*rotationMatrix*scaleMatrix);
+	m_TransformDirty = false;
 }
 
-//Destroys GameObjects
-void GameObject::destroy()
+void GameObject::syncWorldTransform()
 {
-	if (m_Rigidbody != nullptr)
+	if (!m_BoundsDirty && !TransformHierarchy::get().wasUpdated(m_TransformID))
 	{
-		delete m_Rigidbody->getMotionState();
-		delete m_Rigidbody;
+		return;
 	}
 
-	if (m_CollisionShape != nullptr)
-	{
-		delete m_CollisionShape;
-	}
-	glDeleteTextures(1, &m_DiffuseMap);
-	glDeleteProgram(m_ShaderProgramID);
-	auto iter = m_Meshes.begin();
-	while (iter != m_Meshes.end())
+	m_ModelMatrix = TransformHierarchy::get().getWorldMatrix(m_TransformID);
+	m_WorldBoundingBox = transformBounds(m_LocalBoundingBox, m_ModelMatrix);
+	m_WorldBoundingSphere = transformBounds(m_LocalBoundingSphere, m_ModelMatrix);
+	m_BoundsDirty = false;
+}
+
+void GameObject::setParent(GameObject * pParent)
+{
+	TransformID parentID = pParent != nullptr ? pParent->m_TransformID : INVALID_TRANSFORM;
+	if (TransformHierarchy::get().setParent(m_TransformID, parentID))
 	{
-		if ((*iter))
-		{
-			delete (*iter);
-			iter = m_Meshes.erase(iter);
-		}
-		else
-		{
-			iter++;
-		}
+		m_Parent = pParent;
 	}
 }
 
-//Rendering Prerequiestes
-void GameObject::preRender()
+void GameObject::setPhysicsTransform(const btTransform & transform)
 {
-	glUseProgram(m_ShaderProgramID);
+	const btVector3& origin = transform.getOrigin();
+	btQuaternion rotation = transform.getRotation();
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_DiffuseMap);
+	m_Position = glm::vec3(origin.getX(), origin.getY(), origin.getZ());
+	m_Orientation = glm::quat(rotation.getW(), rotation.getX(), rotation.getY(), rotation.getZ());
+	m_TransformDirty = true;
+	update();
+}
 
-	GLint modelMatrixLocation = glGetUniformLocation(m_ShaderProgramID, "modelMatrix");
-	GLint textureLocation = glGetUniformLocation(m_ShaderProgramID, "baseTexture");
+//Combines the import time bounds of every mesh into one box and sphere around the whole object
+void GameObject::computeLocalBounds()
+{
+	computeMeshGroupBounds(m_Meshes, m_LocalBoundingBox, m_LocalBoundingSphere);
+}
 
-	GLint ambientMaterialColourLocation = glGetUniformLocation(m_ShaderProgramID, "ambientMaterialColour");
-	GLint diffuseMaterialColourLocation = glGetUniformLocation(m_ShaderProgramID, "diffuseMaterialColour");
-	GLint specularMaterialColourLocation = glGetUniformLocation(m_ShaderProgramID, "specularMaterialColour");
-	GLint specularPowerLocation = glGetUniformLocation(m_ShaderProgramID, "specularPower");
+//Destroys GameObjects
+void GameObject::destroy()
+{
+	TransformHierarchy::get().destroy(m_TransformID);
+	m_TransformID = INVALID_TRANSFORM;
+	m_Parent = nullptr;
 
-	glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, value_ptr(m_ModelMatrix));
+	if (m_Rigidbody != nullptr)
+	{
+		delete m_Rigidbody->getMotionState();
+		delete m_Rigidbody;
+	}
 
-	glUniform1i(textureLocation, 0);
+	if (m_CollisionShape != nullptr)
+	{
+		delete m_CollisionShape;
+	}
 
-	glUniform4fv(ambientMaterialColourLocation, 1, value_ptr(m_AmbientMaterialColour));
-	glUniform4fv(diffuseMaterialColourLocation, 1, value_ptr(m_DiffuseMaterialColour));
-	glUniform4fv(specularMaterialColourLocation, 1, value_ptr(m_SpecularMaterialColour));
-	glUniform1f(specularPowerLocation, m_SpecularPower);
-}
+	//GPU objects are only freed once the last object using them lets go
+	AssetCache::get().releaseTexture(m_DiffuseMap);
+	m_DiffuseMap = 0;
 
-//Renders Object
-void GameObject::render()
-{
-	for (Mesh *pMesh : m_Meshes)
+	if (m_ShaderProgram != nullptr)
 	{
-		pMesh->render();
+		AssetCache::get().releaseShaderProgram(m_ShaderProgram);
+		m_ShaderProgram = nullptr;
 	}
 
+	if (m_Meshes != nullptr)
+	{
+		AssetCache::get().releaseMeshes(m_Meshes);
+		m_Meshes = nullptr;
+	}
 }
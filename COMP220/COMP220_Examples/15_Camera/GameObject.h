@@ -6,13 +6,19 @@
 #include <glm\glm.hpp>
 #include <glm\gtx\transform.hpp>
 #include <glm\gtc\type_ptr.hpp>
+#include <glm\gtc\quaternion.hpp>
 #include <btBulletDynamicsCommon.h>
 
 #include "Mesh.h"
 #include "Model.h"
 #include "Texture.h"
-#include "Shader.h"
+#include "ShaderProgram.h"
+#include "AssetCache.h"
+#include "Bounds.h"
+#include "TransformHierarchy.h"
 
+//GameObjects per job when the per frame update and sync passes are split across the JobSystem
+#define GAME_OBJECT_JOB_GRAIN 256
 
 class GameObject
 {
@@ -24,15 +30,31 @@ public:
 	void loadDiffuseTextureFromFile(const std::string& filename);
 	void loadShaderProgram(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename);
 
+	//Pushes a changed local transform into the hierarchy. Only touches this object's node, so objects can be updated on any thread
 	void update();
+	//Picks up the world matrix once the hierarchy has been updated, refreshing the bounds if it moved. Also safe to run in parallel
+	void syncWorldTransform();
 	void destroy();
-	void preRender();
-	void render();
+
+	//Children follow their parent's transform, nullptr detaches the object.
+	//Physics driven objects should stay roots as Bullet moves them in world space
+	void setParent(GameObject * pParent);
+
+	GameObject * getParent()
+	{
+		return m_Parent;
+	};
+
+	TransformID getTransformID()
+	{
+		return m_TransformID;
+	};
 
 	//Sets the position of the game object
 	void setPosition(const glm::vec3& position)
 	{
 		m_Position = position;
+		m_TransformDirty = true;
 	};
 
 	//gets the position
@@ -45,6 +67,7 @@ public:
 	void setScale(const glm::vec3& scale)
 	{
 		m_Scale = scale;
+		m_TransformDirty = true;
 	};
 
 	const glm::vec3& getScale()
@@ -52,22 +75,68 @@ public:
 		return m_Scale;
 	};
 
+	//Euler angles in radians, applied x then y then z
 	void setRotation(const glm::vec3& rotation)
 	{
 		m_Rotation = rotation;
+		m_Orientation = glm::angleAxis(rotation.x, glm::vec3(1.0f, 0.0f, 0.0f))*
+			glm::angleAxis(rotation.y, glm::vec3(0.0f, 1.0f, 0.0f))*glm::angleAxis(rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+		m_TransformDirty = true;
 	};
 
+	//The last angles passed to setRotation, physics driven objects should use getOrientation
 	const glm::vec3& getRotation()
 	{
 		return m_Rotation;
 	};
 
+	const glm::quat& getOrientation()
+	{
+		return m_Orientation;
+	};
+
+	//Called by the object's motion state when Bullet moves the body
+	void setPhysicsTransform(const btTransform& transform);
+
+	MeshGroup * getMeshes()
+	{
+		return m_Meshes;
+	};
+
+	//The model the meshes came from, collision shapes are cooked from the same file
+	const std::string& getMeshFilename()
+	{
+		return m_MeshFilename;
+	};
+
 	const glm::mat4& getModelMatrix()
 	{
 		return m_ModelMatrix;
 	};
 
-	const GLuint getDiffuseMap()
+	//World space bounds of every mesh, updated along with the model matrix
+	const AABB& getWorldBoundingBox()
+	{
+		return m_WorldBoundingBox;
+	};
+
+	const BoundingSphere& getWorldBoundingSphere()
+	{
+		return m_WorldBoundingSphere;
+	};
+
+	//LOD drawn last frame, kept so the next choice can stick with it near a threshold
+	unsigned int getLod()
+	{
+		return m_Lod;
+	};
+
+	void setLod(unsigned int lod)
+	{
+		m_Lod = lod;
+	};
+
+	GLuint getDiffuseMap()
 	{
 		return m_DiffuseMap;
 	};
@@ -108,14 +177,19 @@ public:
 		m_SpecularPower = power;
 	};
 
-	const float getSpecularPower()
+	float getSpecularPower()
 	{
 		return m_SpecularPower;
 	};
 
-	const GLuint getShaderProgramID()
+	GLuint getShaderProgramID()
+	{
+		return m_ShaderProgram->getProgramID();
+	};
+
+	ShaderProgram * getShaderProgram()
 	{
-		return m_ShaderProgramID;
+		return m_ShaderProgram;
 	};
 
 	void SetCollision(btCollisionShape* CollisionShape)
@@ -129,14 +203,28 @@ public:
 	};
 
 private:
-	//The visible mesh
-	std::vector<Mesh*> m_Meshes;
+	//The visible mesh, shared with every other object loaded from the same file
+	MeshGroup * m_Meshes;
+	std::string m_MeshFilename;
 
 	//Transform
 	glm::vec3 m_Position;
 	glm::vec3 m_Scale;
 	glm::vec3 m_Rotation;
+	glm::quat m_Orientation;
 	glm::mat4 m_ModelMatrix;
+	bool m_TransformDirty;
+	bool m_BoundsDirty;
+	TransformID m_TransformID;
+	GameObject * m_Parent;
+
+	//Bounds
+	void computeLocalBounds();
+	AABB m_LocalBoundingBox;
+	BoundingSphere m_LocalBoundingSphere;
+	AABB m_WorldBoundingBox;
+	BoundingSphere m_WorldBoundingSphere;
+	unsigned int m_Lod;
 
 	//Textures
 	GLuint m_DiffuseMap;
@@ -151,5 +239,5 @@ private:
 	btCollisionShape* m_CollisionShape;
 	btRigidBody* m_Rigidbody;
 	
-	GLuint m_ShaderProgramID;
+	ShaderProgram * m_ShaderProgram;
 };
\ No newline at end of file
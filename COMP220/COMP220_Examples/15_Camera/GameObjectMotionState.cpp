@@ -0,0 +1,26 @@
+#include "GameObjectMotionState.h"
+#include "GameObject.h"
+
+GameObjectMotionState::GameObjectMotionState(GameObject * pOwner, const btTransform & startTransform)
+{
+	m_Owner = pOwner;
+	m_WorldTransform = startTransform;
+}
+
+GameObjectMotionState::~GameObjectMotionState()
+{
+}
+
+void GameObjectMotionState::getWorldTransform(btTransform & worldTransform) const
+{
+	worldTransform = m_WorldTransform;
+}
+
+void GameObjectMotionState::setWorldTransform(const btTransform & worldTransform)
+{
+	m_WorldTransform = worldTransform;
+	if (m_Owner != nullptr)
+	{
+		m_Owner->setPhysicsTransform(worldTransform);
+	}
+}
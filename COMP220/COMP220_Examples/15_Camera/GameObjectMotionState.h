@@ -0,0 +1,24 @@
+#pragma once
+
+#include <btBulletDynamicsCommon.h>
+
+class GameObject;
+
+//Motion state that pushes the interpolated physics transform straight into its GameObject.
+//Bullet only calls setWorldTransform for active bodies, so sleeping and static objects cost nothing per frame
+class GameObjectMotionState : public btMotionState
+{
+public:
+	GameObjectMotionState(GameObject * pOwner, const btTransform& startTransform);
+	~GameObjectMotionState();
+
+	//Called by Bullet when the body is created and for kinematic bodies every step
+	void getWorldTransform(btTransform& worldTransform) const;
+
+	//Called by Bullet after each step for every active body
+	void setWorldTransform(const btTransform& worldTransform);
+
+private:
+	GameObject * m_Owner;
+	btTransform m_WorldTransform;
+};
@@ -0,0 +1,267 @@
+#include "GeometryArena.h"
+#include "InstanceData.h"
+
+//Starting sizes of a new arena, they double whenever an allocation doesn't fit
+#define INITIAL_ARENA_VERTICES (64 * 1024)
+#define INITIAL_ARENA_INDICES (192 * 1024)
+
+std::map<unsigned int, GeometryArena*> GeometryArena::s_Arenas;
+
+//Copies the contents of a buffer into a new, bigger one and returns it, the old buffer is deleted
+static GLuint growBuffer(GLuint oldBuffer, GLsizeiptr oldSize, GLsizeiptr newSize)
+{
+	GLuint newBuffer;
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newSize, NULL, GL_STATIC_DRAW);
+
+	if (oldBuffer != 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+		glDeleteBuffers(1, &oldBuffer);
+	}
+
+	return newBuffer;
+}
+
+FreeListAllocator::FreeListAllocator()
+{
+	m_Capacity = 0;
+}
+
+void FreeListAllocator::init(GLuint capacity)
+{
+	m_FreeRanges.clear();
+	m_FreeRanges.push_back({ 0, capacity });
+	m_Capacity = capacity;
+}
+
+GLuint FreeListAllocator::allocate(GLuint size)
+{
+	for (auto iter = m_FreeRanges.begin(); iter != m_FreeRanges.end(); iter++)
+	{
+		if (iter->size >= size)
+		{
+			GLuint offset = iter->offset;
+			iter->offset += size;
+			iter->size -= size;
+			if (iter->size == 0)
+			{
+				m_FreeRanges.erase(iter);
+			}
+			return offset;
+		}
+	}
+	return INVALID_OFFSET;
+}
+
+void FreeListAllocator::free(GLuint offset, GLuint size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	//Find the first free range after the one being released
+	auto next = m_FreeRanges.begin();
+	while (next != m_FreeRanges.end() && next->offset < offset)
+	{
+		next++;
+	}
+
+	//Merge with the range before and/or after if they touch
+	bool mergedWithPrevious = false;
+	if (next != m_FreeRanges.begin())
+	{
+		auto previous = next - 1;
+		if (previous->offset + previous->size == offset)
+		{
+			previous->size += size;
+			mergedWithPrevious = true;
+			if (next != m_FreeRanges.end() && previous->offset + previous->size == next->offset)
+			{
+				previous->size += next->size;
+				m_FreeRanges.erase(next);
+			}
+		}
+	}
+
+	if (!mergedWithPrevious)
+	{
+		if (next != m_FreeRanges.end() && offset + size == next->offset)
+		{
+			next->offset = offset;
+			next->size += size;
+		}
+		else
+		{
+			m_FreeRanges.insert(next, { offset, size });
+		}
+	}
+}
+
+void FreeListAllocator::grow(GLuint newCapacity)
+{
+	GLuint oldCapacity = m_Capacity;
+	m_Capacity = newCapacity;
+	free(oldCapacity, newCapacity - oldCapacity);
+}
+
+GeometryArena * GeometryArena::get(const VertexFormat & format, GLuint indexSize)
+{
+	//Index size only ever takes the bottom three bits
+	unsigned int key = (format.getFlags() << 3) | indexSize;
+	auto iter = s_Arenas.find(key);
+	if (iter != s_Arenas.end())
+	{
+		return iter->second;
+	}
+
+	GeometryArena * pArena = new GeometryArena(format, indexSize);
+	s_Arenas[key] = pArena;
+	return pArena;
+}
+
+void GeometryArena::destroyAll()
+{
+	for (auto& arena : s_Arenas)
+	{
+		delete arena.second;
+	}
+	s_Arenas.clear();
+}
+
+GeometryArena::GeometryArena(const VertexFormat & format, GLuint indexSize)
+{
+	m_VertexFormat = format;
+	m_IndexSize = indexSize;
+	m_VBO = 0;
+	m_ColourVBO = 0;
+	m_EBO = 0;
+
+	glGenVertexArrays(1, &m_VAO);
+
+	m_VertexAllocator.init(0);
+	m_IndexAllocator.init(0);
+	growVertices(INITIAL_ARENA_VERTICES);
+	growIndices(INITIAL_ARENA_INDICES);
+
+	//Per instance attributes advance once per instance rather than once per vertex, their pointers are set per draw
+	glBindVertexArray(m_VAO);
+	for (GLuint i = INSTANCE_ATTRIBUTE_FIRST; i <= INSTANCE_ATTRIBUTE_LAST; i++)
+	{
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	glBindVertexArray(0);
+}
+
+GeometryArena::~GeometryArena()
+{
+	glDeleteVertexArrays(1, &m_VAO);
+	glDeleteBuffers(1, &m_VBO);
+	glDeleteBuffers(1, &m_ColourVBO);
+	glDeleteBuffers(1, &m_EBO);
+}
+
+bool GeometryArena::allocate(GLuint numberOfVertices, GLuint numberOfIndices, GeometryAllocation & allocation)
+{
+	GLuint firstVertex = m_VertexAllocator.allocate(numberOfVertices);
+	if (firstVertex == FreeListAllocator::INVALID_OFFSET)
+	{
+		growVertices(numberOfVertices);
+		firstVertex = m_VertexAllocator.allocate(numberOfVertices);
+	}
+
+	GLuint firstIndex = m_IndexAllocator.allocate(numberOfIndices);
+	if (firstIndex == FreeListAllocator::INVALID_OFFSET)
+	{
+		growIndices(numberOfIndices);
+		firstIndex = m_IndexAllocator.allocate(numberOfIndices);
+	}
+
+	if (firstVertex == FreeListAllocator::INVALID_OFFSET || firstIndex == FreeListAllocator::INVALID_OFFSET)
+	{
+		printf("Geometry arena allocation of %u vertices and %u indices failed\n", numberOfVertices, numberOfIndices);
+		m_VertexAllocator.free(firstVertex, firstVertex == FreeListAllocator::INVALID_OFFSET ? 0 : numberOfVertices);
+		m_IndexAllocator.free(firstIndex, firstIndex == FreeListAllocator::INVALID_OFFSET ? 0 : numberOfIndices);
+		return false;
+	}
+
+	allocation.firstVertex = firstVertex;
+	allocation.numberOfVertices = numberOfVertices;
+	allocation.firstIndex = firstIndex;
+	allocation.numberOfIndices = numberOfIndices;
+	return true;
+}
+
+void GeometryArena::free(const GeometryAllocation & allocation)
+{
+	m_VertexAllocator.free(allocation.firstVertex, allocation.numberOfVertices);
+	m_IndexAllocator.free(allocation.firstIndex, allocation.numberOfIndices);
+}
+
+void GeometryArena::upload(const GeometryAllocation & allocation, const PackedVertex * pVerts, const PackedColour * pColours, const void * pIndices)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	glBufferSubData(GL_ARRAY_BUFFER, allocation.firstVertex * sizeof(PackedVertex), allocation.numberOfVertices * sizeof(PackedVertex), pVerts);
+
+	if (m_VertexFormat.hasColourStream())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_ColourVBO);
+		glBufferSubData(GL_ARRAY_BUFFER, allocation.firstVertex * sizeof(PackedColour), allocation.numberOfVertices * sizeof(PackedColour), pColours);
+	}
+
+	//Go through the copy target so the upload doesn't disturb whatever VAO is bound
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.firstIndex * m_IndexSize, allocation.numberOfIndices * m_IndexSize, pIndices);
+}
+
+void GeometryArena::bind()
+{
+	glBindVertexArray(m_VAO);
+}
+
+void GeometryArena::growVertices(GLuint minimumVertices)
+{
+	GLuint oldCapacity = m_VertexAllocator.getCapacity();
+	GLuint newCapacity = oldCapacity > 0 ? oldCapacity * 2 : INITIAL_ARENA_VERTICES;
+	while (newCapacity - oldCapacity < minimumVertices)
+	{
+		newCapacity *= 2;
+	}
+
+	m_VBO = growBuffer(m_VBO, oldCapacity * sizeof(PackedVertex), newCapacity * sizeof(PackedVertex));
+	if (m_VertexFormat.hasColourStream())
+	{
+		m_ColourVBO = growBuffer(m_ColourVBO, oldCapacity * sizeof(PackedColour), newCapacity * sizeof(PackedColour));
+	}
+
+	m_VertexAllocator.grow(newCapacity);
+	setupVertexArray();
+}
+
+void GeometryArena::growIndices(GLuint minimumIndices)
+{
+	GLuint oldCapacity = m_IndexAllocator.getCapacity();
+	GLuint newCapacity = oldCapacity > 0 ? oldCapacity * 2 : INITIAL_ARENA_INDICES;
+	while (newCapacity - oldCapacity < minimumIndices)
+	{
+		newCapacity *= 2;
+	}
+
+	m_EBO = growBuffer(m_EBO, oldCapacity * m_IndexSize, newCapacity * m_IndexSize);
+
+	m_IndexAllocator.grow(newCapacity);
+	setupVertexArray();
+}
+
+//Points the VAO at the current buffers, needed again whenever a buffer is replaced by a bigger one
+void GeometryArena::setupVertexArray()
+{
+	glBindVertexArray(m_VAO);
+	m_VertexFormat.setupAttributes(m_VBO, m_ColourVBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <vector>
+#include <map>
+
+#include "VertexFormat.h"
+
+//First fit allocator over a range of elements, freed ranges are merged with their neighbours
+class FreeListAllocator
+{
+public:
+	static const GLuint INVALID_OFFSET = 0xFFFFFFFF;
+
+	FreeListAllocator();
+
+	void init(GLuint capacity);
+	//Returns the offset of the allocated range or INVALID_OFFSET if nothing is big enough
+	GLuint allocate(GLuint size);
+	void free(GLuint offset, GLuint size);
+	//Adds newCapacity - capacity elements of free space to the end
+	void grow(GLuint newCapacity);
+
+	GLuint getCapacity()
+	{
+		return m_Capacity;
+	};
+
+private:
+	struct Range
+	{
+		GLuint offset;
+		GLuint size;
+	};
+
+	//Free ranges sorted by offset
+	std::vector<Range> m_FreeRanges;
+	GLuint m_Capacity;
+};
+
+//Where a mesh's vertices and indices live inside an arena
+struct GeometryAllocation
+{
+	GLuint firstVertex;
+	GLuint numberOfVertices;
+	GLuint firstIndex;
+	GLuint numberOfIndices;
+};
+
+//Every mesh of one vertex format and index size shares a few large buffers and a single VAO,
+//meshes are drawn with glDrawElementsBaseVertex so nothing needs rebinding between them
+class GeometryArena
+{
+public:
+	//Returns the arena for a vertex format with indexSize byte indices, 2 or 4, creating it the first time
+	static GeometryArena * get(const VertexFormat& format, GLuint indexSize);
+	//Frees every arena, called once at shutdown
+	static void destroyAll();
+
+	bool allocate(GLuint numberOfVertices, GLuint numberOfIndices, GeometryAllocation& allocation);
+	void free(const GeometryAllocation& allocation);
+
+	//pColours is only read if the arena's format has a colour stream, pIndices must be in the arena's index size
+	void upload(const GeometryAllocation& allocation, const PackedVertex * pVerts, const PackedColour * pColours, const void * pIndices);
+
+	void bind();
+
+	const VertexFormat& getVertexFormat()
+	{
+		return m_VertexFormat;
+	};
+
+	GLuint getIndexSize()
+	{
+		return m_IndexSize;
+	};
+
+	//GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, for the draw calls
+	GLenum getIndexType()
+	{
+		return m_IndexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	};
+
+private:
+	GeometryArena(const VertexFormat& format, GLuint indexSize);
+	~GeometryArena();
+
+	void growVertices(GLuint minimumVertices);
+	void growIndices(GLuint minimumIndices);
+	void setupVertexArray();
+
+	static std::map<unsigned int, GeometryArena*> s_Arenas;
+
+	VertexFormat m_VertexFormat;
+	GLuint m_IndexSize;
+
+	GLuint m_VAO;
+	GLuint m_VBO;
+	GLuint m_ColourVBO;
+	GLuint m_EBO;
+
+	FreeListAllocator m_VertexAllocator;
+	FreeListAllocator m_IndexAllocator;
+};
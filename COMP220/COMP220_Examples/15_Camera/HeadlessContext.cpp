@@ -0,0 +1,56 @@
+#include "HeadlessContext.h"
+
+#include <cstdio>
+
+HeadlessContext::HeadlessContext()
+{
+	m_pWindow = nullptr;
+	m_GLContext = nullptr;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	destroy();
+}
+
+bool HeadlessContext::create()
+{
+	if (SDL_Init(SDL_INIT_VIDEO) < 0)
+	{
+		printf("SDL_Init failed %s\n", SDL_GetError());
+		return false;
+	}
+
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	m_pWindow = SDL_CreateWindow("Headless", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1, 1, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+	m_GLContext = m_pWindow != nullptr ? SDL_GL_CreateContext(m_pWindow) : nullptr;
+	if (m_GLContext == nullptr)
+	{
+		printf("Unable to create a hidden GL context %s\n", SDL_GetError());
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void HeadlessContext::destroy()
+{
+	if (m_GLContext != nullptr)
+	{
+		SDL_GL_DeleteContext(m_GLContext);
+		m_GLContext = nullptr;
+	}
+	if (m_pWindow != nullptr)
+	{
+		SDL_DestroyWindow(m_pWindow);
+		m_pWindow = nullptr;
+	}
+}
+
+const char * HeadlessContext::getBackendName()
+{
+	return "hidden SDL window";
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <SDL.h>
+
+//A GL 3.3 core context with nothing on screen, for benchmark runs that shouldn't open a window. It's a hidden
+//SDL window, so the machine still needs a display, on a Linux server a virtual one such as Xvfb will do.
+//There's no default frame buffer to draw into, so everything has to be drawn into frame buffer objects
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	bool create();
+	void destroy();
+
+	const char * getBackendName();
+
+private:
+	SDL_Window * m_pWindow;
+	SDL_GLContext m_GLContext;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm\glm.hpp>
+
+//Attribute locations of the per instance data, these match the layout qualifiers in the instanced vertex shaders
+#define INSTANCE_ATTRIBUTE_MODEL_MATRIX 4
+#define INSTANCE_ATTRIBUTE_AMBIENT_MATERIAL_COLOUR 8
+#define INSTANCE_ATTRIBUTE_DIFFUSE_MATERIAL_COLOUR 9
+#define INSTANCE_ATTRIBUTE_SPECULAR_MATERIAL_COLOUR 10
+#define INSTANCE_ATTRIBUTE_SPECULAR_POWER 11
+
+#define INSTANCE_ATTRIBUTE_FIRST INSTANCE_ATTRIBUTE_MODEL_MATRIX
+#define INSTANCE_ATTRIBUTE_LAST INSTANCE_ATTRIBUTE_SPECULAR_POWER
+
+//Everything that differs between two draws of the same mesh, program and texture
+struct InstanceData
+{
+	glm::mat4 modelMatrix;
+	glm::vec4 ambientMaterialColour;
+	glm::vec4 diffuseMaterialColour;
+	glm::vec4 specularMaterialColour;
+	float specularPower;
+	float padding[3];
+};
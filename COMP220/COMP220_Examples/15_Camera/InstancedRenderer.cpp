@@ -0,0 +1,113 @@
+#include "InstancedRenderer.h"
+
+InstancedRenderer::InstancedRenderer()
+{
+	m_InstanceBuffer = 0;
+	m_InstanceBufferSize = 0;
+	m_Stats = { 0, 0, 0, 0, 0, 0, 0 };
+}
+
+InstancedRenderer::~InstancedRenderer()
+{
+	destroy();
+}
+
+void InstancedRenderer::init()
+{
+	glGenBuffers(1, &m_InstanceBuffer);
+}
+
+void InstancedRenderer::destroy()
+{
+	if (m_InstanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_InstanceBuffer);
+		m_InstanceBuffer = 0;
+	}
+}
+
+void InstancedRenderer::render(RenderQueue & queue)
+{
+	m_Stats = { 0, 0, 0, 0, 0, 0, 0 };
+
+	unsigned int packetCount = queue.getPacketCount();
+	if (packetCount == 0)
+	{
+		return;
+	}
+
+	//Sorted order keeps every batch's instances next to each other, so they go up in a single upload
+	m_InstanceStaging.resize(packetCount);
+	for (unsigned int i = 0; i < packetCount; i++)
+	{
+		m_InstanceStaging[i] = queue.getSortedPacket(i).instance;
+	}
+
+	GLsizeiptr uploadSize = packetCount * sizeof(InstanceData);
+	glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+	if (uploadSize > m_InstanceBufferSize)
+	{
+		m_InstanceBufferSize = uploadSize;
+	}
+	//Orphan last frame's storage so the upload doesn't wait on the GPU
+	glBufferData(GL_ARRAY_BUFFER, m_InstanceBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, uploadSize, m_InstanceStaging.data());
+
+	ShaderProgram * pCurrentProgram = nullptr;
+	GLuint currentTexture = 0;
+	GeometryArena * pCurrentArena = nullptr;
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	unsigned int batchStart = 0;
+	while (batchStart < packetCount)
+	{
+		//Extend the batch over every following packet whose key only differs by depth. Sort ids are masked
+		//down to fit the key, so the packets themselves are compared too in case two ids wrapped onto each other
+		const DrawPacket& packet = queue.getSortedPacket(batchStart);
+		uint64_t batchKey = queue.getSortedKey(batchStart);
+		unsigned int batchEnd = batchStart + 1;
+		while (batchEnd < packetCount && RenderQueue::isSameBatch(batchKey, queue.getSortedKey(batchEnd)))
+		{
+			const DrawPacket& nextPacket = queue.getSortedPacket(batchEnd);
+			if (nextPacket.pMesh != packet.pMesh || nextPacket.lod != packet.lod || nextPacket.pProgram != packet.pProgram || nextPacket.texture != packet.texture)
+			{
+				break;
+			}
+			batchEnd++;
+		}
+
+		//Only change state when the key says something is different
+		if (packet.pProgram != pCurrentProgram)
+		{
+			packet.pProgram->use();
+			pCurrentProgram = packet.pProgram;
+			m_Stats.programSwitches++;
+		}
+		if (packet.texture != currentTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, packet.texture);
+			currentTexture = packet.texture;
+			m_Stats.textureSwitches++;
+		}
+
+		//Every mesh of a vertex format shares one VAO, so this only changes with the format
+		GeometryArena * pArena = packet.pMesh->getArena();
+		if (pArena != pCurrentArena)
+		{
+			pArena->bind();
+			pCurrentArena = pArena;
+			m_Stats.vertexArraySwitches++;
+		}
+
+		GLsizei count = batchEnd - batchStart;
+		packet.pMesh->renderInstanced(m_InstanceBuffer, batchStart * sizeof(InstanceData), count, packet.lod);
+
+		m_Stats.drawCalls++;
+		m_Stats.instances += count;
+		m_Stats.triangles += packet.pMesh->getNumberOfTriangles(packet.lod) * count;
+		m_Stats.fullDetailTriangles += packet.pMesh->getNumberOfTriangles() * count;
+		batchStart = batchEnd;
+	}
+}
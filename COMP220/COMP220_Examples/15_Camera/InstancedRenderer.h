@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include "RenderQueue.h"
+#include "InstanceData.h"
+
+//Counters for the last frame drawn, used to measure how well the queue is batching
+struct RenderStats
+{
+	unsigned int drawCalls;
+	unsigned int instances;
+	unsigned int triangles;
+	//What triangles would have been if everything was drawn at full detail
+	unsigned int fullDetailTriangles;
+	unsigned int programSwitches;
+	unsigned int textureSwitches;
+	unsigned int vertexArraySwitches;
+};
+
+//Draws a sorted render queue. Runs of packets that only differ by depth become a single instanced
+//draw call, and GL state is only changed when the program, texture or vertex array actually changes
+class InstancedRenderer
+{
+public:
+	InstancedRenderer();
+	~InstancedRenderer();
+
+	void init();
+	void destroy();
+
+	void render(RenderQueue& queue);
+
+	const RenderStats& getStats()
+	{
+		return m_Stats;
+	};
+
+private:
+	//Every instance for the frame is packed in here in sorted order before a single upload
+	std::vector<InstanceData> m_InstanceStaging;
+	GLuint m_InstanceBuffer;
+	GLsizeiptr m_InstanceBufferSize;
+
+	RenderStats m_Stats;
+};
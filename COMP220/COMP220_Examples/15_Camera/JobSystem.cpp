@@ -0,0 +1,297 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <string>
+#include <emmintrin.h>
+
+static thread_local unsigned int t_ThreadIndex = 0;
+
+JobSystem & JobSystem::get()
+{
+	static JobSystem instance;
+	return instance;
+}
+
+JobSystem::JobSystem()
+{
+	m_Initialised = false;
+	m_QueuedJobs = 0;
+	m_SleepingWorkers = 0;
+	m_SpinCount = JOB_DEFAULT_SPIN_COUNT;
+	m_Quit = false;
+
+	//Jobs can be queued before init, they're run by whoever waits on them
+	m_Queues.push_back(new WorkerQueue());
+	m_Queues[0]->jobsRun = 0;
+	m_Queues[0]->jobsStolen = 0;
+}
+
+JobSystem::~JobSystem()
+{
+	destroy();
+	for (WorkerQueue * pQueue : m_Queues)
+	{
+		delete pQueue;
+	}
+}
+
+void JobSystem::init(unsigned int workerThreads)
+{
+	if (m_Initialised)
+	{
+		return;
+	}
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	if (workerThreads == 0)
+	{
+		workerThreads = cores > 1 ? cores - 1 : 0;
+	}
+	if (workerThreads > MAX_JOB_WORKERS)
+	{
+		workerThreads = MAX_JOB_WORKERS;
+	}
+
+	//A spinning worker with no core of its own holds up the thread that would queue its next job
+	m_SpinCount = workerThreads < cores ? JOB_DEFAULT_SPIN_COUNT : 0;
+	m_Quit = false;
+	m_Queues[0]->jobsRun = 0;
+	m_Queues[0]->jobsStolen = 0;
+	for (unsigned int i = 0; i < workerThreads; i++)
+	{
+		WorkerQueue * pQueue = new WorkerQueue();
+		pQueue->jobsRun = 0;
+		pQueue->jobsStolen = 0;
+		m_Queues.push_back(pQueue);
+	}
+
+	//Every queue exists before any worker starts looking through them
+	for (unsigned int i = 0; i < workerThreads; i++)
+	{
+		m_Threads.push_back(std::thread(&JobSystem::workerThread, this, i + 1));
+	}
+	m_Initialised = true;
+}
+
+void JobSystem::destroy()
+{
+	if (!m_Initialised)
+	{
+		return;
+	}
+
+	//Workers finish whatever is left before they notice
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Quit = true;
+	}
+	m_WakeSignal.notify_all();
+	for (std::thread& thread : m_Threads)
+	{
+		thread.join();
+	}
+	m_Threads.clear();
+
+	for (unsigned int i = 1; i < m_Queues.size(); i++)
+	{
+		delete m_Queues[i];
+	}
+	m_Queues.resize(1);
+	m_Initialised = false;
+}
+
+unsigned int JobSystem::getThreadIndex()
+{
+	return t_ThreadIndex;
+}
+
+void JobSystem::run(JobFunction function, void * pData, unsigned int begin, unsigned int end, JobCounter * pCounter)
+{
+	if (pCounter != nullptr)
+	{
+		pCounter->m_Count++;
+	}
+	push({ function, pData, begin, end, pCounter });
+}
+
+void JobSystem::runAfter(JobCounter * pDependency, JobFunction function, void * pData, unsigned int begin, unsigned int end, JobCounter * pCounter)
+{
+	if (pCounter != nullptr)
+	{
+		pCounter->m_Count++;
+	}
+
+	Job job = { function, pData, begin, end, pCounter };
+	{
+		std::lock_guard<std::mutex> lock(pDependency->m_Mutex);
+		if (pDependency->m_Count.load() != 0)
+		{
+			pDependency->m_Continuations.push_back(job);
+			return;
+		}
+	}
+	push(job);
+}
+
+void JobSystem::runRange(JobFunction function, void * pData, unsigned int begin, unsigned int end, unsigned int grainSize, JobCounter * pCounter, unsigned int maxChunks)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	unsigned int count = end - begin;
+	if (maxChunks == 0)
+	{
+		maxChunks = getThreadCount() * JOB_CHUNKS_PER_THREAD;
+	}
+	unsigned int chunkSize = grainSize < 1 ? 1 : grainSize;
+	if ((count + chunkSize - 1) / chunkSize > maxChunks)
+	{
+		chunkSize = (count + maxChunks - 1) / maxChunks;
+	}
+
+	for (unsigned int chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize)
+	{
+		unsigned int chunkEnd = end - chunkBegin < chunkSize ? end : chunkBegin + chunkSize;
+		run(function, pData, chunkBegin, chunkEnd, pCounter);
+	}
+}
+
+void JobSystem::wait(JobCounter * pCounter)
+{
+	while (pCounter->m_Count.load() != 0)
+	{
+		if (!runOneJob())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	//The job that released the counter may still be holding its mutex, it mustn't be destroyed until that's let go
+	std::lock_guard<std::mutex> lock(pCounter->m_Mutex);
+}
+
+void JobSystem::push(const Job & job)
+{
+	//Threads that aren't workers share queue 0
+	unsigned int threadIndex = t_ThreadIndex < m_Queues.size() ? t_ThreadIndex : 0;
+	WorkerQueue * pQueue = m_Queues[threadIndex];
+	{
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		pQueue->jobs.push_back(job);
+	}
+	m_QueuedJobs++;
+
+	//A worker counts itself as sleeping before it checks m_QueuedJobs, so one of the two always sees the other
+	if (m_SleepingWorkers.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_WakeSignal.notify_one();
+	}
+}
+
+bool JobSystem::runOneJob()
+{
+	unsigned int numberOfQueues = (unsigned int)m_Queues.size();
+	unsigned int threadIndex = t_ThreadIndex < numberOfQueues ? t_ThreadIndex : 0;
+	WorkerQueue * pOwnQueue = m_Queues[threadIndex];
+
+	Job job;
+	bool found = false;
+	{
+		std::lock_guard<std::mutex> lock(pOwnQueue->mutex);
+		if (!pOwnQueue->jobs.empty())
+		{
+			job = pOwnQueue->jobs.back();
+			pOwnQueue->jobs.pop_back();
+			found = true;
+		}
+	}
+
+	//Steal the oldest job from someone else, starting with the next thread along so thieves spread out
+	for (unsigned int i = 1; i < numberOfQueues && !found; i++)
+	{
+		WorkerQueue * pVictim = m_Queues[(threadIndex + i) % numberOfQueues];
+		std::lock_guard<std::mutex> lock(pVictim->mutex);
+		if (!pVictim->jobs.empty())
+		{
+			job = pVictim->jobs.front();
+			pVictim->jobs.pop_front();
+			found = true;
+			pOwnQueue->jobsStolen++;
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+
+	m_QueuedJobs--;
+	job.function(job.pData, job.begin, job.end);
+	pOwnQueue->jobsRun++;
+	if (job.pCounter != nullptr)
+	{
+		finishJob(job.pCounter);
+	}
+	return true;
+}
+
+void JobSystem::finishJob(JobCounter * pCounter)
+{
+	std::vector<Job> continuations;
+	{
+		std::lock_guard<std::mutex> lock(pCounter->m_Mutex);
+		if (--pCounter->m_Count != 0)
+		{
+			return;
+		}
+		continuations.swap(pCounter->m_Continuations);
+	}
+
+	for (const Job& job : continuations)
+	{
+		push(job);
+	}
+}
+
+void JobSystem::workerThread(unsigned int threadIndex)
+{
+	t_ThreadIndex = threadIndex;
+	Profiler::get().setThreadName("Job worker " + std::to_string(threadIndex));
+
+	while (true)
+	{
+		if (runOneJob())
+		{
+			continue;
+		}
+
+		//Waking a sleeping thread takes longer than most jobs do, so look again for a while first.
+		//Only the shared count is read, the deques' mutexes aren't touched until there's something in them
+		bool jobsQueued = false;
+		unsigned int spinCount = m_SpinCount.load(std::memory_order_relaxed);
+		for (unsigned int spin = 0; spin < spinCount && !jobsQueued; spin++)
+		{
+			_mm_pause();
+			jobsQueued = m_QueuedJobs.load(std::memory_order_relaxed) > 0;
+		}
+		if (jobsQueued)
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_SleepingWorkers++;
+		m_WakeSignal.wait(lock, [this]()
+		{
+			return m_Quit.load() || m_QueuedJobs.load() > 0;
+		});
+		m_SleepingWorkers--;
+		if (m_Quit.load() && m_QueuedJobs.load() == 0)
+		{
+			return;
+		}
+	}
+}
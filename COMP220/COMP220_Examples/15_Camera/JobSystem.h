@@ -0,0 +1,170 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//Bullet numbers the threads that call into it and only has room for 64, the main thread included
+#define MAX_JOB_WORKERS 63
+//parallelFor never splits a range into more chunks than this per thread, so tiny grain sizes don't flood the queues
+#define JOB_CHUNKS_PER_THREAD 4
+//Times an idle worker checks for new jobs before it goes to sleep, a few tens of microseconds on a desktop CPU
+#define JOB_DEFAULT_SPIN_COUNT 2000
+
+typedef void(*JobFunction)(void * pData, unsigned int begin, unsigned int end);
+
+class JobCounter;
+
+//A function run over [begin, end) with a pointer to whatever data it needs
+struct Job
+{
+	JobFunction function;
+	void * pData;
+	unsigned int begin;
+	unsigned int end;
+	//Decremented once the job has finished, may be null
+	JobCounter * pCounter;
+};
+
+//Counts the jobs still to finish in a group. Waiting on it runs other jobs in the meantime, and jobs queued
+//with runAfter are held back until it reaches zero, which is how jobs depend on each other
+class JobCounter
+{
+public:
+	JobCounter()
+	{
+		m_Count = 0;
+	};
+
+	bool isDone()
+	{
+		return m_Count.load() == 0;
+	};
+
+private:
+	friend class JobSystem;
+
+	std::atomic<int> m_Count;
+	//Protects the continuations, and the count reaching zero so a continuation can't be parked after it was released
+	std::mutex m_Mutex;
+	std::vector<Job> m_Continuations;
+};
+
+//Runs jobs on one worker thread per core. Every thread has its own deque, it pushes and pops at the back so it
+//works through what it just queued while it's still in cache, and idle threads steal from the front of the others'.
+//The thread that called init counts as thread 0 and only runs jobs while it waits on a counter, so a frame can queue
+//work, carry on with GL calls of its own and pick the results up later. Idle workers spin for a short while in case
+//more jobs turn up straight away, as they do between Bullet's back to back parallel loops, then sleep until there are some
+class JobSystem
+{
+public:
+	static JobSystem& get();
+
+	//workerThreads 0 uses one less than the number of cores
+	void init(unsigned int workerThreads = 0);
+	void destroy();
+
+	//Worker threads plus the thread that called init
+	unsigned int getThreadCount()
+	{
+		return (unsigned int)m_Threads.size() + 1;
+	};
+
+	//0 on the thread that called init and any other thread that isn't a worker
+	unsigned int getThreadIndex();
+
+	//How long idle workers spin before sleeping, 0 sends them straight to sleep. init turns spinning off when
+	//there are more threads than cores, calling this after init overrides that
+	void setSpinCount(unsigned int spinCount)
+	{
+		m_SpinCount = spinCount;
+	};
+
+	unsigned int getSpinCount()
+	{
+		return m_SpinCount;
+	};
+
+	//pCounter is incremented straight away and decremented when the job finishes
+	void run(JobFunction function, void * pData, unsigned int begin, unsigned int end, JobCounter * pCounter);
+	//Same, but the job isn't queued until pDependency reaches zero
+	void runAfter(JobCounter * pDependency, JobFunction function, void * pData, unsigned int begin, unsigned int end, JobCounter * pCounter);
+
+	//Splits [begin, end) into chunks of at least grainSize and queues a job for each, without waiting for them.
+	//maxChunks limits how many chunks there are and so how many threads can be working on the range at once,
+	//0 allows JOB_CHUNKS_PER_THREAD for every thread
+	void runRange(JobFunction function, void * pData, unsigned int begin, unsigned int end, unsigned int grainSize, JobCounter * pCounter, unsigned int maxChunks = 0);
+
+	//Runs queued jobs on this thread until the counter reaches zero
+	void wait(JobCounter * pCounter);
+
+	//Calls body(begin, end) over chunks of [begin, end) across every thread and returns once they have all finished
+	template<typename Body>
+	void parallelFor(unsigned int begin, unsigned int end, unsigned int grainSize, const Body& body)
+	{
+		if (end - begin <= grainSize || m_Threads.empty())
+		{
+			if (begin < end)
+			{
+				body(begin, end);
+			}
+			return;
+		}
+
+		JobCounter counter;
+		runRange(&JobSystem::callBody<Body>, (void*)&body, begin, end, grainSize, &counter);
+		wait(&counter);
+	};
+
+	//Jobs each thread has run since init, from its own deque or stolen
+	unsigned int getJobsRun(unsigned int threadIndex)
+	{
+		return m_Queues[threadIndex]->jobsRun;
+	};
+
+	unsigned int getJobsStolen(unsigned int threadIndex)
+	{
+		return m_Queues[threadIndex]->jobsStolen;
+	};
+
+private:
+	JobSystem();
+	~JobSystem();
+
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+		//Only written by the thread that owns the queue
+		unsigned int jobsRun;
+		unsigned int jobsStolen;
+	};
+
+	template<typename Body>
+	static void callBody(void * pData, unsigned int begin, unsigned int end)
+	{
+		(*(const Body*)pData)(begin, end);
+	};
+
+	void push(const Job& job);
+	//Tries this thread's deque, then steals from the others, returns false if every one was empty
+	bool runOneJob();
+	void finishJob(JobCounter * pCounter);
+	void workerThread(unsigned int threadIndex);
+
+	bool m_Initialised;
+	std::vector<std::thread> m_Threads;
+	//One per thread, index 0 is shared by every thread that isn't a worker
+	std::vector<WorkerQueue*> m_Queues;
+
+	//Jobs in any deque, workers only go to sleep when it's zero
+	std::atomic<int> m_QueuedJobs;
+	std::atomic<int> m_SleepingWorkers;
+	std::atomic<unsigned int> m_SpinCount;
+	std::mutex m_SleepMutex;
+	std::condition_variable m_WakeSignal;
+	std::atomic<bool> m_Quit;
+};
@@ -0,0 +1,58 @@
+#include "JobTaskScheduler.h"
+#include "Profiler.h"
+
+//Defined in btThreads.cpp but not in its header, the other schedulers bracket their loops with these
+void btPushThreadsAreRunning();
+void btPopThreadsAreRunning();
+
+JobTaskScheduler::JobTaskScheduler() : btITaskScheduler("JobSystem")
+{
+	m_NumThreads = (int)JobSystem::get().getThreadCount();
+	m_MinGrainSize = 1;
+}
+
+int JobTaskScheduler::getMaxNumThreads() const
+{
+	return (int)JobSystem::get().getThreadCount();
+}
+
+int JobTaskScheduler::getNumThreads() const
+{
+	return m_NumThreads;
+}
+
+void JobTaskScheduler::setNumThreads(int numThreads)
+{
+	m_NumThreads = numThreads < 1 ? 1 : numThreads;
+	if (m_NumThreads > getMaxNumThreads())
+	{
+		m_NumThreads = getMaxNumThreads();
+	}
+}
+
+void JobTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody & body)
+{
+	PROFILE_SCOPE("Bullet parallelFor");
+	if (grainSize < m_MinGrainSize)
+	{
+		grainSize = m_MinGrainSize;
+	}
+	if (m_NumThreads == 1 || iEnd - iBegin <= grainSize)
+	{
+		body.forLoop(iBegin, iEnd);
+		return;
+	}
+
+	btPushThreadsAreRunning();
+	JobCounter counter;
+	//At the maximum the JobSystem balances the chunks itself, below it each thread gets one
+	unsigned int maxChunks = m_NumThreads < getMaxNumThreads() ? (unsigned int)m_NumThreads : 0;
+	JobSystem::get().runRange(&JobTaskScheduler::runBody, (void*)&body, (unsigned int)iBegin, (unsigned int)iEnd, (unsigned int)grainSize, &counter, maxChunks);
+	JobSystem::get().wait(&counter);
+	btPopThreadsAreRunning();
+}
+
+void JobTaskScheduler::runBody(void * pData, unsigned int begin, unsigned int end)
+{
+	((const btIParallelForBody*)pData)->forLoop((int)begin, (int)end);
+}
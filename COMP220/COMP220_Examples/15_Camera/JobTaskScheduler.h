@@ -0,0 +1,40 @@
+#pragma once
+
+#include <LinearMath\btThreads.h>
+
+#include "JobSystem.h"
+
+//Lets Bullet's btParallelFor run on the JobSystem's threads, so physics shares the workers with the rest of the
+//frame instead of bringing a thread pool of its own. Set with btSetTaskScheduler before the world is created.
+//Bullet only spreads work over threads when it's built with BT_THREADSAFE and the world is a btDiscreteDynamicsWorldMt.
+//The prebuilt Bullet libraries in Libraries\bullet3-2.87\bin and this project's configurations don't define it, so as shipped
+//every loop runs on the calling thread. Parallel physics needs Bullet rebuilt with BT_THREADSAFE=ON and BT_THREADSAFE=1 added here
+class JobTaskScheduler : public btITaskScheduler
+{
+public:
+	JobTaskScheduler();
+
+	int getMaxNumThreads() const BT_OVERRIDE;
+	int getNumThreads() const BT_OVERRIDE;
+	//The threads belong to the JobSystem, so fewer threads is done by splitting each loop into no more than numThreads chunks
+	void setNumThreads(int numThreads) BT_OVERRIDE;
+	void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) BT_OVERRIDE;
+
+	//Loops are never split finer than this, whatever grain Bullet asks for. Bullet's own sizes suit its big scenes,
+	//small ones spend more time handing out chunks than running them. 1 uses Bullet's sizes as they are
+	void setMinGrainSize(int minGrainSize)
+	{
+		m_MinGrainSize = minGrainSize < 1 ? 1 : minGrainSize;
+	};
+
+	int getMinGrainSize()
+	{
+		return m_MinGrainSize;
+	};
+
+private:
+	static void runBody(void * pData, unsigned int begin, unsigned int end);
+
+	int m_NumThreads;
+	int m_MinGrainSize;
+};
@@ -0,0 +1,366 @@
+#include "LightCuller.h"
+#include "Profiler.h"
+
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define LIGHT_CULLER_SSE
+#endif
+
+LightCuller::LightCuller()
+{
+	m_Initialised = false;
+	m_ProjectionMatrix = glm::mat4(0.0f);
+	m_ViewportWidth = 0;
+	m_ViewportHeight = 0;
+	m_Near = 0.0f;
+	m_Far = 0.0f;
+	m_ClusterParameters = glm::vec4(0.0f);
+	m_pLights = nullptr;
+	m_VisibleLightCount = 0;
+	m_LightReferenceCount = 0;
+	m_MaxLightReferences = 0;
+	m_LightDataBufferID = 0;
+	m_LightDataTextureID = 0;
+	m_GridBufferID = 0;
+	m_GridTextureID = 0;
+	m_IndexBufferID = 0;
+	m_IndexTextureID = 0;
+	m_CullPending = false;
+}
+
+LightCuller::~LightCuller()
+{
+	destroy();
+}
+
+void LightCuller::init()
+{
+	m_ClusterLights.resize(LIGHT_CLUSTER_COUNT * LIGHT_CLUSTER_MAX_LIGHTS);
+	m_ClusterLightCounts.resize(LIGHT_CLUSTER_COUNT);
+	m_GridData.resize(LIGHT_CLUSTER_COUNT * 2);
+
+	GLint maxTextureBufferSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTextureBufferSize);
+	m_MaxLightReferences = (unsigned int)maxTextureBufferSize;
+
+	createBufferTexture(m_LightDataBufferID, m_LightDataTextureID, GL_RGBA32F);
+	createBufferTexture(m_GridBufferID, m_GridTextureID, GL_RG32UI);
+	createBufferTexture(m_IndexBufferID, m_IndexTextureID, GL_R16UI);
+	m_Initialised = true;
+}
+
+void LightCuller::destroy()
+{
+	if (!m_Initialised)
+	{
+		return;
+	}
+
+	//Jobs still running would write into arrays that are about to go
+	if (m_CullPending)
+	{
+		JobSystem::get().wait(&m_PackCounter);
+		m_CullPending = false;
+	}
+
+	glDeleteTextures(1, &m_LightDataTextureID);
+	glDeleteTextures(1, &m_GridTextureID);
+	glDeleteTextures(1, &m_IndexTextureID);
+	glDeleteBuffers(1, &m_LightDataBufferID);
+	glDeleteBuffers(1, &m_GridBufferID);
+	glDeleteBuffers(1, &m_IndexBufferID);
+	m_LightDataTextureID = m_GridTextureID = m_IndexTextureID = 0;
+	m_LightDataBufferID = m_GridBufferID = m_IndexBufferID = 0;
+	m_Initialised = false;
+}
+
+void LightCuller::setProjection(const glm::mat4 & projectionMatrix, int viewportWidth, int viewportHeight)
+{
+	if (projectionMatrix == m_ProjectionMatrix && viewportWidth == m_ViewportWidth && viewportHeight == m_ViewportHeight)
+	{
+		return;
+	}
+	m_ProjectionMatrix = projectionMatrix;
+	m_ViewportWidth = viewportWidth;
+	m_ViewportHeight = viewportHeight;
+
+	//Near and far planes back out of a perspective matrix
+	m_Near = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0f);
+	m_Far = projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0f);
+
+	//Slices are spaced exponentially, slice = log(depth) * scale + bias
+	float logDepthRange = logf(m_Far / m_Near);
+	float sliceScale = LIGHT_CLUSTER_Z / logDepthRange;
+	float sliceBias = -LIGHT_CLUSTER_Z * logf(m_Near) / logDepthRange;
+	m_ClusterParameters = glm::vec4((float)LIGHT_CLUSTER_X / viewportWidth, (float)LIGHT_CLUSTER_Y / viewportHeight, sliceScale, sliceBias);
+
+	m_SliceDepths.resize(LIGHT_CLUSTER_Z + 1);
+	for (int z = 0; z <= LIGHT_CLUSTER_Z; z++)
+	{
+		m_SliceDepths[z] = m_Near * powf(m_Far / m_Near, (float)z / LIGHT_CLUSTER_Z);
+	}
+
+	//Rays through the corners of every tile, scaled to reach one unit into the screen
+	glm::mat4 inverseProjection = glm::inverse(projectionMatrix);
+	std::vector<glm::vec3> cornerRays((LIGHT_CLUSTER_X + 1) * (LIGHT_CLUSTER_Y + 1));
+	for (int y = 0; y <= LIGHT_CLUSTER_Y; y++)
+	{
+		for (int x = 0; x <= LIGHT_CLUSTER_X; x++)
+		{
+			glm::vec4 nearPoint = inverseProjection * glm::vec4(-1.0f + 2.0f * x / LIGHT_CLUSTER_X, -1.0f + 2.0f * y / LIGHT_CLUSTER_Y, -1.0f, 1.0f);
+			glm::vec3 viewPoint = glm::vec3(nearPoint) / nearPoint.w;
+			cornerRays[y * (LIGHT_CLUSTER_X + 1) + x] = viewPoint / -viewPoint.z;
+		}
+	}
+
+	m_ClusterMinX.resize(LIGHT_CLUSTER_COUNT);
+	m_ClusterMinY.resize(LIGHT_CLUSTER_COUNT);
+	m_ClusterMinZ.resize(LIGHT_CLUSTER_COUNT);
+	m_ClusterMaxX.resize(LIGHT_CLUSTER_COUNT);
+	m_ClusterMaxY.resize(LIGHT_CLUSTER_COUNT);
+	m_ClusterMaxZ.resize(LIGHT_CLUSTER_COUNT);
+	for (int z = 0; z < LIGHT_CLUSTER_Z; z++)
+	{
+		for (int y = 0; y < LIGHT_CLUSTER_Y; y++)
+		{
+			for (int x = 0; x < LIGHT_CLUSTER_X; x++)
+			{
+				//Bounds of the tile's four corner rays cut at the slice's near and far depth
+				glm::vec3 minimum(FLT_MAX);
+				glm::vec3 maximum(-FLT_MAX);
+				for (int corner = 0; corner < 4; corner++)
+				{
+					glm::vec3 ray = cornerRays[(y + corner / 2) * (LIGHT_CLUSTER_X + 1) + x + corner % 2];
+					for (int depth = 0; depth < 2; depth++)
+					{
+						glm::vec3 point = ray * m_SliceDepths[z + depth];
+						minimum = glm::min(minimum, point);
+						maximum = glm::max(maximum, point);
+					}
+				}
+
+				int cluster = (z * LIGHT_CLUSTER_Y + y) * LIGHT_CLUSTER_X + x;
+				m_ClusterMinX[cluster] = minimum.x;
+				m_ClusterMinY[cluster] = minimum.y;
+				m_ClusterMinZ[cluster] = minimum.z;
+				m_ClusterMaxX[cluster] = maximum.x;
+				m_ClusterMaxY[cluster] = maximum.y;
+				m_ClusterMaxZ[cluster] = maximum.z;
+			}
+		}
+	}
+}
+
+void LightCuller::beginCull(const std::vector<PointLight>& lights, const glm::mat4 & viewMatrix)
+{
+	//A cull that was never finished still owns the arrays
+	if (m_CullPending)
+	{
+		JobSystem::get().wait(&m_PackCounter);
+	}
+
+
+	unsigned int numberOfLights = lights.size() < MAX_POINT_LIGHTS ? (unsigned int)lights.size() : MAX_POINT_LIGHTS;
+	m_pLights = &lights;
+	m_ViewSpaceLights.resize(numberOfLights);
+	for (unsigned int i = 0; i < numberOfLights; i++)
+	{
+		m_ViewSpaceLights[i] = glm::vec4(glm::vec3(viewMatrix * glm::vec4(lights[i].position, 1.0f)), lights[i].radius);
+	}
+
+	//Every slice is a separate job when there are enough lights to be worth spreading out
+	unsigned int slicesPerJob = numberOfLights < LIGHT_CULLER_THREAD_THRESHOLD ? LIGHT_CLUSTER_Z : 1;
+	JobSystem::get().runRange(&LightCuller::binJob, this, 0, LIGHT_CLUSTER_Z, slicesPerJob, &m_BinCounter);
+	JobSystem::get().runAfter(&m_BinCounter, &LightCuller::packJob, this, 0, 0, &m_PackCounter);
+	m_CullPending = true;
+}
+
+//Streams all three buffers up, orphaning last frame's storage
+void LightCuller::finishCull()
+{
+	if (!m_CullPending)
+	{
+		return;
+	}
+
+	{
+		PROFILE_SCOPE("Wait for light culling");
+		JobSystem::get().wait(&m_PackCounter);
+	}
+	m_CullPending = false;
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_LightDataBufferID);
+	glBufferData(GL_TEXTURE_BUFFER, m_LightData.size() * sizeof(glm::vec4), m_LightData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_GridBufferID);
+	glBufferData(GL_TEXTURE_BUFFER, m_GridData.size() * sizeof(unsigned int), m_GridData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_IndexBufferID);
+	glBufferData(GL_TEXTURE_BUFFER, m_IndexData.size() * sizeof(unsigned short), m_IndexData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightCuller::bind()
+{
+	glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_LightDataTextureID);
+	glActiveTexture(GL_TEXTURE0 + LIGHT_GRID_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_GridTextureID);
+	glActiveTexture(GL_TEXTURE0 + LIGHT_INDEX_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_IndexTextureID);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void LightCuller::binSlices(unsigned int firstSlice, unsigned int lastSlice)
+{
+	unsigned int firstCluster = firstSlice * LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y;
+	unsigned int lastCluster = lastSlice * LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y;
+	memset(&m_ClusterLightCounts[firstCluster], 0, (lastCluster - firstCluster) * sizeof(unsigned short));
+
+	float sliceScale = m_ClusterParameters.z;
+	float sliceBias = m_ClusterParameters.w;
+	for (unsigned int i = 0; i < (unsigned int)m_ViewSpaceLights.size(); i++)
+	{
+		const glm::vec4& light = m_ViewSpaceLights[i];
+		float nearestDepth = -light.z - light.w;
+		float furthestDepth = -light.z + light.w;
+		if (furthestDepth < m_SliceDepths[firstSlice] || nearestDepth > m_SliceDepths[lastSlice])
+		{
+			continue;
+		}
+
+		//Only the slices the light's depth range touches need testing
+		int lightFirstSlice = nearestDepth > m_Near ? (int)(logf(nearestDepth) * sliceScale + sliceBias) : 0;
+		int lightLastSlice = furthestDepth < m_Far ? (int)(logf(furthestDepth) * sliceScale + sliceBias) + 1 : LIGHT_CLUSTER_Z;
+		lightFirstSlice = glm::max(lightFirstSlice, (int)firstSlice);
+		lightLastSlice = glm::min(lightLastSlice, (int)lastSlice);
+		float radiusSquared = light.w * light.w;
+
+#ifdef LIGHT_CULLER_SSE
+		__m128 centreX = _mm_set1_ps(light.x);
+		__m128 centreY = _mm_set1_ps(light.y);
+		__m128 centreZ = _mm_set1_ps(light.z);
+		__m128 radiusSquared4 = _mm_set1_ps(radiusSquared);
+		__m128 zero = _mm_setzero_ps();
+#endif
+
+		for (int z = lightFirstSlice; z < lightLastSlice; z++)
+		{
+			unsigned int sliceStart = z * LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y;
+			unsigned int sliceEnd = sliceStart + LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y;
+#ifdef LIGHT_CULLER_SSE
+			//A slice is a whole number of groups of four as LIGHT_CLUSTER_X is a multiple of four
+			for (unsigned int cluster = sliceStart; cluster < sliceEnd; cluster += 4)
+			{
+				//Squared distance from the centre to the nearest point of each box
+				__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_ClusterMinX[cluster]), centreX), zero),
+					_mm_max_ps(_mm_sub_ps(centreX, _mm_loadu_ps(&m_ClusterMaxX[cluster])), zero));
+				__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_ClusterMinY[cluster]), centreY), zero),
+					_mm_max_ps(_mm_sub_ps(centreY, _mm_loadu_ps(&m_ClusterMaxY[cluster])), zero));
+				__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_ClusterMinZ[cluster]), centreZ), zero),
+					_mm_max_ps(_mm_sub_ps(centreZ, _mm_loadu_ps(&m_ClusterMaxZ[cluster])), zero));
+				__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+				int overlapMask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, radiusSquared4));
+				for (int lane = 0; overlapMask != 0; lane++, overlapMask >>= 1)
+				{
+					unsigned short& count = m_ClusterLightCounts[cluster + lane];
+					if ((overlapMask & 1) != 0 && count < LIGHT_CLUSTER_MAX_LIGHTS)
+					{
+						m_ClusterLights[(cluster + lane) * LIGHT_CLUSTER_MAX_LIGHTS + count++] = (unsigned short)i;
+					}
+				}
+			}
+#else
+			for (unsigned int cluster = sliceStart; cluster < sliceEnd; cluster++)
+			{
+				float dx = glm::max(m_ClusterMinX[cluster] - light.x, 0.0f) + glm::max(light.x - m_ClusterMaxX[cluster], 0.0f);
+				float dy = glm::max(m_ClusterMinY[cluster] - light.y, 0.0f) + glm::max(light.y - m_ClusterMaxY[cluster], 0.0f);
+				float dz = glm::max(m_ClusterMinZ[cluster] - light.z, 0.0f) + glm::max(light.z - m_ClusterMaxZ[cluster], 0.0f);
+				unsigned short& count = m_ClusterLightCounts[cluster];
+				if (dx * dx + dy * dy + dz * dz <= radiusSquared && count < LIGHT_CLUSTER_MAX_LIGHTS)
+				{
+					m_ClusterLights[cluster * LIGHT_CLUSTER_MAX_LIGHTS + count++] = (unsigned short)i;
+				}
+			}
+#endif
+		}
+	}
+}
+
+void LightCuller::binJob(void * pData, unsigned int begin, unsigned int end)
+{
+	PROFILE_SCOPE("Bin lights");
+	((LightCuller*)pData)->binSlices(begin, end);
+}
+
+//Each cluster's offset into the index list depends on every cluster before it, so packing is one job and the range is unused
+void LightCuller::packJob(void * pData, unsigned int begin, unsigned int end)
+{
+	(void)begin;
+	(void)end;
+	PROFILE_SCOPE("Pack lights");
+	((LightCuller*)pData)->pack();
+}
+
+void LightCuller::createBufferTexture(GLuint & bufferID, GLuint & textureID, GLenum format)
+{
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+	glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_BUFFER, textureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, bufferID);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightCuller::pack()
+{
+	const std::vector<PointLight>& lights = *m_pLights;
+	unsigned int numberOfLights = (unsigned int)m_ViewSpaceLights.size();
+
+	m_LightVisible.assign(numberOfLights, 0);
+	m_IndexData.clear();
+	for (unsigned int cluster = 0; cluster < LIGHT_CLUSTER_COUNT; cluster++)
+	{
+		unsigned int count = m_ClusterLightCounts[cluster];
+		if (m_IndexData.size() + count > m_MaxLightReferences)
+		{
+			count = m_MaxLightReferences - (unsigned int)m_IndexData.size();
+		}
+
+		m_GridData[cluster * 2] = (unsigned int)m_IndexData.size();
+		m_GridData[cluster * 2 + 1] = count;
+		const unsigned short * pClusterLights = &m_ClusterLights[cluster * LIGHT_CLUSTER_MAX_LIGHTS];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			m_IndexData.push_back(pClusterLights[i]);
+			m_LightVisible[pClusterLights[i]] = 1;
+		}
+	}
+	m_LightReferenceCount = (unsigned int)m_IndexData.size();
+
+	//Only lights that reached a cluster are referenced, but uploading them all keeps the indices stable
+	m_LightData.resize(numberOfLights * 2);
+	m_VisibleLightCount = 0;
+	for (unsigned int i = 0; i < numberOfLights; i++)
+	{
+		m_LightData[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+		m_LightData[i * 2 + 1] = glm::vec4(lights[i].colour * lights[i].intensity, 0.0f);
+		m_VisibleLightCount += m_LightVisible[i];
+	}
+
+	//Empty buffers can't back a texture, keep one dummy element around
+	if (m_LightData.empty())
+	{
+		m_LightData.push_back(glm::vec4(0.0f));
+	}
+	if (m_IndexData.empty())
+	{
+		m_IndexData.push_back(0);
+	}
+}
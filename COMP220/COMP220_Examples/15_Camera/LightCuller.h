@@ -0,0 +1,142 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <vector>
+
+#include <glm\glm.hpp>
+
+#include "JobSystem.h"
+
+//Size of the view space cluster grid. The screen is split into 16x9 tiles and depth into 24 exponential slices,
+//so clusters stay roughly cube shaped from the near plane out to the far plane
+#define LIGHT_CLUSTER_X 16
+#define LIGHT_CLUSTER_Y 9
+#define LIGHT_CLUSTER_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y * LIGHT_CLUSTER_Z)
+//Lights beyond this in one cluster are dropped from it
+#define LIGHT_CLUSTER_MAX_LIGHTS 128
+//Each light takes two texels of the light buffer, which keeps it well inside the smallest buffer texture GL 3.3 allows
+#define MAX_POINT_LIGHTS 1024
+//Below this many lights binning is quicker as one job than spread over the workers
+#define LIGHT_CULLER_THREAD_THRESHOLD 64
+
+//Texture units the light buffers are bound to while the scene draws, samplers are pointed at them when programs link
+#define LIGHT_DATA_TEXTURE_UNIT 1
+#define LIGHT_GRID_TEXTURE_UNIT 2
+#define LIGHT_INDEX_TEXTURE_UNIT 3
+
+struct PointLight
+{
+	glm::vec3 position;
+	//Light has faded to nothing at this distance, it's the bounding sphere used for binning
+	float radius;
+	glm::vec3 colour;
+	float intensity;
+};
+
+//Bins point lights into a 3D grid of view space clusters so each pixel only shades the lights that can reach it.
+//Every frame the lights are tested against the clusters their bounds overlap, four clusters at a time with SSE,
+//split into jobs by depth slice so no two threads ever write the same cluster, and packed by a job that runs once
+//they've all finished. The result goes up as three buffer textures, the lights themselves, an offset and count
+//for each cluster, and the packed light index lists the counts point into
+class LightCuller
+{
+public:
+	LightCuller();
+	~LightCuller();
+
+	//Needs a current GL context
+	void init();
+	void destroy();
+
+	//Rebuilds the cluster bounds when the projection or viewport changes, it's a no-op otherwise
+	void setProjection(const glm::mat4& projectionMatrix, int viewportWidth, int viewportHeight);
+
+	//Queues the binning on the JobSystem and returns straight away, the lights mustn't change until finishCull
+	void beginCull(const std::vector<PointLight>& lights, const glm::mat4& viewMatrix);
+	//Waits for the binning, running jobs meanwhile, and uploads the result. GL thread only
+	void finishCull();
+
+	//Binds the buffers to their texture units for the scene shaders, leaves texture unit 0 active
+	void bind();
+
+	//Scale and bias turning gl_FragCoord and view depth into a cluster, the clusterParameters in the PerFrame block
+	glm::vec4 getClusterParameters()
+	{
+		return m_ClusterParameters;
+	};
+
+	unsigned int getVisibleLightCount()
+	{
+		return m_VisibleLightCount;
+	};
+
+	//Total light references across every cluster, the size of the index list
+	unsigned int getLightReferenceCount()
+	{
+		return m_LightReferenceCount;
+	};
+
+private:
+	//Bins every light into the clusters of slices [firstSlice, lastSlice)
+	void binSlices(unsigned int firstSlice, unsigned int lastSlice);
+	//Packs the per cluster lists end to end ready to upload
+	void pack();
+	void createBufferTexture(GLuint& bufferID, GLuint& textureID, GLenum format);
+
+	static void binJob(void * pData, unsigned int begin, unsigned int end);
+	static void packJob(void * pData, unsigned int begin, unsigned int end);
+
+	bool m_Initialised;
+
+	glm::mat4 m_ProjectionMatrix;
+	int m_ViewportWidth;
+	int m_ViewportHeight;
+	float m_Near;
+	float m_Far;
+	glm::vec4 m_ClusterParameters;
+
+	//View space bounds of every cluster, stored per axis so four can be tested at once
+	std::vector<float> m_ClusterMinX;
+	std::vector<float> m_ClusterMinY;
+	std::vector<float> m_ClusterMinZ;
+	std::vector<float> m_ClusterMaxX;
+	std::vector<float> m_ClusterMaxY;
+	std::vector<float> m_ClusterMaxZ;
+	//Near and far view depth of every slice, positive into the screen
+	std::vector<float> m_SliceDepths;
+
+	//This frame's lights in view space, read by every worker
+	std::vector<glm::vec4> m_ViewSpaceLights;
+	const std::vector<PointLight> * m_pLights;
+
+	//Each cluster has room for LIGHT_CLUSTER_MAX_LIGHTS indices, only ever written by the job that owns its slice
+	std::vector<unsigned short> m_ClusterLights;
+	std::vector<unsigned short> m_ClusterLightCounts;
+
+	//Packed for upload
+	std::vector<glm::vec4> m_LightData;
+	std::vector<unsigned int> m_GridData;
+	std::vector<unsigned short> m_IndexData;
+
+	std::vector<unsigned char> m_LightVisible;
+
+	unsigned int m_VisibleLightCount;
+	unsigned int m_LightReferenceCount;
+	//Longest index list the driver's buffer textures can hold
+	unsigned int m_MaxLightReferences;
+
+	GLuint m_LightDataBufferID;
+	GLuint m_LightDataTextureID;
+	GLuint m_GridBufferID;
+	GLuint m_GridTextureID;
+	GLuint m_IndexBufferID;
+	GLuint m_IndexTextureID;
+
+	//The pack job waits on the binning jobs, finishCull waits on the pack job
+	JobCounter m_BinCounter;
+	JobCounter m_PackCounter;
+	bool m_CullPending;
+};
@@ -0,0 +1,112 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	m_File = nullptr;
+	m_Mapping = nullptr;
+	m_pData = nullptr;
+	m_Size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string & filename)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void * pData = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (pData == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_File = file;
+	m_Mapping = mapping;
+	m_pData = (const unsigned char*)pData;
+	m_Size = (size_t)size.QuadPart;
+#else
+	int file = ::open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		::close(file);
+		return false;
+	}
+
+	void * pData = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	//The mapping keeps the file alive, the descriptor isn't needed any more
+	::close(file);
+	if (pData == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_pData = (const unsigned char*)pData;
+	m_Size = (size_t)fileStat.st_size;
+#endif
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_pData == nullptr)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_pData);
+	CloseHandle((HANDLE)m_Mapping);
+	CloseHandle((HANDLE)m_File);
+#else
+	munmap((void*)m_pData, m_Size);
+#endif
+
+	m_File = nullptr;
+	m_Mapping = nullptr;
+	m_pData = nullptr;
+	m_Size = 0;
+}
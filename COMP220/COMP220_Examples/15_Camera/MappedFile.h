@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+//Read only memory mapping of a whole file, the contents are paged in by the OS on first touch
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string& filename);
+	void close();
+
+	const unsigned char * getData()
+	{
+		return m_pData;
+	};
+
+	size_t getSize()
+	{
+		return m_Size;
+	};
+
+private:
+	//Platform handles, kept as void pointers so the header doesn't need windows.h
+	void * m_File;
+	void * m_Mapping;
+
+	const unsigned char * m_pData;
+	size_t m_Size;
+};
@@ -1,12 +1,22 @@
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include <cstddef>
 
 Mesh::Mesh()
 {
-	m_VBO=0;
-	m_EBO=0;
-	m_VAO=0;
-	m_NumberOfVertices=0;
-	m_NumberOfIndices=0;
+	static unsigned int nextSortID = 0;
+	m_SortID = nextSortID++;
+
+	m_pArena = nullptr;
+	m_Allocation = { 0, 0, 0, 0 };
+	m_NumberOfLods = 1;
+	for (unsigned int lod = 0; lod < MAX_MESH_LODS; lod++)
+	{
+		m_LodFirstIndex[lod] = 0;
+		m_LodNumberOfIndices[lod] = 0;
+	}
+	m_BoundingBox = { glm::vec3(0.0f), glm::vec3(0.0f) };
+	m_BoundingSphere = { glm::vec3(0.0f), 0.0f };
 }
 
 Mesh::~Mesh()
@@ -14,55 +24,112 @@ Mesh::~Mesh()
 	destroy();
 }
 
-void Mesh::init()
+void Mesh::copyBufferData(const VertexFormat& format, const PackedVertex * pVerts, const PackedColour * pColours, unsigned int numberOfVerts, const unsigned int * pIndices, unsigned int numberOfIndices,
+	const unsigned int * pLodIndexCounts, unsigned int numberOfLods)
 {
-	glGenVertexArrays(1, &m_VAO);
-	glBindVertexArray(m_VAO);
+	if (numberOfVerts <= MAX_SHORT_INDEX_VERTICES)
+	{
+		std::vector<uint16_t> shortIndices;
+		narrowIndices(pIndices, numberOfIndices, shortIndices);
+		upload(format, pVerts, pColours, numberOfVerts, shortIndices.data(), sizeof(uint16_t), numberOfIndices, pLodIndexCounts, numberOfLods);
+		return;
+	}
 
-	glGenBuffers(1, &m_VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-	glGenBuffers(1, &m_EBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+	upload(format, pVerts, pColours, numberOfVerts, pIndices, sizeof(unsigned int), numberOfIndices, pLodIndexCounts, numberOfLods);
 }
 
-void Mesh::copyBufferData(Vertex * pVerts, unsigned int numberOfVerts, unsigned int * pIndices, unsigned int numberOfIndices)
+void Mesh::copyBufferData(const VertexFormat & format, const PackedVertex * pVerts, const PackedColour * pColours, unsigned int numberOfVerts, const uint16_t * pIndices, unsigned int numberOfIndices,
+	const unsigned int * pLodIndexCounts, unsigned int numberOfLods)
 {
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-	glBufferData(GL_ARRAY_BUFFER, numberOfVerts * sizeof(Vertex), pVerts, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numberOfIndices * sizeof(unsigned int), pIndices, GL_STATIC_DRAW);
+	upload(format, pVerts, pColours, numberOfVerts, pIndices, sizeof(uint16_t), numberOfIndices, pLodIndexCounts, numberOfLods);
+}
 
-	m_NumberOfIndices = numberOfIndices;
-	m_NumberOfVertices = numberOfVerts;
-	glBindVertexArray(m_VAO);
-	// 1rst attribute buffer : vertices
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+void Mesh::upload(const VertexFormat & format, const PackedVertex * pVerts, const PackedColour * pColours, unsigned int numberOfVerts, const void * pIndices, GLuint indexSize, unsigned int numberOfIndices,
+	const unsigned int * pLodIndexCounts, unsigned int numberOfLods)
+{
+	destroy();
 
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
+	m_VertexFormat = format;
 
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(7 * sizeof(float)));
+	//LODs sit one after another in the index range, the first is the full mesh
+	if (pLodIndexCounts == nullptr || numberOfLods == 0)
+	{
+		pLodIndexCounts = &numberOfIndices;
+		numberOfLods = 1;
+	}
+	m_NumberOfLods = numberOfLods < MAX_MESH_LODS ? numberOfLods : MAX_MESH_LODS;
+	unsigned int lodFirstIndex = 0;
+	for (unsigned int lod = 0; lod < m_NumberOfLods; lod++)
+	{
+		m_LodFirstIndex[lod] = lodFirstIndex;
+		m_LodNumberOfIndices[lod] = pLodIndexCounts[lod];
+		lodFirstIndex += pLodIndexCounts[lod];
+	}
 
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(9 * sizeof(float)));
+	//Suballocate out of the shared buffers for this vertex format and index size instead of owning a VBO, EBO and VAO
+	GeometryArena * pArena = GeometryArena::get(format, indexSize);
+	if (!pArena->allocate(numberOfVerts, numberOfIndices, m_Allocation))
+	{
+		return;
+	}
+	m_pArena = pArena;
+	m_pArena->upload(m_Allocation, pVerts, pColours, pIndices);
 }
 
-void Mesh::render()
+void Mesh::renderInstanced(GLuint instanceBuffer, GLintptr instanceOffset, GLsizei count, unsigned int lod)
 {
-	glBindVertexArray(m_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+	if (m_pArena == nullptr)
+	{
+		return;
+	}
+
+	//Point the instance attributes at this batch's slice of the shared instance buffer
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(INSTANCE_ATTRIBUTE_MODEL_MATRIX + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(instanceOffset + offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribPointer(INSTANCE_ATTRIBUTE_AMBIENT_MATERIAL_COLOUR, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(instanceOffset + offsetof(InstanceData, ambientMaterialColour)));
+	glVertexAttribPointer(INSTANCE_ATTRIBUTE_DIFFUSE_MATERIAL_COLOUR, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(instanceOffset + offsetof(InstanceData, diffuseMaterialColour)));
+	glVertexAttribPointer(INSTANCE_ATTRIBUTE_SPECULAR_MATERIAL_COLOUR, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(instanceOffset + offsetof(InstanceData, specularMaterialColour)));
+	glVertexAttribPointer(INSTANCE_ATTRIBUTE_SPECULAR_POWER, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(instanceOffset + offsetof(InstanceData, specularPower)));
 
-	glDrawElements(GL_TRIANGLES, m_NumberOfIndices, GL_UNSIGNED_INT, (void*)0);
-	
+	GLuint firstIndex = m_Allocation.firstIndex + m_LodFirstIndex[lod];
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_LodNumberOfIndices[lod], m_pArena->getIndexType(), (void*)(uintptr_t)(firstIndex * m_pArena->getIndexSize()), count, m_Allocation.firstVertex);
 }
 
 void Mesh::destroy()
 {
-	glDeleteVertexArrays(1, &m_VAO);
-	glDeleteBuffers(1, &m_VBO);
-	glDeleteBuffers(1, &m_EBO);
+	if (m_pArena != nullptr)
+	{
+		m_pArena->free(m_Allocation);
+		m_pArena = nullptr;
+	}
+}
+
+float computeScreenCoverage(const BoundingSphere & worldSphere, const glm::mat4 & viewMatrix, float projectionScale)
+{
+	//Spheres the camera is inside of cover the whole screen
+	float distance = -(viewMatrix * glm::vec4(worldSphere.centre, 1.0f)).z;
+	if (distance <= worldSphere.radius)
+	{
+		return 1.0f;
+	}
+	return worldSphere.radius * projectionScale / distance;
+}
+
+unsigned int selectLod(float screenCoverage, unsigned int currentLod, unsigned int numberOfLods)
+{
+	static const float thresholds[MAX_MESH_LODS - 1] = { LOD_SCREEN_COVERAGE_1, LOD_SCREEN_COVERAGE_2, LOD_SCREEN_COVERAGE_3 };
+
+	unsigned int lod = currentLod < numberOfLods ? currentLod : numberOfLods - 1;
+	while (lod + 1 < numberOfLods && screenCoverage < thresholds[lod] * (1.0f - LOD_HYSTERESIS))
+	{
+		lod++;
+	}
+	while (lod > 0 && screenCoverage > thresholds[lod - 1] * (1.0f + LOD_HYSTERESIS))
+	{
+		lod--;
+	}
+	return lod;
 }
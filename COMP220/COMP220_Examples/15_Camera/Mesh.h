@@ -3,23 +3,124 @@
 #include <GL\glew.h>
 #include <SDL_opengl.h>
 
+#include <vector>
+#include <cstdint>
 
 #include "vertex.h"
+#include "VertexFormat.h"
+#include "InstanceData.h"
+#include "GeometryArena.h"
+#include "Bounds.h"
 
+//The full mesh plus up to three simplified versions, all drawn from the same vertices
+#define MAX_MESH_LODS 4
+//Fraction of the screen height an object's bounding sphere must shrink below before each LOD after the first takes over
+#define LOD_SCREEN_COVERAGE_1 0.25f
+#define LOD_SCREEN_COVERAGE_2 0.12f
+#define LOD_SCREEN_COVERAGE_3 0.05f
+//How far past a threshold an object must get before its LOD changes, so objects sitting on one don't flicker between two
+#define LOD_HYSTERESIS 0.1f
+
+//CPU side copy of a mesh in its packed vertex format, as produced by the importer before it is uploaded
+struct MeshData
+{
+	unsigned int vertexFormatFlags;
+	std::vector<PackedVertex> vertices;
+	//Empty unless the format has a colour stream
+	std::vector<PackedColour> colours;
+	//Kept at 32 bits until upload or cooking, narrowed to 16 there when there are few enough vertices.
+	//Every LOD's triangles back to back, starting with the full mesh
+	std::vector<unsigned int> indices;
+	//Number of indices in each LOD, empty is the same as a single LOD using all of them
+	std::vector<unsigned int> lodIndexCounts;
+
+	//Computed at import time
+	AABB boundingBox;
+	BoundingSphere boundingSphere;
+};
+
+//A range of vertices and indices inside the geometry arena for its vertex format
 class Mesh
 {
 public:
 	Mesh();
 	~Mesh();
 
-	void init();
-	void copyBufferData(Vertex *pVerts, unsigned int numberOfVerts, unsigned int *pIndices, unsigned int numberOfIndices);
-	void render();
+	//pColours is only read when the format has a colour stream. Meshes with at most MAX_SHORT_INDEX_VERTICES vertices
+	//are narrowed to 16 bit indices, halving the index memory and bandwidth. pIndices holds every LOD back to back with
+	//pLodIndexCounts giving each one's size, null for a mesh without LODs
+	void copyBufferData(const VertexFormat& format, const PackedVertex *pVerts, const PackedColour *pColours, unsigned int numberOfVerts, const unsigned int *pIndices, unsigned int numberOfIndices,
+		const unsigned int *pLodIndexCounts = nullptr, unsigned int numberOfLods = 0);
+	//Indices that are already 16 bit, straight from a cooked file
+	void copyBufferData(const VertexFormat& format, const PackedVertex *pVerts, const PackedColour *pColours, unsigned int numberOfVerts, const uint16_t *pIndices, unsigned int numberOfIndices,
+		const unsigned int *pLodIndexCounts = nullptr, unsigned int numberOfLods = 0);
+	//Draws count copies of one of the mesh's LODs, reading per instance data from instanceBuffer starting at instanceOffset bytes.
+	//The mesh's arena must already be bound
+	void renderInstanced(GLuint instanceBuffer, GLintptr instanceOffset, GLsizei count, unsigned int lod = 0);
 	void destroy();
+
+	const VertexFormat& getVertexFormat()
+	{
+		return m_VertexFormat;
+	};
+
+	GeometryArena * getArena()
+	{
+		return m_pArena;
+	};
+
+	void setBounds(const AABB& box, const BoundingSphere& sphere)
+	{
+		m_BoundingBox = box;
+		m_BoundingSphere = sphere;
+	};
+
+	//Model space bounds
+	const AABB& getBoundingBox()
+	{
+		return m_BoundingBox;
+	};
+
+	const BoundingSphere& getBoundingSphere()
+	{
+		return m_BoundingSphere;
+	};
+
+	unsigned int getNumberOfTriangles(unsigned int lod = 0)
+	{
+		return m_LodNumberOfIndices[lod] / 3;
+	};
+
+	unsigned int getNumberOfLods()
+	{
+		return m_NumberOfLods;
+	};
+
+	//Small number unique to this mesh, used in render queue sort keys
+	unsigned int getSortID()
+	{
+		return m_SortID;
+	};
 private:
-	GLuint m_VBO;
-	GLuint m_EBO;
-	GLuint m_VAO;
-	unsigned int m_NumberOfVertices;
-	unsigned int m_NumberOfIndices;
-};
\ No newline at end of file
+	void upload(const VertexFormat& format, const PackedVertex *pVerts, const PackedColour *pColours, unsigned int numberOfVerts, const void *pIndices, GLuint indexSize, unsigned int numberOfIndices,
+		const unsigned int *pLodIndexCounts, unsigned int numberOfLods);
+
+	unsigned int m_SortID;
+	VertexFormat m_VertexFormat;
+	GeometryArena * m_pArena;
+	GeometryAllocation m_Allocation;
+
+	//Ranges of the allocation's indices, every LOD shares all of its vertices
+	unsigned int m_NumberOfLods;
+	unsigned int m_LodFirstIndex[MAX_MESH_LODS];
+	unsigned int m_LodNumberOfIndices[MAX_MESH_LODS];
+
+	AABB m_BoundingBox;
+	BoundingSphere m_BoundingSphere;
+};
+
+//How much of the screen's height a bounding sphere covers, projectionScale is element [1][1] of the projection matrix
+float computeScreenCoverage(const BoundingSphere& worldSphere, const glm::mat4& viewMatrix, float projectionScale);
+
+//Picks the LOD for an object from its screen coverage, only moving away from currentLod once it's clearly past a threshold
+unsigned int selectLod(float screenCoverage, unsigned int currentLod, unsigned int numberOfLods);
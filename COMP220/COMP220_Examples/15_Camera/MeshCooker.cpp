@@ -0,0 +1,301 @@
+#include "MeshCooker.h"
+#include "MappedFile.h"
+#include "Model.h"
+#include "MeshOptimizer.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+
+//Blobs start on a 16 byte boundary so the mapped pointers are suitably aligned for any vertex type
+#define COOKED_MESH_ALIGNMENT 16
+
+static uint64_t alignOffset(uint64_t offset)
+{
+	return (offset + COOKED_MESH_ALIGNMENT - 1) & ~(uint64_t)(COOKED_MESH_ALIGNMENT - 1);
+}
+
+std::string getCookedMeshFilename(const std::string & sourceFilename)
+{
+	return sourceFilename + COOKED_MESH_EXTENSION;
+}
+
+bool isCookedFileStale(const std::string & sourceFilename, const std::string & cookedFilename)
+{
+	struct stat cookedStat;
+	if (stat(cookedFilename.c_str(), &cookedStat) != 0)
+	{
+		return true;
+	}
+
+	//A cooked file shipped without its source is always used
+	struct stat sourceStat;
+	if (stat(sourceFilename.c_str(), &sourceStat) != 0)
+	{
+		return false;
+	}
+
+	return cookedStat.st_mtime < sourceStat.st_mtime;
+}
+
+bool writeCookedMeshFile(const std::string & cookedFilename, const std::vector<MeshData>& meshData)
+{
+	CookedMeshHeader header;
+	header.magic = COOKED_MESH_MAGIC;
+	header.version = COOKED_MESH_VERSION;
+	header.vertexSize = sizeof(PackedVertex);
+	header.numberOfMeshes = (uint32_t)meshData.size();
+
+	//Work out where every blob will live before writing anything
+	std::vector<CookedMeshEntry> entries(meshData.size());
+	uint64_t offset = sizeof(CookedMeshHeader) + entries.size() * sizeof(CookedMeshEntry);
+	for (size_t i = 0; i < meshData.size(); i++)
+	{
+		entries[i].vertexFormatFlags = meshData[i].vertexFormatFlags;
+		entries[i].numberOfVertices = (uint32_t)meshData[i].vertices.size();
+		entries[i].numberOfIndices = (uint32_t)meshData[i].indices.size();
+		entries[i].indexSize = meshData[i].vertices.size() <= MAX_SHORT_INDEX_VERTICES ? sizeof(uint16_t) : sizeof(uint32_t);
+
+		const MeshData& data = meshData[i];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			entries[i].boundingBoxMin[axis] = data.boundingBox.min[axis];
+			entries[i].boundingBoxMax[axis] = data.boundingBox.max[axis];
+			entries[i].boundingSphere[axis] = data.boundingSphere.centre[axis];
+		}
+		entries[i].boundingSphere[3] = data.boundingSphere.radius;
+
+		//Meshes that never went through LOD generation are a single LOD of every index
+		entries[i].numberOfLods = data.lodIndexCounts.empty() ? 1 : (uint32_t)data.lodIndexCounts.size();
+		for (uint32_t lod = 0; lod < MAX_MESH_LODS; lod++)
+		{
+			entries[i].lodIndexCounts[lod] = lod < data.lodIndexCounts.size() ? data.lodIndexCounts[lod] : 0;
+		}
+		if (data.lodIndexCounts.empty())
+		{
+			entries[i].lodIndexCounts[0] = entries[i].numberOfIndices;
+		}
+		entries[i].lodPadding = 0;
+
+		entries[i].vertexOffset = alignOffset(offset);
+		offset = entries[i].vertexOffset + entries[i].numberOfVertices * sizeof(PackedVertex);
+
+		entries[i].colourOffset = 0;
+		if (VertexFormat(entries[i].vertexFormatFlags).hasColourStream())
+		{
+			entries[i].colourOffset = alignOffset(offset);
+			offset = entries[i].colourOffset + entries[i].numberOfVertices * sizeof(PackedColour);
+		}
+
+		entries[i].indexOffset = alignOffset(offset);
+		offset = entries[i].indexOffset + entries[i].numberOfIndices * entries[i].indexSize;
+	}
+
+	FILE * pFile = fopen(cookedFilename.c_str(), "wb");
+	if (pFile == nullptr)
+	{
+		printf("Could not write cooked mesh %s\n", cookedFilename.c_str());
+		return false;
+	}
+
+	static const unsigned char padding[COOKED_MESH_ALIGNMENT] = { 0 };
+	uint64_t written = 0;
+	std::vector<uint16_t> shortIndices;
+
+	written += fwrite(&header, 1, sizeof(CookedMeshHeader), pFile);
+	written += fwrite(entries.data(), 1, entries.size() * sizeof(CookedMeshEntry), pFile);
+	for (size_t i = 0; i < meshData.size(); i++)
+	{
+		written += fwrite(padding, 1, entries[i].vertexOffset - written, pFile);
+		written += fwrite(meshData[i].vertices.data(), 1, meshData[i].vertices.size() * sizeof(PackedVertex), pFile);
+
+		if (entries[i].colourOffset != 0)
+		{
+			written += fwrite(padding, 1, entries[i].colourOffset - written, pFile);
+			written += fwrite(meshData[i].colours.data(), 1, meshData[i].colours.size() * sizeof(PackedColour), pFile);
+		}
+
+		written += fwrite(padding, 1, entries[i].indexOffset - written, pFile);
+		if (entries[i].indexSize == sizeof(uint16_t))
+		{
+			narrowIndices(meshData[i].indices.data(), entries[i].numberOfIndices, shortIndices);
+			written += fwrite(shortIndices.data(), 1, shortIndices.size() * sizeof(uint16_t), pFile);
+		}
+		else
+		{
+			written += fwrite(meshData[i].indices.data(), 1, meshData[i].indices.size() * sizeof(uint32_t), pFile);
+		}
+	}
+
+	fclose(pFile);
+
+	if (written != offset)
+	{
+		printf("Failed writing cooked mesh %s\n", cookedFilename.c_str());
+		remove(cookedFilename.c_str());
+		return false;
+	}
+	return true;
+}
+
+//Checks the header and every entry's ranges against the file size, returns null if the file can't be used
+static const CookedMeshHeader * validateCookedMeshFile(MappedFile& file, const std::string & cookedFilename)
+{
+	const unsigned char * pData = file.getData();
+	size_t size = file.getSize();
+
+	if (size < sizeof(CookedMeshHeader))
+	{
+		return nullptr;
+	}
+
+	const CookedMeshHeader * pHeader = (const CookedMeshHeader*)pData;
+	if (pHeader->magic != COOKED_MESH_MAGIC || pHeader->version != COOKED_MESH_VERSION || pHeader->vertexSize != sizeof(PackedVertex))
+	{
+		printf("Cooked mesh %s is out of date, ignoring it\n", cookedFilename.c_str());
+		return nullptr;
+	}
+
+	const CookedMeshEntry * pEntries = (const CookedMeshEntry*)(pData + sizeof(CookedMeshHeader));
+	if (sizeof(CookedMeshHeader) + pHeader->numberOfMeshes * sizeof(CookedMeshEntry) > size)
+	{
+		return nullptr;
+	}
+
+	//Validate every range before creating anything so a truncated file can't leave half a model behind
+	for (uint32_t i = 0; i < pHeader->numberOfMeshes; i++)
+	{
+		const CookedMeshEntry& entry = pEntries[i];
+		bool hasColours = VertexFormat(entry.vertexFormatFlags).hasColourStream();
+		uint64_t lodIndices = 0;
+		for (uint32_t lod = 0; lod < entry.numberOfLods && lod < MAX_MESH_LODS; lod++)
+		{
+			lodIndices += entry.lodIndexCounts[lod];
+		}
+		if ((entry.indexSize != sizeof(uint16_t) && entry.indexSize != sizeof(uint32_t)) ||
+			entry.numberOfLods == 0 || entry.numberOfLods > MAX_MESH_LODS || lodIndices != entry.numberOfIndices ||
+			entry.vertexOffset + (uint64_t)entry.numberOfVertices * sizeof(PackedVertex) > size ||
+			(hasColours && (entry.colourOffset == 0 || entry.colourOffset + (uint64_t)entry.numberOfVertices * sizeof(PackedColour) > size)) ||
+			entry.indexOffset + (uint64_t)entry.numberOfIndices * entry.indexSize > size)
+		{
+			printf("Cooked mesh %s is truncated\n", cookedFilename.c_str());
+			return nullptr;
+		}
+	}
+
+	return pHeader;
+}
+
+bool loadCookedMeshFile(const std::string & cookedFilename, std::vector<Mesh*>& meshes)
+{
+	MappedFile file;
+	if (!file.open(cookedFilename))
+	{
+		return false;
+	}
+
+	const CookedMeshHeader * pHeader = validateCookedMeshFile(file, cookedFilename);
+	if (pHeader == nullptr)
+	{
+		return false;
+	}
+	const unsigned char * pData = file.getData();
+	const CookedMeshEntry * pEntries = (const CookedMeshEntry*)(pData + sizeof(CookedMeshHeader));
+
+	//The mapped ranges go straight to the driver, no intermediate copy
+	for (uint32_t i = 0; i < pHeader->numberOfMeshes; i++)
+	{
+		const CookedMeshEntry& entry = pEntries[i];
+
+		Mesh *pMesh = new Mesh();
+		VertexFormat format(entry.vertexFormatFlags);
+		const PackedColour * pColours = format.hasColourStream() ? (const PackedColour*)(pData + entry.colourOffset) : nullptr;
+		const PackedVertex * pVertices = (const PackedVertex*)(pData + entry.vertexOffset);
+		if (entry.indexSize == sizeof(uint16_t))
+		{
+			pMesh->copyBufferData(format, pVertices, pColours, entry.numberOfVertices, (const uint16_t*)(pData + entry.indexOffset), entry.numberOfIndices,
+				entry.lodIndexCounts, entry.numberOfLods);
+		}
+		else
+		{
+			pMesh->copyBufferData(format, pVertices, pColours, entry.numberOfVertices, (const unsigned int*)(pData + entry.indexOffset), entry.numberOfIndices,
+				entry.lodIndexCounts, entry.numberOfLods);
+		}
+
+		AABB box = { glm::vec3(entry.boundingBoxMin[0], entry.boundingBoxMin[1], entry.boundingBoxMin[2]), glm::vec3(entry.boundingBoxMax[0], entry.boundingBoxMax[1], entry.boundingBoxMax[2]) };
+		BoundingSphere sphere = { glm::vec3(entry.boundingSphere[0], entry.boundingSphere[1], entry.boundingSphere[2]), entry.boundingSphere[3] };
+		pMesh->setBounds(box, sphere);
+
+		meshes.push_back(pMesh);
+	}
+
+	return true;
+}
+
+bool loadCookedMeshData(const std::string & cookedFilename, std::vector<MeshData>& meshData)
+{
+	MappedFile file;
+	if (!file.open(cookedFilename))
+	{
+		return false;
+	}
+
+	const CookedMeshHeader * pHeader = validateCookedMeshFile(file, cookedFilename);
+	if (pHeader == nullptr)
+	{
+		return false;
+	}
+	const unsigned char * pData = file.getData();
+	const CookedMeshEntry * pEntries = (const CookedMeshEntry*)(pData + sizeof(CookedMeshHeader));
+
+	meshData.resize(pHeader->numberOfMeshes);
+	for (uint32_t i = 0; i < pHeader->numberOfMeshes; i++)
+	{
+		const CookedMeshEntry& entry = pEntries[i];
+		MeshData& data = meshData[i];
+
+		data.vertexFormatFlags = entry.vertexFormatFlags;
+		const PackedVertex * pVertices = (const PackedVertex*)(pData + entry.vertexOffset);
+		data.vertices.assign(pVertices, pVertices + entry.numberOfVertices);
+		data.colours.clear();
+		if (VertexFormat(entry.vertexFormatFlags).hasColourStream())
+		{
+			const PackedColour * pColours = (const PackedColour*)(pData + entry.colourOffset);
+			data.colours.assign(pColours, pColours + entry.numberOfVertices);
+		}
+
+		if (entry.indexSize == sizeof(uint16_t))
+		{
+			const uint16_t * pIndices = (const uint16_t*)(pData + entry.indexOffset);
+			data.indices.assign(pIndices, pIndices + entry.numberOfIndices);
+		}
+		else
+		{
+			const uint32_t * pIndices = (const uint32_t*)(pData + entry.indexOffset);
+			data.indices.assign(pIndices, pIndices + entry.numberOfIndices);
+		}
+		data.lodIndexCounts.assign(entry.lodIndexCounts, entry.lodIndexCounts + entry.numberOfLods);
+
+		data.boundingBox = { glm::vec3(entry.boundingBoxMin[0], entry.boundingBoxMin[1], entry.boundingBoxMin[2]), glm::vec3(entry.boundingBoxMax[0], entry.boundingBoxMax[1], entry.boundingBoxMax[2]) };
+		data.boundingSphere = { glm::vec3(entry.boundingSphere[0], entry.boundingSphere[1], entry.boundingSphere[2]), entry.boundingSphere[3] };
+	}
+
+	return true;
+}
+
+bool cookMeshFile(const std::string & sourceFilename)
+{
+	std::vector<MeshData> meshData;
+	if (!importMeshData(sourceFilename, meshData))
+	{
+		return false;
+	}
+
+	std::string cookedFilename = getCookedMeshFilename(sourceFilename);
+	if (!writeCookedMeshFile(cookedFilename, meshData))
+	{
+		return false;
+	}
+
+	printf("Cooked %s -> %s (%u meshes)\n", sourceFilename.c_str(), cookedFilename.c_str(), (unsigned int)meshData.size());
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Mesh.h"
+
+//Cooked mesh files hold the already processed vertex and index arrays for every mesh in a model,
+//laid out exactly as the GPU wants them so they can be memory mapped and uploaded without any parsing
+#define COOKED_MESH_MAGIC 0x3148534D
+#define COOKED_MESH_VERSION 5
+#define COOKED_MESH_EXTENSION ".mesh"
+
+struct CookedMeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexSize;
+	uint32_t numberOfMeshes;
+};
+
+//One per mesh, straight after the header. Offsets are from the start of the file
+struct CookedMeshEntry
+{
+	uint32_t vertexFormatFlags;
+	uint32_t numberOfVertices;
+	//Every LOD's indices together
+	uint32_t numberOfIndices;
+	//2 when the mesh has few enough vertices for 16 bit indices, otherwise 4
+	uint32_t indexSize;
+	uint64_t vertexOffset;
+	//Zero if the format has no colour stream
+	uint64_t colourOffset;
+	uint64_t indexOffset;
+	//Model space bounds computed at import, sphere is centre xyz then radius
+	float boundingBoxMin[3];
+	float boundingBoxMax[3];
+	float boundingSphere[4];
+	//Index count of each LOD, they follow each other in the index blob starting with the full mesh
+	uint32_t numberOfLods;
+	uint32_t lodIndexCounts[MAX_MESH_LODS];
+	uint32_t lodPadding;
+};
+
+std::string getCookedMeshFilename(const std::string& sourceFilename);
+
+//True if the cooked file is missing or older than its source, used for every kind of cooked asset
+bool isCookedFileStale(const std::string& sourceFilename, const std::string& cookedFilename);
+
+bool writeCookedMeshFile(const std::string& cookedFilename, const std::vector<MeshData>& meshData);
+
+bool loadCookedMeshFile(const std::string& cookedFilename, std::vector<Mesh*>& meshes);
+
+//Reads a cooked file back into CPU side data with 32 bit indices, for code that needs the geometry itself rather than GPU meshes
+bool loadCookedMeshData(const std::string& cookedFilename, std::vector<MeshData>& meshData);
+
+//Offline cook of a source model, imports it through Assimp and writes the cooked file next to it
+bool cookMeshFile(const std::string& sourceFilename);
@@ -0,0 +1,243 @@
+#include "MeshOptimizer.h"
+
+#include <cmath>
+#include <algorithm>
+
+//Scoring constants from Forsyth's paper
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRIANGLE_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+float computeACMR(const unsigned int * pIndices, unsigned int numberOfIndices, unsigned int numberOfVertices, unsigned int cacheSize)
+{
+	if (numberOfIndices < 3)
+	{
+		return 0.0f;
+	}
+
+	//A vertex is still cached if fewer than cacheSize misses have happened since it was last loaded
+	std::vector<unsigned int> loadedAt(numberOfVertices, 0);
+	unsigned int misses = 0;
+	for (unsigned int i = 0; i < numberOfIndices; i++)
+	{
+		unsigned int vertex = pIndices[i];
+		if (loadedAt[vertex] == 0 || misses - loadedAt[vertex] >= cacheSize)
+		{
+			misses++;
+			loadedAt[vertex] = misses;
+		}
+	}
+
+	return (float)misses / (numberOfIndices / 3);
+}
+
+static float scoreVertex(int cachePosition, unsigned int remainingTriangles)
+{
+	//Nothing left to draw with it, so it should never pull a triangle in
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		//The last triangle's three vertices score the same, otherwise it would favour one way round the triangle
+		if (cachePosition < 3)
+		{
+			score = FORSYTH_LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			float scale = 1.0f / (MESH_OPTIMIZER_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scale, FORSYTH_CACHE_DECAY_POWER);
+		}
+	}
+
+	//Finishing off vertices with only a few triangles left stops lone triangles being stranded for later
+	score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+	return score;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numberOfVertices)
+{
+	unsigned int numberOfTriangles = (unsigned int)indices.size() / 3;
+	if (numberOfTriangles == 0)
+	{
+		return;
+	}
+
+	//Triangles using each vertex, packed into one array with an offset per vertex
+	std::vector<unsigned int> remainingTriangles(numberOfVertices, 0);
+	for (unsigned int index : indices)
+	{
+		remainingTriangles[index]++;
+	}
+	std::vector<unsigned int> adjacencyOffsets(numberOfVertices + 1, 0);
+	for (unsigned int v = 0; v < numberOfVertices; v++)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+	}
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> adjacencyCount(numberOfVertices, 0);
+	for (unsigned int t = 0; t < numberOfTriangles; t++)
+	{
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = indices[t * 3 + corner];
+			adjacency[adjacencyOffsets[vertex] + adjacencyCount[vertex]++] = t;
+		}
+	}
+
+	std::vector<int> cachePosition(numberOfVertices, -1);
+	std::vector<float> vertexScore(numberOfVertices);
+	for (unsigned int v = 0; v < numberOfVertices; v++)
+	{
+		vertexScore[v] = scoreVertex(-1, remainingTriangles[v]);
+	}
+
+	std::vector<bool> triangleAdded(numberOfTriangles, false);
+
+	//Three extra slots hold what gets pushed out of the cache by the triangle just added
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	cache.reserve(MESH_OPTIMIZER_CACHE_SIZE + 3);
+	newCache.reserve(MESH_OPTIMIZER_CACHE_SIZE + 3);
+
+	std::vector<unsigned int> optimized;
+	optimized.reserve(indices.size());
+
+	//Used when no cached vertex has a triangle left, the start point moves forward so the search stays linear overall
+	unsigned int nextUnaddedTriangle = 0;
+	int bestTriangle = -1;
+
+	for (unsigned int added = 0; added < numberOfTriangles; added++)
+	{
+		if (bestTriangle < 0)
+		{
+			while (triangleAdded[nextUnaddedTriangle])
+			{
+				nextUnaddedTriangle++;
+			}
+			bestTriangle = nextUnaddedTriangle;
+		}
+
+		unsigned int triangle = (unsigned int)bestTriangle;
+		triangleAdded[triangle] = true;
+
+		//Emit the triangle and take it out of its vertices' adjacency lists
+		newCache.clear();
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = indices[triangle * 3 + corner];
+			optimized.push_back(vertex);
+			newCache.push_back(vertex);
+
+			unsigned int * pTriangles = &adjacency[adjacencyOffsets[vertex]];
+			unsigned int count = remainingTriangles[vertex];
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (pTriangles[i] == triangle)
+				{
+					pTriangles[i] = pTriangles[count - 1];
+					break;
+				}
+			}
+			remainingTriangles[vertex]--;
+		}
+
+		//The triangle's vertices move to the front and everything else shuffles back
+		for (unsigned int vertex : cache)
+		{
+			if (vertex != newCache[0] && vertex != newCache[1] && vertex != newCache[2])
+			{
+				newCache.push_back(vertex);
+			}
+		}
+
+		for (unsigned int i = 0; i < newCache.size(); i++)
+		{
+			unsigned int vertex = newCache[i];
+			cachePosition[vertex] = i < MESH_OPTIMIZER_CACHE_SIZE ? (int)i : -1;
+			vertexScore[vertex] = scoreVertex(cachePosition[vertex], remainingTriangles[vertex]);
+		}
+
+		//Only triangles touching a vertex whose score changed need rescoring, and the best of those goes next
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (unsigned int vertex : newCache)
+		{
+			const unsigned int * pTriangles = &adjacency[adjacencyOffsets[vertex]];
+			for (unsigned int i = 0; i < remainingTriangles[vertex]; i++)
+			{
+				unsigned int t = pTriangles[i];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = (int)t;
+				}
+			}
+		}
+
+		if (newCache.size() > MESH_OPTIMIZER_CACHE_SIZE)
+		{
+			newCache.resize(MESH_OPTIMIZER_CACHE_SIZE);
+		}
+		cache.swap(newCache);
+	}
+
+	indices.swap(optimized);
+}
+
+void optimizeVertexFetch(MeshData & data)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(data.vertices.size(), unused);
+	std::vector<PackedVertex> vertices;
+	std::vector<PackedColour> colours;
+	vertices.reserve(data.vertices.size());
+	colours.reserve(data.colours.size());
+
+	for (unsigned int& index : data.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)vertices.size();
+			vertices.push_back(data.vertices[index]);
+			if (!data.colours.empty())
+			{
+				colours.push_back(data.colours[index]);
+			}
+		}
+		index = remap[index];
+	}
+
+	data.vertices.swap(vertices);
+	data.colours.swap(colours);
+}
+
+MeshOptimizerStats optimizeMeshData(MeshData & data)
+{
+	MeshOptimizerStats stats;
+	stats.verticesBefore = (unsigned int)data.vertices.size();
+	stats.acmrBefore = computeACMR(data.indices.data(), (unsigned int)data.indices.size(), stats.verticesBefore);
+
+	//Triangle order first, the vertex order then follows the new triangle order
+	optimizeVertexCache(data.indices, stats.verticesBefore);
+	optimizeVertexFetch(data);
+
+	stats.verticesAfter = (unsigned int)data.vertices.size();
+	stats.acmrAfter = computeACMR(data.indices.data(), (unsigned int)data.indices.size(), stats.verticesAfter);
+	return stats;
+}
+
+void narrowIndices(const unsigned int * pIndices, unsigned int numberOfIndices, std::vector<uint16_t>& shortIndices)
+{
+	shortIndices.resize(numberOfIndices);
+	for (unsigned int i = 0; i < numberOfIndices; i++)
+	{
+		shortIndices[i] = (uint16_t)pIndices[i];
+	}
+}
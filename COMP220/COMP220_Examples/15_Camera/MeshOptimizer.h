@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Mesh.h"
+
+//Size of the post transform vertex cache the triangle order is tuned for and measured against
+#define MESH_OPTIMIZER_CACHE_SIZE 32
+//Meshes with at most this many vertices are drawn with 16 bit indices
+#define MAX_SHORT_INDEX_VERTICES 65536
+
+//Vertex cache statistics for one mesh before and after optimizeMeshData
+struct MeshOptimizerStats
+{
+	//Average cache miss ratio, vertices shaded per triangle. 3 is the worst possible, around 0.6 is very good
+	float acmrBefore;
+	float acmrAfter;
+	unsigned int verticesBefore;
+	unsigned int verticesAfter;
+};
+
+//Simulates a FIFO post transform cache of cacheSize vertices over the index list and returns vertices shaded per triangle
+float computeACMR(const unsigned int * pIndices, unsigned int numberOfIndices, unsigned int numberOfVertices, unsigned int cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+
+//Reorders triangles so neighbouring triangles reuse vertices still in the post transform cache, using Tom Forsyth's
+//linear speed vertex cache optimisation. Each step greedily takes the triangle whose vertices score best, favouring
+//vertices recently used and vertices with few triangles left so they can drop out of the cache for good
+void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numberOfVertices);
+
+//Renumbers vertices in the order the index list first uses them so vertex fetches walk forwards through memory.
+//Vertices no triangle uses are dropped
+void optimizeVertexFetch(MeshData& data);
+
+//Runs both passes over an imported mesh
+MeshOptimizerStats optimizeMeshData(MeshData& data);
+
+//Copies indices down to 16 bits, only valid when every index is below MAX_SHORT_INDEX_VERTICES
+void narrowIndices(const unsigned int * pIndices, unsigned int numberOfIndices, std::vector<uint16_t>& shortIndices);
@@ -0,0 +1,377 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+
+#include <glm\gtc\packing.hpp>
+
+//Collapses are spread over several passes, each only touches a vertex once so the flip checks stay valid
+#define MESH_SIMPLIFY_MAX_PASSES 32
+
+//Symmetric 4x4 matrix summing the squared distance to a set of planes, stored as its upper triangle
+struct Quadric
+{
+	double aa, ab, ac, ad;
+	double bb, bc, bd;
+	double cc, cd;
+	double dd;
+};
+
+static void addPlane(Quadric& quadric, const glm::dvec4& plane, double weight)
+{
+	quadric.aa += weight * plane.x * plane.x;
+	quadric.ab += weight * plane.x * plane.y;
+	quadric.ac += weight * plane.x * plane.z;
+	quadric.ad += weight * plane.x * plane.w;
+	quadric.bb += weight * plane.y * plane.y;
+	quadric.bc += weight * plane.y * plane.z;
+	quadric.bd += weight * plane.y * plane.w;
+	quadric.cc += weight * plane.z * plane.z;
+	quadric.cd += weight * plane.z * plane.w;
+	quadric.dd += weight * plane.w * plane.w;
+}
+
+static void addQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.aa += other.aa;
+	quadric.ab += other.ab;
+	quadric.ac += other.ac;
+	quadric.ad += other.ad;
+	quadric.bb += other.bb;
+	quadric.bc += other.bc;
+	quadric.bd += other.bd;
+	quadric.cc += other.cc;
+	quadric.cd += other.cd;
+	quadric.dd += other.dd;
+}
+
+//v^T Q v with v = (x, y, z, 1)
+static double evaluateQuadric(const Quadric& q, const glm::vec3& position)
+{
+	double x = position.x;
+	double y = position.y;
+	double z = position.z;
+	return q.aa * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x +
+		q.bb * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y +
+		q.cc * z * z + 2.0 * q.cd * z + q.dd;
+}
+
+//Moving one end of an edge onto the other
+struct Collapse
+{
+	double cost;
+	unsigned int from;
+	unsigned int to;
+
+	bool operator<(const Collapse& other) const
+	{
+		return cost < other.cost;
+	};
+};
+
+void simplifyMesh(const std::vector<PackedVertex>& vertices, const unsigned int * pIndices, unsigned int numberOfIndices, unsigned int targetIndexCount, std::vector<unsigned int>& result)
+{
+	result.assign(pIndices, pIndices + numberOfIndices);
+	if (numberOfIndices <= targetIndexCount)
+	{
+		return;
+	}
+
+	//Weld vertices sharing a position, collapses work on positions and the vertices just follow them
+	unsigned int numberOfVertices = (unsigned int)vertices.size();
+	std::map<std::tuple<float, float, float>, unsigned int> positionLookup;
+	std::vector<unsigned int> vertexPosition(numberOfVertices);
+	std::vector<glm::vec3> positions;
+	for (unsigned int v = 0; v < numberOfVertices; v++)
+	{
+		auto key = std::make_tuple(vertices[v].x, vertices[v].y, vertices[v].z);
+		auto iter = positionLookup.find(key);
+		if (iter == positionLookup.end())
+		{
+			iter = positionLookup.insert(std::make_pair(key, (unsigned int)positions.size())).first;
+			positions.push_back(glm::vec3(vertices[v].x, vertices[v].y, vertices[v].z));
+		}
+		vertexPosition[v] = iter->second;
+	}
+	unsigned int numberOfPositions = (unsigned int)positions.size();
+
+	//Vertices at each position, for picking the attributes a moved corner should take
+	std::vector<unsigned int> positionVertexOffsets(numberOfPositions + 1, 0);
+	for (unsigned int v = 0; v < numberOfVertices; v++)
+	{
+		positionVertexOffsets[vertexPosition[v] + 1]++;
+	}
+	for (unsigned int p = 0; p < numberOfPositions; p++)
+	{
+		positionVertexOffsets[p + 1] += positionVertexOffsets[p];
+	}
+	std::vector<unsigned int> positionVertices(numberOfVertices);
+	std::vector<unsigned int> positionVertexFill(positionVertexOffsets.begin(), positionVertexOffsets.end() - 1);
+	for (unsigned int v = 0; v < numberOfVertices; v++)
+	{
+		positionVertices[positionVertexFill[vertexPosition[v]]++] = v;
+	}
+
+	std::vector<glm::vec3> normals(numberOfVertices);
+	std::vector<glm::vec2> textureCoords(numberOfVertices);
+	for (unsigned int v = 0; v < numberOfVertices; v++)
+	{
+		normals[v] = glm::vec3(glm::unpackSnorm3x10_1x2(vertices[v].normal));
+		textureCoords[v] = glm::unpackHalf2x16(vertices[v].textureCoords);
+	}
+
+	//Every triangle's plane, weighted by its area, goes into the quadric of each of its corners
+	std::vector<Quadric> quadrics(numberOfPositions, Quadric{});
+	for (unsigned int i = 0; i < numberOfIndices; i += 3)
+	{
+		glm::vec3 p0 = positions[vertexPosition[result[i]]];
+		glm::vec3 p1 = positions[vertexPosition[result[i + 1]]];
+		glm::vec3 p2 = positions[vertexPosition[result[i + 2]]];
+		glm::dvec3 normal = glm::cross(glm::dvec3(p1 - p0), glm::dvec3(p2 - p0));
+		double doubleArea = glm::length(normal);
+		if (doubleArea <= 0.0)
+		{
+			continue;
+		}
+		normal /= doubleArea;
+		glm::dvec4 plane(normal, -glm::dot(normal, glm::dvec3(p0)));
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			addPlane(quadrics[vertexPosition[result[i + corner]]], plane, doubleArea * 0.5);
+		}
+	}
+
+	std::vector<unsigned int> collapseTo(numberOfPositions);
+	std::vector<bool> locked(numberOfPositions);
+	std::vector<bool> touched(numberOfPositions);
+	std::vector<uint64_t> edges;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> triangleOffsets(numberOfPositions + 1);
+	std::vector<unsigned int> triangleFill;
+	std::vector<unsigned int> positionTriangles;
+
+	for (int pass = 0; pass < MESH_SIMPLIFY_MAX_PASSES && result.size() > targetIndexCount; pass++)
+	{
+		unsigned int numberOfTriangles = (unsigned int)result.size() / 3;
+
+		//An edge only one triangle uses is on an open border, moving either end would eat into the outline
+		edges.clear();
+		for (unsigned int i = 0; i < result.size(); i += 3)
+		{
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				uint64_t a = vertexPosition[result[i + corner]];
+				uint64_t b = vertexPosition[result[i + (corner + 1) % 3]];
+				edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		std::fill(locked.begin(), locked.end(), false);
+		for (size_t i = 0; i < edges.size(); )
+		{
+			size_t end = i + 1;
+			while (end < edges.size() && edges[end] == edges[i])
+			{
+				end++;
+			}
+			if (end - i == 1)
+			{
+				locked[edges[i] >> 32] = true;
+				locked[edges[i] & 0xFFFFFFFF] = true;
+			}
+			i = end;
+		}
+
+		//Triangles around each position, for the flip checks
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (unsigned int index : result)
+		{
+			triangleOffsets[vertexPosition[index] + 1]++;
+		}
+		for (unsigned int p = 0; p < numberOfPositions; p++)
+		{
+			triangleOffsets[p + 1] += triangleOffsets[p];
+		}
+		positionTriangles.resize(result.size());
+		triangleFill.assign(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (unsigned int i = 0; i < result.size(); i++)
+		{
+			positionTriangles[triangleFill[vertexPosition[result[i]]]++] = i / 3;
+		}
+
+		//Each edge collapses towards whichever end costs less
+		collapses.clear();
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+		for (uint64_t edge : edges)
+		{
+			unsigned int a = (unsigned int)(edge >> 32);
+			unsigned int b = (unsigned int)(edge & 0xFFFFFFFF);
+			if (a == b || (locked[a] && locked[b]))
+			{
+				continue;
+			}
+
+			Quadric combined = quadrics[a];
+			addQuadric(combined, quadrics[b]);
+			double costToB = locked[a] ? DBL_MAX : evaluateQuadric(combined, positions[b]);
+			double costToA = locked[b] ? DBL_MAX : evaluateQuadric(combined, positions[a]);
+			if (costToB <= costToA)
+			{
+				collapses.push_back({ costToB, a, b });
+			}
+			else
+			{
+				collapses.push_back({ costToA, b, a });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		//Every collapse removes about two triangles
+		unsigned int wantedCollapses = (numberOfTriangles - targetIndexCount / 3) / 2 + 1;
+		unsigned int madeCollapses = 0;
+		for (unsigned int p = 0; p < numberOfPositions; p++)
+		{
+			collapseTo[p] = p;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (madeCollapses >= wantedCollapses)
+			{
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to])
+			{
+				continue;
+			}
+
+			//Triangles that survive the collapse must keep facing the same way
+			bool flips = false;
+			for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; t++)
+			{
+				unsigned int triangle = positionTriangles[t];
+				unsigned int corners[3];
+				bool hasTo = false;
+				for (unsigned int corner = 0; corner < 3; corner++)
+				{
+					corners[corner] = vertexPosition[result[triangle * 3 + corner]];
+					hasTo = hasTo || corners[corner] == collapse.to;
+				}
+				if (hasTo)
+				{
+					continue;
+				}
+
+				glm::vec3 oldNormal = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+				for (unsigned int corner = 0; corner < 3; corner++)
+				{
+					if (corners[corner] == collapse.from)
+					{
+						corners[corner] = collapse.to;
+					}
+				}
+				glm::vec3 newNormal = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+				flips = glm::dot(oldNormal, newNormal) <= 0.0f;
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			collapseTo[collapse.from] = collapse.to;
+			addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			madeCollapses++;
+
+			//Anything sharing a triangle with the moved position now has a different neighbourhood, so it waits for the next pass
+			for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+			{
+				unsigned int triangle = positionTriangles[t];
+				for (unsigned int corner = 0; corner < 3; corner++)
+				{
+					touched[vertexPosition[result[triangle * 3 + corner]]] = true;
+				}
+			}
+		}
+
+		if (madeCollapses == 0)
+		{
+			break;
+		}
+
+		//Move the collapsed corners and drop the triangles that became degenerate
+		unsigned int write = 0;
+		for (unsigned int i = 0; i < result.size(); i += 3)
+		{
+			unsigned int triangle[3];
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = result[i + corner];
+				unsigned int target = collapseTo[vertexPosition[vertex]];
+				if (target != vertexPosition[vertex])
+				{
+					//The vertex at the new position that looks most like the old one
+					float bestDifference = FLT_MAX;
+					unsigned int bestVertex = positionVertices[positionVertexOffsets[target]];
+					for (unsigned int j = positionVertexOffsets[target]; j < positionVertexOffsets[target + 1]; j++)
+					{
+						unsigned int candidate = positionVertices[j];
+						float difference = (1.0f - glm::dot(normals[vertex], normals[candidate])) + glm::length(textureCoords[vertex] - textureCoords[candidate]);
+						if (difference < bestDifference)
+						{
+							bestDifference = difference;
+							bestVertex = candidate;
+						}
+					}
+					vertex = bestVertex;
+				}
+				triangle[corner] = vertex;
+			}
+
+			unsigned int p0 = vertexPosition[triangle[0]];
+			unsigned int p1 = vertexPosition[triangle[1]];
+			unsigned int p2 = vertexPosition[triangle[2]];
+			if (p0 == p1 || p1 == p2 || p2 == p0)
+			{
+				continue;
+			}
+			result[write++] = triangle[0];
+			result[write++] = triangle[1];
+			result[write++] = triangle[2];
+		}
+		result.resize(write);
+	}
+}
+
+void generateMeshLods(MeshData & data)
+{
+	data.lodIndexCounts.assign(1, (unsigned int)data.indices.size());
+	if (data.indices.size() / 3 < MESH_LOD_MIN_TRIANGLES)
+	{
+		return;
+	}
+
+	std::vector<unsigned int> simplified;
+	unsigned int previousOffset = 0;
+	unsigned int previousCount = (unsigned int)data.indices.size();
+	for (unsigned int lod = 1; lod < MAX_MESH_LODS; lod++)
+	{
+		unsigned int targetCount = (unsigned int)(previousCount / 3 * MESH_LOD_REDUCTION) * 3;
+		simplifyMesh(data.vertices, &data.indices[previousOffset], previousCount, targetCount, simplified);
+		if (simplified.empty() || simplified.size() > previousCount * MESH_LOD_MIN_REDUCTION)
+		{
+			break;
+		}
+
+		optimizeVertexCache(simplified, (unsigned int)data.vertices.size());
+		previousOffset = (unsigned int)data.indices.size();
+		previousCount = (unsigned int)simplified.size();
+		data.indices.insert(data.indices.end(), simplified.begin(), simplified.end());
+		data.lodIndexCounts.push_back(previousCount);
+	}
+}
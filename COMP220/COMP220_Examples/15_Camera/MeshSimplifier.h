@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "Mesh.h"
+
+//Each LOD aims for this fraction of the previous one's triangles
+#define MESH_LOD_REDUCTION 0.5f
+//A LOD that can't get below this fraction of the previous one isn't worth keeping, the chain stops there
+#define MESH_LOD_MIN_REDUCTION 0.8f
+//Meshes this small aren't simplified at all
+#define MESH_LOD_MIN_TRIANGLES 64
+
+//Quadric error metric edge collapse after Garland and Heckbert. Vertices are welded by position first so
+//seams and hard edges don't stop the mesh from collapsing, and every collapse moves one position onto the other
+//end of its edge, so the result only indexes existing vertices and shares the full mesh's vertex buffer.
+//Corners left without a vertex at the new position take the one there whose normal and texture coordinates are
+//closest. Open borders are locked and collapses that would flip a triangle are skipped.
+//Writes at most targetIndexCount indices to result if the mesh can get that far, otherwise as few as it managed
+void simplifyMesh(const std::vector<PackedVertex>& vertices, const unsigned int * pIndices, unsigned int numberOfIndices, unsigned int targetIndexCount, std::vector<unsigned int>& result);
+
+//Builds LODs 1 to MAX_MESH_LODS - 1 from data.indices, each simplified from the one before and optimised for
+//the vertex cache, and appends them to data.indices with their sizes in data.lodIndexCounts
+void generateMeshLods(MeshData& data);
@@ -18,6 +18,8 @@ bool loadModelFromFile(const std::string& filename, GLuint VBO, GLuint EBO, unsi
 	for (int i = 0; i < scene->mNumMeshes; i++)
 	{
 		aiMesh *currentMesh=scene->mMeshes[i];
+		vertices.reserve(vertices.size() + currentMesh->mNumVertices);
+		indices.reserve(indices.size() + currentMesh->mNumFaces * 3);
 
 		for (int v = 0; v < currentMesh->mNumVertices; v++)
 		{
@@ -56,11 +58,10 @@ bool loadModelFromFile(const std::string& filename, GLuint VBO, GLuint EBO, unsi
 	return true;
 }
 
-bool loadMeshFromFile(const std::string & filename, std::vector<Mesh*>& meshes)
+//Runs the Assimp import and copies each aiMesh into a GPU ready vertex and index array
+bool importMeshData(const std::string & filename, std::vector<MeshData>& meshData)
 {
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
-
+	//aiProcess_ImproveCacheLocality is left off, optimizeMeshData does a better job and can report what it gained
 	Assimp::Importer importer;
 
 	const aiScene* scene = importer.ReadFile(filename, aiProcess_JoinIdenticalVertices | aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_GenUVCoords | aiProcess_CalcTangentSpace);
@@ -71,11 +72,21 @@ bool loadMeshFromFile(const std::string & filename, std::vector<Mesh*>& meshes)
 		return false;
 	}
 
+	//Full float vertices are built here then packed down into the mesh's vertex format
+	std::vector<Vertex> vertices;
+
+	meshData.resize(scene->mNumMeshes);
 	for (int i = 0; i < scene->mNumMeshes; i++)
 	{
 		aiMesh *currentMesh = scene->mMeshes[i];
-		Mesh *pMesh = new Mesh();
-		pMesh->init();
+		std::vector<unsigned int>& indices = meshData[i].indices;
+
+		//Only meshes that actually carry vertex colours get a colour stream
+		bool hasColours = currentMesh->HasVertexColors(0);
+		VertexFormat format(hasColours ? VERTEX_FORMAT_COLOUR : 0);
+
+		vertices.resize(currentMesh->mNumVertices);
+		indices.reserve(currentMesh->mNumFaces * 3);
 
 		for (int v = 0; v < currentMesh->mNumVertices; v++)
 		{
@@ -83,14 +94,13 @@ bool loadMeshFromFile(const std::string & filename, std::vector<Mesh*>& meshes)
 
 			aiVector3D currentTextureCoordinates = currentMesh->mTextureCoords[0][v];
 			aiVector3D currentNormals = currentMesh->mNormals[v];
+			aiColor4D currentColour = hasColours ? currentMesh->mColors[0][v] : aiColor4D(1.0f, 1.0f, 1.0f, 1.0f);
 
-			Vertex currentVertex = { currentModelVertex.x,currentModelVertex.y,currentModelVertex.z,
-				1.0f,1.0f,1.0f,1.0f,
+			vertices[v] = { currentModelVertex.x,currentModelVertex.y,currentModelVertex.z,
+				currentColour.r,currentColour.g,currentColour.b,currentColour.a,
 				currentTextureCoordinates.x,currentTextureCoordinates.y,
 				currentNormals.x,currentNormals.y,currentNormals.z
 			};
-
-			vertices.push_back(currentVertex);
 		}
 
 		for (int f = 0; f < currentMesh->mNumFaces; f++)
@@ -101,12 +111,54 @@ bool loadMeshFromFile(const std::string & filename, std::vector<Mesh*>& meshes)
 			indices.push_back(currentModelFace.mIndices[2]);
 		}
 
-		pMesh->copyBufferData(vertices.data(), vertices.size(), indices.data(), indices.size());
+		meshData[i].vertexFormatFlags = format.getFlags();
+		packVertices(vertices.data(), vertices.size(), format, meshData[i].vertices, meshData[i].colours);
+
+		//Reorder triangles for the post transform cache and vertices for fetch, bounds come after as unused vertices are dropped
+		MeshOptimizerStats stats = optimizeMeshData(meshData[i]);
+		printf("%s mesh %d: ACMR %.3f -> %.3f, %u -> %u vertices, %s indices\n", filename.c_str(), i, stats.acmrBefore, stats.acmrAfter,
+			stats.verticesBefore, stats.verticesAfter, stats.verticesAfter <= MAX_SHORT_INDEX_VERTICES ? "16 bit" : "32 bit");
+		computeBounds(meshData[i].vertices.data(), meshData[i].vertices.size(), meshData[i].boundingBox, meshData[i].boundingSphere);
+
+		//Simplified versions for drawing the mesh when it's small on screen, they index the vertices above so go last
+		generateMeshLods(meshData[i]);
+		printf("%s mesh %d: %u LODs,", filename.c_str(), i, (unsigned int)meshData[i].lodIndexCounts.size());
+		for (unsigned int lodIndexCount : meshData[i].lodIndexCounts)
+		{
+			printf(" %u", lodIndexCount / 3);
+		}
+		printf(" triangles\n");
+	}
+
+	return true;
+}
+
+bool loadMeshFromFile(const std::string & filename, std::vector<Mesh*>& meshes)
+{
+	//Use the cooked copy if it is at least as new as the source, it is mapped straight into the GPU buffers
+	std::string cookedFilename = getCookedMeshFilename(filename);
+	if (!isCookedFileStale(filename, cookedFilename) && loadCookedMeshFile(cookedFilename, meshes))
+	{
+		return true;
+	}
 
+	std::vector<MeshData> meshData;
+	if (!importMeshData(filename, meshData))
+	{
+		return false;
+	}
+
+	for (MeshData& data : meshData)
+	{
+		Mesh *pMesh = new Mesh();
+		pMesh->copyBufferData(VertexFormat(data.vertexFormatFlags), data.vertices.data(), data.colours.data(), data.vertices.size(), data.indices.data(), data.indices.size(),
+			data.lodIndexCounts.data(), data.lodIndexCounts.size());
+		pMesh->setBounds(data.boundingBox, data.boundingSphere);
 		meshes.push_back(pMesh);
-		vertices.clear();
-		indices.clear();
 	}
 
-	return true;;
+	//Save the processed data so the next launch can skip Assimp
+	writeCookedMeshFile(cookedFilename, meshData);
+
+	return true;
 }
@@ -12,7 +12,13 @@
 
 #include "vertex.h"
 #include "Mesh.h"
+#include "MeshCooker.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 
 bool loadModelFromFile(const std::string& filename, GLuint VBO, GLuint EBO, unsigned int& numVerts, unsigned int& numIndices);
 
-bool loadMeshFromFile(const std::string& filename, std::vector<Mesh*>& meshes);
\ No newline at end of file
+bool loadMeshFromFile(const std::string& filename, std::vector<Mesh*>& meshes);
+
+//Imports a model through Assimp without creating any GPU objects
+bool importMeshData(const std::string& filename, std::vector<MeshData>& meshData);
\ No newline at end of file
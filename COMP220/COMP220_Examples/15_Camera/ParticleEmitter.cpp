@@ -0,0 +1,308 @@
+#include "ParticleEmitter.h"
+#include "ShaderLibrary.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define PARTICLE_EMITTER_SSE
+#endif
+
+//Particles each instance data job writes
+#define PARTICLE_INSTANCE_JOB_GRAIN 8192
+
+ParticleEmitter::ParticleEmitter()
+{
+	m_Settings = {};
+	m_Position = glm::vec3(0.0f);
+	m_ParticleCount = 0;
+	m_EmissionRemainder = 0.0f;
+	m_Emitting = true;
+	m_RandomState = 2463534242u;
+	m_VAO = 0;
+	m_InstanceBuffer = 0;
+	m_InstanceBufferSize = 0;
+	m_pProgram = nullptr;
+}
+
+ParticleEmitter::~ParticleEmitter()
+{
+	destroy();
+}
+
+void ParticleEmitter::init(const ParticleSettings & settings)
+{
+	m_Settings = settings;
+	m_ParticleCount = 0;
+	m_EmissionRemainder = 0.0f;
+
+	//Padding to a multiple of four lets the kernels always load whole groups
+	unsigned int capacity = (settings.maxParticles + 3) & ~3u;
+	m_PositionX.assign(capacity, 0.0f);
+	m_PositionY.assign(capacity, 0.0f);
+	m_PositionZ.assign(capacity, 0.0f);
+	m_VelocityX.assign(capacity, 0.0f);
+	m_VelocityY.assign(capacity, 0.0f);
+	m_VelocityZ.assign(capacity, 0.0f);
+	m_Age.assign(capacity, 0.0f);
+	m_Lifetime.assign(capacity, 0.0f);
+	m_ChunkSurvivors.resize((capacity + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE);
+	m_InstanceStaging.resize(capacity);
+}
+
+void ParticleEmitter::destroy()
+{
+	if (m_InstanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_InstanceBuffer);
+		m_InstanceBuffer = 0;
+		m_InstanceBufferSize = 0;
+	}
+	if (m_VAO != 0)
+	{
+		glDeleteVertexArrays(1, &m_VAO);
+		m_VAO = 0;
+	}
+	if (m_pProgram != nullptr)
+	{
+		ShaderLibrary::get().release(m_pProgram);
+		m_pProgram = nullptr;
+	}
+}
+
+void ParticleEmitter::burst(unsigned int count)
+{
+	spawn(count);
+}
+
+void ParticleEmitter::update(float deltaTime)
+{
+	//Every chunk is independent, so each job kills and packs its own particles
+	unsigned int numberOfChunks = (m_ParticleCount + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE;
+	unsigned int particleCount = m_ParticleCount;
+	JobSystem::get().parallelFor(0, numberOfChunks, 1, [this, particleCount, deltaTime](unsigned int firstChunk, unsigned int lastChunk)
+	{
+		for (unsigned int chunk = firstChunk; chunk < lastChunk; chunk++)
+		{
+			unsigned int begin = chunk * PARTICLE_CHUNK_SIZE;
+			unsigned int end = std::min(begin + PARTICLE_CHUNK_SIZE, particleCount);
+			m_ChunkSurvivors[chunk] = updateChunk(begin, end, deltaTime);
+		}
+	});
+
+	//Slide each chunk's survivors down against the previous chunk's, always towards the front so nothing is overwritten early
+	unsigned int liveCount = numberOfChunks > 0 ? m_ChunkSurvivors[0] : 0;
+	for (unsigned int chunk = 1; chunk < numberOfChunks; chunk++)
+	{
+		unsigned int begin = chunk * PARTICLE_CHUNK_SIZE;
+		unsigned int survivors = m_ChunkSurvivors[chunk];
+		if (liveCount != begin)
+		{
+			std::copy(m_PositionX.begin() + begin, m_PositionX.begin() + begin + survivors, m_PositionX.begin() + liveCount);
+			std::copy(m_PositionY.begin() + begin, m_PositionY.begin() + begin + survivors, m_PositionY.begin() + liveCount);
+			std::copy(m_PositionZ.begin() + begin, m_PositionZ.begin() + begin + survivors, m_PositionZ.begin() + liveCount);
+			std::copy(m_VelocityX.begin() + begin, m_VelocityX.begin() + begin + survivors, m_VelocityX.begin() + liveCount);
+			std::copy(m_VelocityY.begin() + begin, m_VelocityY.begin() + begin + survivors, m_VelocityY.begin() + liveCount);
+			std::copy(m_VelocityZ.begin() + begin, m_VelocityZ.begin() + begin + survivors, m_VelocityZ.begin() + liveCount);
+			std::copy(m_Age.begin() + begin, m_Age.begin() + begin + survivors, m_Age.begin() + liveCount);
+			std::copy(m_Lifetime.begin() + begin, m_Lifetime.begin() + begin + survivors, m_Lifetime.begin() + liveCount);
+		}
+		liveCount += survivors;
+	}
+	m_ParticleCount = liveCount;
+
+	//New particles go on the end and are drawn where they were born this frame
+	if (m_Emitting)
+	{
+		m_EmissionRemainder += m_Settings.emissionRate * deltaTime;
+		unsigned int spawnCount = (unsigned int)m_EmissionRemainder;
+		m_EmissionRemainder -= spawnCount;
+		spawn(spawnCount);
+	}
+
+	JobSystem::get().parallelFor(0, m_ParticleCount, PARTICLE_INSTANCE_JOB_GRAIN, [this](unsigned int begin, unsigned int end)
+	{
+		writeInstances(begin, end);
+	});
+}
+
+void ParticleEmitter::render()
+{
+	if (m_ParticleCount == 0)
+	{
+		return;
+	}
+
+	if (m_VAO == 0)
+	{
+		//The quad's corners come from gl_VertexID, so the only attributes are the two per instance vec4s
+		glGenVertexArrays(1, &m_VAO);
+		glGenBuffers(1, &m_InstanceBuffer);
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, positionAndSize));
+		glVertexAttribDivisor(0, 1);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, colour));
+		glVertexAttribDivisor(1, 1);
+		glBindVertexArray(0);
+
+		m_pProgram = ShaderLibrary::get().acquire("particleVert.glsl", "particleFrag.glsl");
+	}
+
+	//The library has already reported why the program didn't build, draw nothing rather than with program 0
+	if (m_pProgram == nullptr)
+	{
+		return;
+	}
+
+	GLsizeiptr uploadSize = m_ParticleCount * sizeof(ParticleInstance);
+	glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+	if (uploadSize > m_InstanceBufferSize)
+	{
+		m_InstanceBufferSize = uploadSize;
+	}
+	//Orphan last frame's storage so the upload doesn't wait on the GPU
+	glBufferData(GL_ARRAY_BUFFER, m_InstanceBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, uploadSize, m_InstanceStaging.data());
+
+	//Additive particles don't need sorting, and leaving depth alone stops them hiding each other
+	m_pProgram->use();
+	glBindVertexArray(m_VAO);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDepthMask(GL_FALSE);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_ParticleCount);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glBindVertexArray(0);
+}
+
+float ParticleEmitter::randomFloat()
+{
+	//xorshift32, the top 24 bits fill a float's mantissa exactly
+	m_RandomState ^= m_RandomState << 13;
+	m_RandomState ^= m_RandomState >> 17;
+	m_RandomState ^= m_RandomState << 5;
+	return (m_RandomState >> 8) * (1.0f / 16777216.0f);
+}
+
+glm::vec3 ParticleEmitter::randomDirection()
+{
+	//Picking height and angle uniformly covers the sphere evenly, Archimedes' hat box theorem
+	float z = randomRange(-1.0f, 1.0f);
+	float angle = randomRange(0.0f, 6.2831853f);
+	float ringRadius = sqrtf(1.0f - z * z);
+	return glm::vec3(ringRadius * cosf(angle), ringRadius * sinf(angle), z);
+}
+
+void ParticleEmitter::spawn(unsigned int count)
+{
+	count = std::min(count, m_Settings.maxParticles - m_ParticleCount);
+	if (count == 0)
+	{
+		return;
+	}
+
+	unsigned int first = m_ParticleCount;
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		m_Age[i] = 0.0f;
+		m_Lifetime[i] = randomRange(m_Settings.minLifetime, m_Settings.maxLifetime);
+	}
+	emitParticles(first, count);
+	m_ParticleCount += count;
+}
+
+unsigned int ParticleEmitter::updateChunk(unsigned int begin, unsigned int end, float deltaTime)
+{
+	unsigned int survivors = begin;
+
+#ifdef PARTICLE_EMITTER_SSE
+	__m128 time = _mm_set1_ps(deltaTime);
+	__m128 accelerationX = _mm_set1_ps(m_Settings.acceleration.x * deltaTime);
+	__m128 accelerationY = _mm_set1_ps(m_Settings.acceleration.y * deltaTime);
+	__m128 accelerationZ = _mm_set1_ps(m_Settings.acceleration.z * deltaTime);
+
+	//The last group may run into the padding, those lanes are updated but never kept
+	for (unsigned int i = begin; i < end; i += 4)
+	{
+		__m128 velocityX = _mm_add_ps(_mm_loadu_ps(&m_VelocityX[i]), accelerationX);
+		__m128 velocityY = _mm_add_ps(_mm_loadu_ps(&m_VelocityY[i]), accelerationY);
+		__m128 velocityZ = _mm_add_ps(_mm_loadu_ps(&m_VelocityZ[i]), accelerationZ);
+		_mm_storeu_ps(&m_VelocityX[i], velocityX);
+		_mm_storeu_ps(&m_VelocityY[i], velocityY);
+		_mm_storeu_ps(&m_VelocityZ[i], velocityZ);
+		_mm_storeu_ps(&m_PositionX[i], _mm_add_ps(_mm_loadu_ps(&m_PositionX[i]), _mm_mul_ps(velocityX, time)));
+		_mm_storeu_ps(&m_PositionY[i], _mm_add_ps(_mm_loadu_ps(&m_PositionY[i]), _mm_mul_ps(velocityY, time)));
+		_mm_storeu_ps(&m_PositionZ[i], _mm_add_ps(_mm_loadu_ps(&m_PositionZ[i]), _mm_mul_ps(velocityZ, time)));
+
+		__m128 age = _mm_add_ps(_mm_loadu_ps(&m_Age[i]), time);
+		_mm_storeu_ps(&m_Age[i], age);
+		int aliveMask = _mm_movemask_ps(_mm_cmplt_ps(age, _mm_loadu_ps(&m_Lifetime[i])));
+
+		//Whole groups that survive where they already are need no copying, which is most of them
+		if (aliveMask == 15 && survivors == i && i + 4 <= end)
+		{
+			survivors += 4;
+			continue;
+		}
+
+		unsigned int groupEnd = std::min(i + 4, end);
+		for (unsigned int j = i; j < groupEnd; j++)
+		{
+			if (aliveMask & (1 << (j - i)))
+			{
+				moveParticle(j, survivors++);
+			}
+		}
+	}
+#else
+	for (unsigned int i = begin; i < end; i++)
+	{
+		m_VelocityX[i] += m_Settings.acceleration.x * deltaTime;
+		m_VelocityY[i] += m_Settings.acceleration.y * deltaTime;
+		m_VelocityZ[i] += m_Settings.acceleration.z * deltaTime;
+		m_PositionX[i] += m_VelocityX[i] * deltaTime;
+		m_PositionY[i] += m_VelocityY[i] * deltaTime;
+		m_PositionZ[i] += m_VelocityZ[i] * deltaTime;
+		m_Age[i] += deltaTime;
+
+		if (m_Age[i] < m_Lifetime[i])
+		{
+			moveParticle(i, survivors++);
+		}
+	}
+#endif
+
+	return survivors - begin;
+}
+
+void ParticleEmitter::moveParticle(unsigned int from, unsigned int to)
+{
+	if (from == to)
+	{
+		return;
+	}
+	m_PositionX[to] = m_PositionX[from];
+	m_PositionY[to] = m_PositionY[from];
+	m_PositionZ[to] = m_PositionZ[from];
+	m_VelocityX[to] = m_VelocityX[from];
+	m_VelocityY[to] = m_VelocityY[from];
+	m_VelocityZ[to] = m_VelocityZ[from];
+	m_Age[to] = m_Age[from];
+	m_Lifetime[to] = m_Lifetime[from];
+}
+
+void ParticleEmitter::writeInstances(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		float life = m_Age[i] / m_Lifetime[i];
+		ParticleInstance& instance = m_InstanceStaging[i];
+		instance.positionAndSize = glm::vec4(m_PositionX[i], m_PositionY[i], m_PositionZ[i], glm::mix(m_Settings.startSize, m_Settings.endSize, life));
+		instance.colour = glm::mix(m_Settings.startColour, m_Settings.endColour, life);
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <glm\glm.hpp>
+
+#include "ShaderProgram.h"
+
+//Particles are updated in chunks of this many, each chunk is one job and compacts its own survivors.
+//Must be a multiple of four so the SSE kernels never straddle two chunks
+#define PARTICLE_CHUNK_SIZE 4096
+
+//How an emitter's particles look and move, shared by every emission shape
+struct ParticleSettings
+{
+	unsigned int maxParticles;
+	//Particles spawned per second, carried over between frames so low rates still emit
+	float emissionRate;
+	float minLifetime;
+	float maxLifetime;
+	float minSpeed;
+	float maxSpeed;
+	//Added to every particle's velocity each second
+	glm::vec3 acceleration;
+	//Size and colour are blended from start to end over each particle's life
+	float startSize;
+	float endSize;
+	glm::vec4 startColour;
+	glm::vec4 endColour;
+};
+
+//Mirrors the per instance attributes of particleVert.glsl
+struct ParticleInstance
+{
+	glm::vec4 positionAndSize;
+	glm::vec4 colour;
+};
+
+//Owns a fixed pool of particles stored as separate arrays of x, y, z, velocity, age and lifetime, so the
+//update kernels load four particles at a time with SSE. Each frame the pool is split into chunks across the
+//JobSystem which integrate, age and kill their particles and pack the survivors to the front of the chunk, then
+//the chunks are slid down into one run. Every live particle is drawn with a single instanced draw of a camera
+//facing quad. Subclasses only decide where new particles start and which way they head
+class ParticleEmitter
+{
+public:
+	ParticleEmitter();
+	virtual ~ParticleEmitter();
+
+	//Only sets up the particle arrays, the GL objects are made on the first render so emitters can be benchmarked without a context
+	void init(const ParticleSettings& settings);
+	void destroy();
+
+	void setPosition(const glm::vec3& position)
+	{
+		m_Position = position;
+	};
+
+	const glm::vec3& getPosition()
+	{
+		return m_Position;
+	};
+
+	void setEmitting(bool emitting)
+	{
+		m_Emitting = emitting;
+	};
+
+	//Spawns up to count particles straight away, on top of the emission rate
+	void burst(unsigned int count);
+
+	//Runs the update kernels, spawns this frame's particles and fills the instance data for render
+	void update(float deltaTime);
+	//Draws with the PerFrame block already uploaded, blended additively over the scene without writing depth
+	void render();
+
+	unsigned int getParticleCount()
+	{
+		return m_ParticleCount;
+	};
+
+protected:
+	//Writes the start position and velocity of particles [first, first + count)
+	virtual void emitParticles(unsigned int first, unsigned int count) = 0;
+
+	//Uniform random numbers from this emitter's own generator, so emitters never share state
+	float randomFloat();
+	float randomRange(float minimum, float maximum)
+	{
+		return minimum + (maximum - minimum) * randomFloat();
+	};
+	//Random direction spread evenly over the unit sphere
+	glm::vec3 randomDirection();
+
+	void setParticle(unsigned int index, const glm::vec3& position, const glm::vec3& velocity)
+	{
+		m_PositionX[index] = position.x;
+		m_PositionY[index] = position.y;
+		m_PositionZ[index] = position.z;
+		m_VelocityX[index] = velocity.x;
+		m_VelocityY[index] = velocity.y;
+		m_VelocityZ[index] = velocity.z;
+	};
+
+	ParticleSettings m_Settings;
+	glm::vec3 m_Position;
+
+private:
+	void spawn(unsigned int count);
+	//Integrates, ages and kills the particles in [begin, end), packing the survivors from begin. Returns how many survived
+	unsigned int updateChunk(unsigned int begin, unsigned int end, float deltaTime);
+	void moveParticle(unsigned int from, unsigned int to);
+	void writeInstances(unsigned int begin, unsigned int end);
+
+	//Capacity is rounded up to a multiple of four, slots past m_ParticleCount are dead
+	std::vector<float> m_PositionX;
+	std::vector<float> m_PositionY;
+	std::vector<float> m_PositionZ;
+	std::vector<float> m_VelocityX;
+	std::vector<float> m_VelocityY;
+	std::vector<float> m_VelocityZ;
+	std::vector<float> m_Age;
+	std::vector<float> m_Lifetime;
+	unsigned int m_ParticleCount;
+
+	//Survivors in each chunk after the kernels have run
+	std::vector<unsigned int> m_ChunkSurvivors;
+
+	float m_EmissionRemainder;
+	bool m_Emitting;
+	uint32_t m_RandomState;
+
+	std::vector<ParticleInstance> m_InstanceStaging;
+	GLuint m_VAO;
+	GLuint m_InstanceBuffer;
+	GLsizeiptr m_InstanceBufferSize;
+	ShaderProgram * m_pProgram;
+};
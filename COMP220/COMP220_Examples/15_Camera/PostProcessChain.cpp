@@ -0,0 +1,258 @@
+#include "PostProcessChain.h"
+#include "Texture.h"
+
+#include <cstdio>
+#include <algorithm>
+
+PostProcessChain::PostProcessChain()
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_SceneFrameBufferID = 0;
+	m_SceneColourTextureID = 0;
+	m_SceneDepthBufferID = 0;
+	m_OutputFrameBufferID = 0;
+	m_ScreenQuadVBOID = 0;
+	m_ScreenVAO = 0;
+	m_pCopyProgram = nullptr;
+}
+
+PostProcessChain::~PostProcessChain()
+{
+}
+
+bool PostProcessChain::init(int width, int height)
+{
+	m_Width = width;
+	m_Height = height;
+
+	m_SceneColourTextureID = createTexture(width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenRenderbuffers(1, &m_SceneDepthBufferID);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_SceneDepthBufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glGenFramebuffers(1, &m_SceneFrameBufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_SceneFrameBufferID);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_SceneDepthBufferID);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_SceneColourTextureID, 0);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (!complete)
+	{
+		printf("Unable to create frame buffer for post processing\n");
+		return false;
+	}
+
+	GLfloat screenVerts[] =
+	{
+		-1, -1,
+		1, -1,
+		-1, 1,
+		1, 1
+	};
+
+	glGenBuffers(1, &m_ScreenQuadVBOID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_ScreenQuadVBOID);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(screenVerts), screenVerts, GL_STATIC_DRAW);
+
+	glGenVertexArrays(1, &m_ScreenVAO);
+	glBindVertexArray(m_ScreenVAO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+	glBindVertexArray(0);
+
+	m_pCopyProgram = ShaderLibrary::get().acquire("passThroughVert.glsl", "postTextureFrag.glsl");
+	return m_pCopyProgram != nullptr;
+}
+
+void PostProcessChain::destroy()
+{
+	for (PostProcessPass& pass : m_Passes)
+	{
+		ShaderLibrary::get().release(pass.program);
+	}
+	m_Passes.clear();
+
+	if (m_pCopyProgram != nullptr)
+	{
+		ShaderLibrary::get().release(m_pCopyProgram);
+		m_pCopyProgram = nullptr;
+	}
+
+	m_RenderTargets.destroy();
+
+	glDeleteVertexArrays(1, &m_ScreenVAO);
+	glDeleteBuffers(1, &m_ScreenQuadVBOID);
+	glDeleteFramebuffers(1, &m_SceneFrameBufferID);
+	glDeleteRenderbuffers(1, &m_SceneDepthBufferID);
+	glDeleteTextures(1, &m_SceneColourTextureID);
+	m_ScreenVAO = 0;
+	m_ScreenQuadVBOID = 0;
+	m_SceneFrameBufferID = 0;
+	m_SceneDepthBufferID = 0;
+	m_SceneColourTextureID = 0;
+}
+
+int PostProcessChain::addPass(const std::string & name, const std::string & vertexShaderFilename, const std::string & fragmentShaderFilename,
+	int resolutionDivisor, bool sampleScene, const std::string & defines)
+{
+	ShaderProgram * pProgram = ShaderLibrary::get().acquire(vertexShaderFilename, fragmentShaderFilename, defines);
+	if (pProgram == nullptr)
+	{
+		return -1;
+	}
+
+	PostProcessPass pass;
+	pass.name = name;
+	pass.profileName = Profiler::get().internName(name);
+	pass.program = pProgram;
+	pass.resolutionDivisor = resolutionDivisor < 1 ? 1 : resolutionDivisor;
+	pass.sampleScene = sampleScene;
+	pass.enabled = true;
+	m_Passes.push_back(pass);
+	return (int)m_Passes.size() - 1;
+}
+
+void PostProcessChain::setPassEnabled(const std::string & name, bool enabled)
+{
+	PostProcessPass * pPass = findPass(name);
+	if (pPass != nullptr)
+	{
+		pPass->enabled = enabled;
+	}
+}
+
+bool PostProcessChain::isPassEnabled(const std::string & name)
+{
+	PostProcessPass * pPass = findPass(name);
+	return pPass != nullptr && pPass->enabled;
+}
+
+void PostProcessChain::beginScene()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_SceneFrameBufferID);
+	glViewport(0, 0, m_Width, m_Height);
+}
+
+void PostProcessChain::render()
+{
+	PROFILE_SCOPE("Post process");
+
+	int lastEnabledPass = -1;
+	for (int i = 0; i < (int)m_Passes.size(); i++)
+	{
+		if (m_Passes[i].enabled)
+		{
+			lastEnabledPass = i;
+		}
+	}
+
+	//Nothing to do, copy the scene across without a draw
+	if (lastEnabledPass == -1)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_SceneFrameBufferID);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_OutputFrameBufferID);
+		glBlitFramebuffer(0, 0, m_Width, m_Height, 0, 0, m_Width, m_Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_OutputFrameBufferID);
+		return;
+	}
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glBindVertexArray(m_ScreenVAO);
+
+	GLuint inputTextureID = m_SceneColourTextureID;
+	int inputWidth = m_Width;
+	int inputHeight = m_Height;
+	RenderTarget * pInputTarget = nullptr;
+
+	for (int i = 0; i <= lastEnabledPass; i++)
+	{
+		const PostProcessPass& pass = m_Passes[i];
+		if (!pass.enabled)
+		{
+			continue;
+		}
+
+		//The last pass goes straight to the output unless it has to be stretched up afterwards
+		RenderTarget * pOutputTarget = nullptr;
+		if (i == lastEnabledPass && pass.resolutionDivisor == 1)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, m_OutputFrameBufferID);
+			glViewport(0, 0, m_Width, m_Height);
+		}
+		else
+		{
+			pOutputTarget = m_RenderTargets.acquire(std::max(m_Width / pass.resolutionDivisor, 1), std::max(m_Height / pass.resolutionDivisor, 1));
+			glBindFramebuffer(GL_FRAMEBUFFER, pOutputTarget->frameBufferID);
+			glViewport(0, 0, pOutputTarget->width, pOutputTarget->height);
+		}
+
+		{
+			PROFILE_GPU_SCOPE(pass.profileName);
+			drawPass(pass.program, inputTextureID, inputWidth, inputHeight, pass.sampleScene);
+		}
+
+		//The input has been read so the next pass can write into it
+		m_RenderTargets.release(pInputTarget);
+		pInputTarget = pOutputTarget;
+		if (pOutputTarget != nullptr)
+		{
+			inputTextureID = pOutputTarget->textureID;
+			inputWidth = pOutputTarget->width;
+			inputHeight = pOutputTarget->height;
+		}
+	}
+
+	if (pInputTarget != nullptr)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_OutputFrameBufferID);
+		glViewport(0, 0, m_Width, m_Height);
+		drawPass(m_pCopyProgram, inputTextureID, inputWidth, inputHeight, false);
+		m_RenderTargets.release(pInputTarget);
+	}
+
+	//Leave no post target bound, the scene pass next frame would otherwise be able to sample what it's drawing into
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+PostProcessPass * PostProcessChain::findPass(const std::string & name)
+{
+	for (PostProcessPass& pass : m_Passes)
+	{
+		if (pass.name == name)
+		{
+			return &pass;
+		}
+	}
+	return nullptr;
+}
+
+void PostProcessChain::drawPass(ShaderProgram * pProgram, GLuint inputTextureID, int inputWidth, int inputHeight, bool sampleScene)
+{
+	pProgram->use();
+
+	//Looked up every time rather than cached, a hot reload can move them
+	glUniform1i(pProgram->getUniformLocation("texture0"), 0);
+	glUniform1i(pProgram->getUniformLocation("texture1"), 1);
+	glUniform2f(pProgram->getUniformLocation("texelSize"), 1.0f / inputWidth, 1.0f / inputHeight);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, inputTextureID);
+	if (sampleScene)
+	{
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, m_SceneColourTextureID);
+	}
+
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
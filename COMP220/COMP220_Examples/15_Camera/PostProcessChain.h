@@ -0,0 +1,84 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <string>
+#include <vector>
+
+#include "ShaderLibrary.h"
+#include "RenderTargetPool.h"
+#include "Profiler.h"
+
+//One full screen pass. It reads the previous pass's output as texture0, and the untouched scene as texture1 if
+//sampleScene is set. texelSize is set to one texel of texture0 for programs that declare it
+struct PostProcessPass
+{
+	std::string name;
+	//Copy of name that stays put, for the pass's GPU profile zone
+	const char * profileName;
+	ShaderProgram * program;
+	//1 renders at full resolution, 2 at half, 4 at quarter
+	int resolutionDivisor;
+	bool sampleScene;
+	bool enabled;
+};
+
+//Draws the scene into an offscreen target and runs it through a list of passes on the way to the back buffer.
+//Intermediate targets come from a pool and go back as soon as the next pass has read them, so passes ping-pong
+//between a few shared targets, and disabled passes are skipped without costing a target or a draw
+class PostProcessChain
+{
+public:
+	PostProcessChain();
+	~PostProcessChain();
+
+	bool init(int width, int height);
+	void destroy();
+
+	//Returns the index of the pass, or -1 if its program didn't build. defines are passed on to the ShaderLibrary,
+	//so one shader can serve several passes
+	int addPass(const std::string& name, const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename,
+		int resolutionDivisor = 1, bool sampleScene = false, const std::string& defines = "");
+
+	void setPassEnabled(const std::string& name, bool enabled);
+	bool isPassEnabled(const std::string& name);
+
+	//Where the last pass draws, the back buffer unless rendering headless
+	void setOutputFrameBuffer(GLuint frameBufferID)
+	{
+		m_OutputFrameBufferID = frameBufferID;
+	};
+
+	//Binds the scene target, everything drawn until render() goes through the chain
+	void beginScene();
+	//Runs every enabled pass, the last one draws straight into the output frame buffer
+	void render();
+
+	unsigned int getRenderTargetCount()
+	{
+		return m_RenderTargets.getTargetCount();
+	};
+
+private:
+	PostProcessPass * findPass(const std::string& name);
+	void drawPass(ShaderProgram * pProgram, GLuint inputTextureID, int inputWidth, int inputHeight, bool sampleScene);
+
+	int m_Width;
+	int m_Height;
+
+	//The scene keeps its own target because it has a depth buffer and may be read by any pass
+	GLuint m_SceneFrameBufferID;
+	GLuint m_SceneColourTextureID;
+	GLuint m_SceneDepthBufferID;
+
+	GLuint m_OutputFrameBufferID;
+
+	GLuint m_ScreenQuadVBOID;
+	GLuint m_ScreenVAO;
+	//Stretches the last target onto the back buffer when the final enabled pass ran below full resolution
+	ShaderProgram * m_pCopyProgram;
+
+	std::vector<PostProcessPass> m_Passes;
+	RenderTargetPool m_RenderTargets;
+};
@@ -0,0 +1,343 @@
+#include "Profiler.h"
+
+#include <cstdio>
+#include <glm\glm.hpp>
+#include <LinearMath\btQuickprof.h>
+
+static thread_local void * t_pThreadBuffer = nullptr;
+
+//Bullet's previous hooks, put back by destroy
+static btEnterProfileZoneFunc * s_pPreviousEnterZone = nullptr;
+static btLeaveProfileZoneFunc * s_pPreviousLeaveZone = nullptr;
+
+//Whether each of Bullet's open zones on this thread actually began one, so profiling being switched on or off
+//in the middle of a step never ends a zone that belongs to someone else
+static thread_local std::vector<bool> t_BulletZonesStarted;
+
+static void enterBulletZone(const char * name)
+{
+	t_BulletZonesStarted.push_back(Profiler::get().beginZone(name));
+}
+
+static void leaveBulletZone()
+{
+	if (t_BulletZonesStarted.empty())
+	{
+		return;
+	}
+
+	bool started = t_BulletZonesStarted.back();
+	t_BulletZonesStarted.pop_back();
+	if (started)
+	{
+		Profiler::get().endZone();
+	}
+}
+
+//Zone and thread names are plain identifiers in practice, but anything else mustn't break the JSON
+static void writeJSONString(FILE * pFile, const char * text)
+{
+	fputc('"', pFile);
+	for (const char * c = text; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			fputc('\\', pFile);
+		}
+		if ((unsigned char)*c >= 0x20)
+		{
+			fputc(*c, pFile);
+		}
+	}
+	fputc('"', pFile);
+}
+
+Profiler & Profiler::get()
+{
+	static Profiler instance;
+	return instance;
+}
+
+Profiler::Profiler()
+{
+	m_Enabled = true;
+	m_Initialised = false;
+	m_StartCounter = SDL_GetPerformanceCounter();
+	m_FrameStart = m_StartCounter;
+	m_FrameIndex = 0;
+	m_GpuZoneOpen = false;
+	m_History.resize(PROFILER_HISTORY_FRAMES);
+}
+
+Profiler::~Profiler()
+{
+	for (ThreadBuffer * pBuffer : m_ThreadBuffers)
+	{
+		delete pBuffer;
+	}
+}
+
+void Profiler::init()
+{
+	s_pPreviousEnterZone = btGetCurrentEnterProfileZoneFunc();
+	s_pPreviousLeaveZone = btGetCurrentLeaveProfileZoneFunc();
+	btSetCustomEnterProfileZoneFunc(enterBulletZone);
+	btSetCustomLeaveProfileZoneFunc(leaveBulletZone);
+
+	m_StartCounter = SDL_GetPerformanceCounter();
+	m_FrameStart = m_StartCounter;
+	m_Initialised = true;
+}
+
+void Profiler::destroy()
+{
+	if (!m_Initialised)
+	{
+		return;
+	}
+
+	btSetCustomEnterProfileZoneFunc(s_pPreviousEnterZone);
+	btSetCustomLeaveProfileZoneFunc(s_pPreviousLeaveZone);
+
+	for (PendingGpuZone& pending : m_PendingGpuZones)
+	{
+		glDeleteQueries(1, &pending.query);
+	}
+	m_PendingGpuZones.clear();
+	if (!m_FreeQueries.empty())
+	{
+		glDeleteQueries((GLsizei)m_FreeQueries.size(), m_FreeQueries.data());
+		m_FreeQueries.clear();
+	}
+	m_Initialised = false;
+}
+
+void Profiler::beginFrame()
+{
+	m_FrameStart = SDL_GetPerformanceCounter();
+}
+
+void Profiler::endFrame()
+{
+	ProfileFrame& frame = m_History[m_FrameIndex % PROFILER_HISTORY_FRAMES];
+	frame.index = m_FrameIndex;
+	frame.start = m_FrameStart;
+	frame.end = SDL_GetPerformanceCounter();
+	frame.cpuZones.clear();
+	frame.gpuZones.clear();
+
+	//Zones finished on worker threads during the frame are counted in it, whenever they started
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (ThreadBuffer * pBuffer : m_ThreadBuffers)
+		{
+			std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+			frame.cpuZones.insert(frame.cpuZones.end(), pBuffer->completedZones.begin(), pBuffer->completedZones.end());
+			pBuffer->completedZones.clear();
+		}
+	}
+
+	if (m_Initialised)
+	{
+		resolveGpuZones();
+	}
+	m_FrameIndex++;
+}
+
+bool Profiler::beginZone(const char * name)
+{
+	if (!m_Enabled)
+	{
+		return false;
+	}
+
+	ThreadBuffer * pBuffer = getThreadBuffer();
+	ProfileZone zone;
+	zone.name = name;
+	zone.start = SDL_GetPerformanceCounter();
+	zone.end = 0;
+	zone.threadIndex = pBuffer->threadIndex;
+	zone.depth = (unsigned int)pBuffer->openZones.size();
+	pBuffer->openZones.push_back(zone);
+	return true;
+}
+
+void Profiler::endZone()
+{
+	ThreadBuffer * pBuffer = getThreadBuffer();
+	if (pBuffer->openZones.empty())
+	{
+		return;
+	}
+
+	ProfileZone zone = pBuffer->openZones.back();
+	pBuffer->openZones.pop_back();
+	zone.end = SDL_GetPerformanceCounter();
+
+	std::lock_guard<std::mutex> lock(pBuffer->mutex);
+	pBuffer->completedZones.push_back(zone);
+}
+
+bool Profiler::beginGpuZone(const char * name)
+{
+	if (!m_Enabled || !m_Initialised || m_GpuZoneOpen)
+	{
+		return false;
+	}
+
+	GLuint query;
+	if (m_FreeQueries.empty())
+	{
+		glGenQueries(1, &query);
+	}
+	else
+	{
+		query = m_FreeQueries.back();
+		m_FreeQueries.pop_back();
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	m_PendingGpuZones.push_back({ name, query, m_FrameIndex, SDL_GetPerformanceCounter() });
+	m_GpuZoneOpen = true;
+	return true;
+}
+
+void Profiler::endGpuZone()
+{
+	if (m_GpuZoneOpen)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_GpuZoneOpen = false;
+	}
+}
+
+void Profiler::setThreadName(const std::string & name)
+{
+	ThreadBuffer * pBuffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	pBuffer->name = name;
+}
+
+const char * Profiler::internName(const std::string & name)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_InternedNames.insert(name).first->c_str();
+}
+
+bool Profiler::exportChromeTrace(const std::string & filename)
+{
+	FILE * pFile = fopen(filename.c_str(), "w");
+	if (pFile == nullptr)
+	{
+		printf("Unable to write trace %s\n", filename.c_str());
+		return false;
+	}
+
+	fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(pFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", PROFILER_GPU_TRACK);
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (ThreadBuffer * pBuffer : m_ThreadBuffers)
+		{
+			fprintf(pFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", pBuffer->threadIndex);
+			writeJSONString(pFile, pBuffer->name.empty() ? "Thread" : pBuffer->name.c_str());
+			fprintf(pFile, "}}");
+		}
+	}
+
+	unsigned int numberOfFrames = m_FrameIndex < PROFILER_HISTORY_FRAMES ? m_FrameIndex : PROFILER_HISTORY_FRAMES;
+	for (unsigned int i = m_FrameIndex - numberOfFrames; i < m_FrameIndex; i++)
+	{
+		const ProfileFrame& frame = m_History[i % PROFILER_HISTORY_FRAMES];
+		double frameStart = toMicroseconds(frame.start);
+		fprintf(pFile, ",\n{\"name\":\"Frame %u\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}", frame.index, frameStart, toMicroseconds(frame.end) - frameStart);
+
+		for (const ProfileZone& zone : frame.cpuZones)
+		{
+			double zoneStart = toMicroseconds(zone.start);
+			fprintf(pFile, ",\n{\"name\":");
+			writeJSONString(pFile, zone.name);
+			fprintf(pFile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", zone.threadIndex, zoneStart, toMicroseconds(zone.end) - zoneStart);
+		}
+
+		//Passes run back to back on the GPU, so they're laid end to end from when the first was submitted
+		double gpuTime = frame.gpuZones.empty() ? 0.0 : toMicroseconds(frame.gpuZones[0].submitted);
+		for (const GpuProfileZone& zone : frame.gpuZones)
+		{
+			gpuTime = glm::max(gpuTime, toMicroseconds(zone.submitted));
+			fprintf(pFile, ",\n{\"name\":");
+			writeJSONString(pFile, zone.name);
+			fprintf(pFile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", PROFILER_GPU_TRACK, gpuTime, zone.milliseconds * 1000.0);
+			gpuTime += zone.milliseconds * 1000.0;
+		}
+	}
+
+	fprintf(pFile, "\n]}\n");
+	fclose(pFile);
+	printf("Wrote %u frames of profile to %s\n", numberOfFrames, filename.c_str());
+	return true;
+}
+
+double Profiler::getWorstFrameMilliseconds()
+{
+	unsigned int numberOfFrames = m_FrameIndex < PROFILER_HISTORY_FRAMES ? m_FrameIndex : PROFILER_HISTORY_FRAMES;
+	double worst = 0.0;
+	for (unsigned int i = m_FrameIndex - numberOfFrames; i < m_FrameIndex; i++)
+	{
+		const ProfileFrame& frame = m_History[i % PROFILER_HISTORY_FRAMES];
+		worst = glm::max(worst, (toMicroseconds(frame.end) - toMicroseconds(frame.start)) / 1000.0);
+	}
+	return worst;
+}
+
+Profiler::ThreadBuffer * Profiler::getThreadBuffer()
+{
+	if (t_pThreadBuffer == nullptr)
+	{
+		ThreadBuffer * pBuffer = new ThreadBuffer();
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		//Track 0 holds the frame markers
+		pBuffer->threadIndex = (unsigned int)m_ThreadBuffers.size() + 1;
+		m_ThreadBuffers.push_back(pBuffer);
+		t_pThreadBuffer = pBuffer;
+	}
+	return (ThreadBuffer*)t_pThreadBuffer;
+}
+
+//Reads back every query whose result has arrived, without ever waiting for one
+void Profiler::resolveGpuZones()
+{
+	size_t resolved = 0;
+	for (; resolved < m_PendingGpuZones.size(); resolved++)
+	{
+		PendingGpuZone& pending = m_PendingGpuZones[resolved];
+		if (pending.frameIndex == m_FrameIndex)
+		{
+			break;
+		}
+
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != GL_TRUE)
+		{
+			break;
+		}
+
+		GLuint64 elapsedNanoseconds = 0;
+		glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsedNanoseconds);
+		m_FreeQueries.push_back(pending.query);
+
+		//The frame may have dropped out of the history already if results are very late
+		ProfileFrame& frame = m_History[pending.frameIndex % PROFILER_HISTORY_FRAMES];
+		if (frame.index == pending.frameIndex)
+		{
+			frame.gpuZones.push_back({ pending.name, pending.submitted, (double)elapsedNanoseconds / 1000000.0 });
+		}
+	}
+	m_PendingGpuZones.erase(m_PendingGpuZones.begin(), m_PendingGpuZones.begin() + resolved);
+}
+
+double Profiler::toMicroseconds(Uint64 counter)
+{
+	return (double)(counter - m_StartCounter) * 1000000.0 / (double)SDL_GetPerformanceFrequency();
+}
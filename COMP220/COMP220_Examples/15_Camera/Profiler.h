@@ -0,0 +1,182 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+#include <SDL.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+//Frames of zones kept for export, about five seconds at 60Hz
+#define PROFILER_HISTORY_FRAMES 300
+//Track id used for GPU zones in the exported trace, well clear of the thread indices
+#define PROFILER_GPU_TRACK 1000
+
+//Zone names are kept as pointers, so they have to be string literals or come from Profiler::internName
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+struct ProfileZone
+{
+	const char * name;
+	Uint64 start;
+	Uint64 end;
+	unsigned int threadIndex;
+	unsigned int depth;
+};
+
+//GPU durations come from GL_TIME_ELAPSED queries read back a few frames later. Queries only say how long a
+//pass took, not when it ran, so submitted is the CPU time the pass was started and is used to lay them out
+struct GpuProfileZone
+{
+	const char * name;
+	Uint64 submitted;
+	double milliseconds;
+};
+
+struct ProfileFrame
+{
+	unsigned int index;
+	Uint64 start;
+	Uint64 end;
+	std::vector<ProfileZone> cpuZones;
+	std::vector<GpuProfileZone> gpuZones;
+};
+
+//Records scoped CPU timings from any thread, including every BT_PROFILE zone inside Bullet, and GPU timings for
+//render passes. The last PROFILER_HISTORY_FRAMES frames are kept and can be written out as Chrome trace_event JSON,
+//which chrome://tracing or ui.perfetto.dev open, to see exactly where a slow frame's time went
+class Profiler
+{
+public:
+	static Profiler& get();
+
+	//Routes Bullet's profile zones here, GPU zones need a current GL context
+	void init();
+	void destroy();
+
+	void setEnabled(bool enabled)
+	{
+		m_Enabled = enabled;
+	};
+
+	bool isEnabled()
+	{
+		return m_Enabled;
+	};
+
+	//Called once a frame on the GL thread, endFrame collects every thread's zones and any GPU results that have arrived
+	void beginFrame();
+	void endFrame();
+
+	//Zones on one thread must nest, which the scope macros take care of. While the profiler is disabled nothing is
+	//opened and beginZone returns false, endZone must then not be called for it even if profiling was turned on since
+	bool beginZone(const char * name);
+	void endZone();
+
+	//GL thread only. GL_TIME_ELAPSED queries can't overlap so GPU zones can't nest, one inside another is
+	//ignored and returns false, and endGpuZone must then not be called for it
+	bool beginGpuZone(const char * name);
+	void endGpuZone();
+
+	//Names the calling thread in exported traces
+	void setThreadName(const std::string& name);
+	//Returns a copy of the name that lives as long as the profiler, for zone names that aren't literals
+	const char * internName(const std::string& name);
+
+	//Writes every frame in the history
+	bool exportChromeTrace(const std::string& filename);
+
+	//Longest frame in the history, so a spike can be spotted before exporting
+	double getWorstFrameMilliseconds();
+
+private:
+	Profiler();
+	~Profiler();
+
+	//Each thread collects its own zones so recording never waits on another thread
+	struct ThreadBuffer
+	{
+		unsigned int threadIndex;
+		std::string name;
+		std::vector<ProfileZone> openZones;
+		//Protected by mutex, moved into the frame by endFrame
+		std::mutex mutex;
+		std::vector<ProfileZone> completedZones;
+	};
+
+	struct PendingGpuZone
+	{
+		const char * name;
+		GLuint query;
+		unsigned int frameIndex;
+		Uint64 submitted;
+	};
+
+	ThreadBuffer * getThreadBuffer();
+	void resolveGpuZones();
+	double toMicroseconds(Uint64 counter);
+
+	std::atomic<bool> m_Enabled;
+	bool m_Initialised;
+	Uint64 m_StartCounter;
+	Uint64 m_FrameStart;
+	unsigned int m_FrameIndex;
+
+	std::mutex m_Mutex;
+	std::vector<ThreadBuffer*> m_ThreadBuffers;
+	std::set<std::string> m_InternedNames;
+
+	std::vector<ProfileFrame> m_History;
+
+	bool m_GpuZoneOpen;
+	std::vector<GLuint> m_FreeQueries;
+	//Oldest first, results arrive in the same order
+	std::vector<PendingGpuZone> m_PendingGpuZones;
+};
+
+class ProfileScope
+{
+public:
+	ProfileScope(const char * name)
+	{
+		m_Started = Profiler::get().beginZone(name);
+	};
+
+	~ProfileScope()
+	{
+		if (m_Started)
+		{
+			Profiler::get().endZone();
+		}
+	};
+
+private:
+	bool m_Started;
+};
+
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(const char * name)
+	{
+		m_Started = Profiler::get().beginGpuZone(name);
+	};
+
+	~GpuProfileScope()
+	{
+		if (m_Started)
+		{
+			Profiler::get().endGpuZone();
+		}
+	};
+
+private:
+	bool m_Started;
+};
@@ -0,0 +1,155 @@
+#include "RenderQueue.h"
+
+//Masks a value down to the given number of bits and moves it into place
+static uint64_t packKeyField(uint64_t value, int bits, int shift)
+{
+	return (value & ((1ull << bits) - 1)) << shift;
+}
+
+RenderQueue::RenderQueue()
+{
+	m_ViewMatrix = glm::mat4(1.0f);
+	m_ProjectionMatrix = glm::mat4(1.0f);
+	m_FarPlane = 100.0f;
+}
+
+void RenderQueue::begin(const glm::mat4 & viewMatrix, const glm::mat4 & projectionMatrix, float farPlane)
+{
+	m_Packets.clear();
+	m_SortedKeys.clear();
+	m_ViewMatrix = viewMatrix;
+	m_ProjectionMatrix = projectionMatrix;
+	m_FarPlane = farPlane;
+}
+
+void RenderQueue::submit(GameObject * pObject, RenderPass pass)
+{
+	InstanceData instance;
+	instance.modelMatrix = pObject->getModelMatrix();
+	instance.ambientMaterialColour = pObject->getAmbientMaterialColour();
+	instance.diffuseMaterialColour = pObject->getDiffuseMaterialColour();
+	instance.specularMaterialColour = pObject->getSpecularMaterialColour();
+	instance.specularPower = pObject->getSpecularPower();
+
+	//The object remembers its LOD so it only changes once the coverage is clearly past a threshold
+	unsigned int lod = selectLod(getScreenCoverage(pObject->getWorldBoundingSphere()), pObject->getLod(), MAX_MESH_LODS);
+	pObject->setLod(lod);
+
+	submit(pObject->getMeshes(), pObject->getShaderProgram(), pObject->getDiffuseMap(), instance, pass, lod);
+}
+
+void RenderQueue::submit(MeshGroup * pMeshes, ShaderProgram * pProgram, GLuint texture, const InstanceData & instance, RenderPass pass, unsigned int lod)
+{
+	if (pMeshes == nullptr || pProgram == nullptr)
+	{
+		return;
+	}
+
+	DrawPacket packet;
+	packet.texture = texture;
+	packet.instance = instance;
+
+	//View space depth of the object's origin, the camera looks down -z
+	float depth = -(m_ViewMatrix * packet.instance.modelMatrix[3]).z;
+
+	for (Mesh * pMesh : *pMeshes)
+	{
+		if (pMesh->getArena() == nullptr)
+		{
+			continue;
+		}
+
+		//Each mesh is drawn with the variant of the object's program that matches its vertex layout
+		packet.pProgram = pProgram->getVariant(pMesh->getVertexFormat());
+		packet.pMesh = pMesh;
+		packet.lod = lod < pMesh->getNumberOfLods() ? lod : pMesh->getNumberOfLods() - 1;
+
+		SortEntry entry;
+		entry.key = buildKey(pass, packet.pProgram, packet.texture, pMesh, packet.lod, depth);
+		entry.packetIndex = (uint32_t)m_Packets.size();
+
+		m_Packets.push_back(packet);
+		m_SortedKeys.push_back(entry);
+	}
+}
+
+uint64_t RenderQueue::buildKey(RenderPass pass, ShaderProgram * pProgram, GLuint texture, Mesh * pMesh, unsigned int lod, float depth)
+{
+	//Within a state group opaque geometry goes front to back to make the most of early depth rejection, blended geometry back to front
+	float normalisedDepth = glm::clamp(depth / m_FarPlane, 0.0f, 1.0f);
+	uint64_t quantisedDepth = (uint64_t)(normalisedDepth * ((1 << SORT_KEY_DEPTH_BITS) - 1));
+	if (pass == RENDER_PASS_TRANSPARENT)
+	{
+		quantisedDepth = ((1 << SORT_KEY_DEPTH_BITS) - 1) - quantisedDepth;
+	}
+
+	return packKeyField(pass, SORT_KEY_PASS_BITS, SORT_KEY_PASS_SHIFT) |
+		packKeyField(pProgram->getSortID(), SORT_KEY_PROGRAM_BITS, SORT_KEY_PROGRAM_SHIFT) |
+		packKeyField(texture, SORT_KEY_TEXTURE_BITS, SORT_KEY_TEXTURE_SHIFT) |
+		packKeyField(pMesh->getArena()->getVertexFormat().getFlags(), SORT_KEY_ARENA_BITS, SORT_KEY_ARENA_SHIFT) |
+		packKeyField(pMesh->getSortID(), SORT_KEY_MESH_BITS, SORT_KEY_MESH_SHIFT) |
+		packKeyField(lod, SORT_KEY_LOD_BITS, SORT_KEY_LOD_SHIFT) |
+		packKeyField(quantisedDepth, SORT_KEY_DEPTH_BITS, 0);
+}
+
+//Least significant digit radix sort, one byte per pass. Passes where every key has the same byte are skipped,
+//which is most of them when only a handful of programs and textures are in use
+void RenderQueue::append(const RenderQueue & other)
+{
+	uint32_t firstPacketIndex = (uint32_t)m_Packets.size();
+	m_Packets.insert(m_Packets.end(), other.m_Packets.begin(), other.m_Packets.end());
+	for (const SortEntry& entry : other.m_SortedKeys)
+	{
+		m_SortedKeys.push_back({ entry.key, entry.packetIndex + firstPacketIndex });
+	}
+}
+
+void RenderQueue::sort()
+{
+	size_t count = m_SortedKeys.size();
+	if (count < 2)
+	{
+		return;
+	}
+
+	m_SortScratch.resize(count);
+	SortEntry * pSource = m_SortedKeys.data();
+	SortEntry * pDestination = m_SortScratch.data();
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		unsigned int histogram[256] = { 0 };
+		for (size_t i = 0; i < count; i++)
+		{
+			histogram[(pSource[i].key >> shift) & 0xFF]++;
+		}
+
+		if (histogram[(pSource[0].key >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		unsigned int offset = 0;
+		for (int digit = 0; digit < 256; digit++)
+		{
+			unsigned int digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			pDestination[histogram[(pSource[i].key >> shift) & 0xFF]++] = pSource[i];
+		}
+
+		SortEntry * pSwap = pSource;
+		pSource = pDestination;
+		pDestination = pSwap;
+	}
+
+	//An odd number of passes leaves the result in the scratch buffer
+	if (pSource != m_SortedKeys.data())
+	{
+		m_SortedKeys.swap(m_SortScratch);
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm\glm.hpp>
+
+#include "GameObject.h"
+#include "InstanceData.h"
+
+//Passes are drawn in this order, they occupy the top bits of every sort key
+enum RenderPass
+{
+	RENDER_PASS_OPAQUE,
+	RENDER_PASS_TRANSPARENT,
+	RENDER_PASS_OVERLAY
+};
+
+//Sort key layout from the most significant bit down, so sorting the keys groups packets by pass, then GL state, then depth
+#define SORT_KEY_DEPTH_BITS 20
+#define SORT_KEY_LOD_BITS 2
+#define SORT_KEY_MESH_BITS 14
+#define SORT_KEY_ARENA_BITS 4
+#define SORT_KEY_TEXTURE_BITS 12
+#define SORT_KEY_PROGRAM_BITS 10
+#define SORT_KEY_PASS_BITS 2
+
+#define SORT_KEY_LOD_SHIFT (SORT_KEY_DEPTH_BITS)
+#define SORT_KEY_MESH_SHIFT (SORT_KEY_LOD_SHIFT + SORT_KEY_LOD_BITS)
+#define SORT_KEY_ARENA_SHIFT (SORT_KEY_MESH_SHIFT + SORT_KEY_MESH_BITS)
+#define SORT_KEY_TEXTURE_SHIFT (SORT_KEY_ARENA_SHIFT + SORT_KEY_ARENA_BITS)
+#define SORT_KEY_PROGRAM_SHIFT (SORT_KEY_TEXTURE_SHIFT + SORT_KEY_TEXTURE_BITS)
+#define SORT_KEY_PASS_SHIFT (SORT_KEY_PROGRAM_SHIFT + SORT_KEY_PROGRAM_BITS)
+
+//Everything needed to draw one mesh of one object
+struct DrawPacket
+{
+	ShaderProgram * pProgram;
+	GLuint texture;
+	Mesh * pMesh;
+	unsigned int lod;
+	InstanceData instance;
+};
+
+//Collects a frame's draw packets, gives each a 64 bit state key and radix sorts them
+//so the renderer only has to change GL state when a field of the key changes
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	//Clears last frame's packets, the view matrix and far plane are used to quantise depth and the projection to pick LODs
+	void begin(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, float farPlane);
+	//Picks the object's LOD from how much of the screen its bounding sphere covers
+	void submit(GameObject * pObject, RenderPass pass = RENDER_PASS_OPAQUE);
+	//Adds one packet per mesh in the group, for callers that don't keep their data in a GameObject.
+	//Meshes with fewer LODs than asked for use their coarsest one
+	void submit(MeshGroup * pMeshes, ShaderProgram * pProgram, GLuint texture, const InstanceData& instance, RenderPass pass = RENDER_PASS_OPAQUE, unsigned int lod = 0);
+	void sort();
+
+	//Adds another queue's packets after this one's, for queues filled in parallel and merged before sorting
+	void append(const RenderQueue& other);
+
+	const glm::mat4& getViewMatrix()
+	{
+		return m_ViewMatrix;
+	};
+
+	const glm::mat4& getProjectionMatrix()
+	{
+		return m_ProjectionMatrix;
+	};
+
+	float getFarPlane()
+	{
+		return m_FarPlane;
+	};
+
+	//How much of the screen's height a bounding sphere covers with this queue's camera
+	float getScreenCoverage(const BoundingSphere& worldSphere)
+	{
+		return computeScreenCoverage(worldSphere, m_ViewMatrix, m_ProjectionMatrix[1][1]);
+	};
+
+	unsigned int getPacketCount()
+	{
+		return (unsigned int)m_Packets.size();
+	};
+
+	//Packets in sorted order, only valid after sort()
+	const DrawPacket& getSortedPacket(unsigned int i)
+	{
+		return m_Packets[m_SortedKeys[i].packetIndex];
+	};
+
+	uint64_t getSortedKey(unsigned int i)
+	{
+		return m_SortedKeys[i].key;
+	};
+
+	//True if two keys only differ by depth, so their packets can be drawn as instances of the same batch
+	static bool isSameBatch(uint64_t a, uint64_t b)
+	{
+		return (a >> SORT_KEY_DEPTH_BITS) == (b >> SORT_KEY_DEPTH_BITS);
+	};
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t packetIndex;
+	};
+
+	uint64_t buildKey(RenderPass pass, ShaderProgram * pProgram, GLuint texture, Mesh * pMesh, unsigned int lod, float depth);
+
+	std::vector<DrawPacket> m_Packets;
+	std::vector<SortEntry> m_SortedKeys;
+	std::vector<SortEntry> m_SortScratch;
+
+	glm::mat4 m_ViewMatrix;
+	glm::mat4 m_ProjectionMatrix;
+	float m_FarPlane;
+};
@@ -0,0 +1,70 @@
+#include "RenderTargetPool.h"
+
+#include <cstdio>
+
+RenderTargetPool::RenderTargetPool()
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	destroy();
+}
+
+RenderTarget * RenderTargetPool::acquire(int width, int height, GLenum internalFormat)
+{
+	for (RenderTarget * pTarget : m_Targets)
+	{
+		if (!pTarget->inUse && pTarget->width == width && pTarget->height == height && pTarget->internalFormat == internalFormat)
+		{
+			pTarget->inUse = true;
+			return pTarget;
+		}
+	}
+
+	RenderTarget * pTarget = new RenderTarget();
+	pTarget->width = width;
+	pTarget->height = height;
+	pTarget->internalFormat = internalFormat;
+	pTarget->inUse = true;
+
+	//Linear filtering so a smaller pass reading a bigger target is downsampled, and clamped so blurs don't wrap
+	glGenTextures(1, &pTarget->textureID);
+	glBindTexture(GL_TEXTURE_2D, pTarget->textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glGenFramebuffers(1, &pTarget->frameBufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, pTarget->frameBufferID);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, pTarget->textureID, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("Render target %dx%d is incomplete\n", width, height);
+	}
+
+	m_Targets.push_back(pTarget);
+	return pTarget;
+}
+
+void RenderTargetPool::release(RenderTarget * pTarget)
+{
+	if (pTarget != nullptr)
+	{
+		pTarget->inUse = false;
+	}
+}
+
+void RenderTargetPool::destroy()
+{
+	for (RenderTarget * pTarget : m_Targets)
+	{
+		glDeleteFramebuffers(1, &pTarget->frameBufferID);
+		glDeleteTextures(1, &pTarget->textureID);
+		delete pTarget;
+	}
+	m_Targets.clear();
+}
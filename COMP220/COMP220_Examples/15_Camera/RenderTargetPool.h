@@ -0,0 +1,40 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <vector>
+
+//A colour texture and the framebuffer it's attached to
+struct RenderTarget
+{
+	GLuint textureID;
+	GLuint frameBufferID;
+	int width;
+	int height;
+	GLenum internalFormat;
+	bool inUse;
+};
+
+//Hands out colour-only render targets and takes them back once they've been read, so passes of the same
+//size share a handful of targets instead of each owning one. Targets are only freed by destroy()
+class RenderTargetPool
+{
+public:
+	RenderTargetPool();
+	~RenderTargetPool();
+
+	//Reuses a free target of the same size and format, or creates one
+	RenderTarget * acquire(int width, int height, GLenum internalFormat = GL_RGBA8);
+	void release(RenderTarget * pTarget);
+
+	void destroy();
+
+	unsigned int getTargetCount()
+	{
+		return (unsigned int)m_Targets.size();
+	};
+
+private:
+	std::vector<RenderTarget*> m_Targets;
+};
@@ -1,6 +1,53 @@
 #include "Shader.h"
 
-GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path) {
+bool readShaderFile(const char * filename, std::string & shaderCode)
+{
+	std::ifstream shaderStream(filename, std::ios::in | std::ios::binary);
+	if (!shaderStream.is_open())
+	{
+		return false;
+	}
+
+	//Read straight into the string rather than appending line by line
+	shaderStream.seekg(0, std::ios::end);
+	shaderCode.resize((size_t)shaderStream.tellg());
+	shaderStream.seekg(0, std::ios::beg);
+	shaderStream.read(&shaderCode[0], shaderCode.size());
+	return true;
+}
+
+void insertShaderDefines(std::string& shaderCode, const char * defines)
+{
+	if (defines == nullptr || defines[0] == '\0')
+	{
+		return;
+	}
+
+	size_t insertPosition = 0;
+	size_t versionPosition = shaderCode.find("#version");
+	if (versionPosition != std::string::npos)
+	{
+		insertPosition = shaderCode.find('\n', versionPosition);
+		insertPosition = (insertPosition == std::string::npos) ? shaderCode.size() : insertPosition + 1;
+	}
+	shaderCode.insert(insertPosition, defines);
+}
+
+bool checkShaderCompile(GLuint shaderID, const char * filename)
+{
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &Result);
+	glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength > 0) {
+		std::vector<char> ShaderErrorMessage(InfoLogLength + 1);
+		glGetShaderInfoLog(shaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		printf("%s: %s\n", filename, &ShaderErrorMessage[0]);
+	}
+	return Result == GL_TRUE;
+}
+
+GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path, const char * defines) {
 
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
@@ -8,14 +55,7 @@ GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_pat
 
 	// Read the Vertex Shader code from the file
 	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if (VertexShaderStream.is_open()) {
-		std::string Line = "";
-		while (getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}
-	else {
+	if (!readShaderFile(vertex_file_path, VertexShaderCode)) {
 		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
 		getchar();
 		return 0;
@@ -23,13 +63,10 @@ GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_pat
 
 	// Read the Fragment Shader code from the file
 	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if (FragmentShaderStream.is_open()) {
-		std::string Line = "";
-		while (getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
-	}
+	readShaderFile(fragment_file_path, FragmentShaderCode);
+
+	insertShaderDefines(VertexShaderCode, defines);
+	insertShaderDefines(FragmentShaderCode, defines);
 
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
@@ -7,4 +7,14 @@
 #include <vector>
 #include <fstream>
 
-GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path);
\ No newline at end of file
+//Reads the whole file in one go, false if it can't be opened
+bool readShaderFile(const char * filename, std::string& shaderCode);
+
+//Inserts the defines after the #version directive, which has to stay the first thing in the shader
+void insertShaderDefines(std::string& shaderCode, const char * defines);
+
+//Prints the info log of a compiled shader and returns whether it compiled
+bool checkShaderCompile(GLuint shaderID, const char * filename);
+
+//defines are inserted straight after the #version line of both shaders, used to build shader variants
+GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path, const char * defines = "");
\ No newline at end of file
@@ -0,0 +1,556 @@
+#include "ShaderLibrary.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <chrono>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+//FNV-1a, only used to tell sources apart so it doesn't need to be any stronger
+static uint64_t hashBytes(const void * pData, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+	const unsigned char * pBytes = (const unsigned char*)pData;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static uint64_t hashSources(const std::string& vertexCode, const std::string& fragmentCode)
+{
+	//Hash a separator between the two so moving text from one shader to the other changes the hash
+	uint64_t hash = hashBytes(vertexCode.data(), vertexCode.size());
+	hash = hashBytes("", 1, hash);
+	return hashBytes(fragmentCode.data(), fragmentCode.size(), hash);
+}
+
+static time_t getModifiedTime(const std::string& filename)
+{
+	struct stat fileStat;
+	if (stat(filename.c_str(), &fileStat) != 0)
+	{
+		return 0;
+	}
+	return fileStat.st_mtime;
+}
+
+static double toMilliseconds(Uint64 start)
+{
+	return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+ShaderLibrary & ShaderLibrary::get()
+{
+	static ShaderLibrary instance;
+	return instance;
+}
+
+ShaderLibrary::ShaderLibrary()
+{
+	m_Initialised = false;
+	m_BinaryCache = false;
+	m_ParallelCompile = false;
+	m_Destroying = false;
+	m_DriverHash = 0;
+	m_CompileCount = 0;
+	m_BinaryLoadCount = 0;
+	m_Quit = false;
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+}
+
+void ShaderLibrary::init(const std::string & cacheDirectory)
+{
+	m_CacheDirectory = cacheDirectory;
+
+	//Some drivers expose the extension but no formats, which means they can't actually save binaries
+	GLint numberOfBinaryFormats = 0;
+	if (GLEW_ARB_get_program_binary)
+	{
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numberOfBinaryFormats);
+	}
+	m_BinaryCache = numberOfBinaryFormats > 0;
+	if (m_BinaryCache)
+	{
+#ifdef _WIN32
+		_mkdir(m_CacheDirectory.c_str());
+#else
+		mkdir(m_CacheDirectory.c_str(), 0755);
+#endif
+		std::string driver = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+		m_DriverHash = hashBytes(driver.data(), driver.size());
+	}
+
+	//Lets the driver compile on its own threads, so a hot reload doesn't stall the frame it was started in
+	m_ParallelCompile = GLEW_ARB_parallel_shader_compile != 0;
+	if (m_ParallelCompile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+
+	printf("Shader library: program binary cache %s, parallel compile %s\n", m_BinaryCache ? m_CacheDirectory.c_str() : "unsupported", m_ParallelCompile ? "on" : "off");
+
+	m_Quit = false;
+	m_WatchThread = std::thread(&ShaderLibrary::watchThread, this);
+	m_Initialised = true;
+}
+
+void ShaderLibrary::destroy()
+{
+	if (m_Initialised)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Quit = true;
+		}
+		m_QuitSignal.notify_all();
+		m_WatchThread.join();
+		m_Initialised = false;
+	}
+
+	m_Destroying = true;
+	for (Entry * pEntry : m_Entries)
+	{
+		cancelBuild(pEntry->pending);
+		delete pEntry->program;
+		delete pEntry;
+	}
+	m_Entries.clear();
+	m_EntriesBySource.clear();
+	m_Sources.clear();
+	m_WatchedFiles.clear();
+	m_ChangedFiles.clear();
+	m_Destroying = false;
+}
+
+ShaderProgram * ShaderLibrary::acquire(const std::string & vertexShaderFilename, const std::string & fragmentShaderFilename, const std::string & defines)
+{
+	std::string vertexCode;
+	std::string fragmentCode;
+	if (!buildSources(vertexShaderFilename, fragmentShaderFilename, defines, vertexCode, fragmentCode))
+	{
+		return nullptr;
+	}
+
+	uint64_t sourceHash = hashSources(vertexCode, fragmentCode);
+	auto iter = m_EntriesBySource.find(sourceHash);
+	if (iter != m_EntriesBySource.end())
+	{
+		iter->second->refCount++;
+		return iter->second->program;
+	}
+
+	GLuint programID = loadBinary(sourceHash);
+	if (programID == 0)
+	{
+		printf("Compiling program : %s %s\n", vertexShaderFilename.c_str(), fragmentShaderFilename.c_str());
+		programID = finishBuild(beginBuild(vertexCode, fragmentCode, sourceHash), vertexShaderFilename, fragmentShaderFilename);
+		if (programID == 0)
+		{
+			return nullptr;
+		}
+		saveBinary(programID, sourceHash);
+	}
+
+	Entry * pEntry = new Entry();
+	pEntry->program = new ShaderProgram();
+	pEntry->program->setProgram(programID, vertexShaderFilename, fragmentShaderFilename, defines);
+	pEntry->refCount = 1;
+	pEntry->vertexShaderFilename = vertexShaderFilename;
+	pEntry->fragmentShaderFilename = fragmentShaderFilename;
+	pEntry->defines = defines;
+	pEntry->sourceHash = sourceHash;
+	pEntry->pending.programID = 0;
+
+	m_Entries.push_back(pEntry);
+	m_EntriesBySource[sourceHash] = pEntry;
+
+	watchFile(vertexShaderFilename);
+	watchFile(fragmentShaderFilename);
+	return pEntry->program;
+}
+
+void ShaderLibrary::release(ShaderProgram * pProgram)
+{
+	if (m_Destroying)
+	{
+		return;
+	}
+
+	for (auto iter = m_Entries.begin(); iter != m_Entries.end(); iter++)
+	{
+		Entry * pEntry = *iter;
+		if (pEntry->program != pProgram)
+		{
+			continue;
+		}
+
+		if (--pEntry->refCount == 0)
+		{
+			//Take the entry out before deleting the program, which releases its own variants back to us
+			m_Entries.erase(iter);
+			auto sourceIter = m_EntriesBySource.find(pEntry->sourceHash);
+			if (sourceIter != m_EntriesBySource.end() && sourceIter->second == pEntry)
+			{
+				m_EntriesBySource.erase(sourceIter);
+			}
+
+			cancelBuild(pEntry->pending);
+			delete pEntry->program;
+			delete pEntry;
+		}
+		return;
+	}
+}
+
+void ShaderLibrary::update()
+{
+	if (!m_Initialised)
+	{
+		return;
+	}
+
+	std::map<std::string, std::string> changedFiles;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		changedFiles.swap(m_ChangedFiles);
+	}
+
+	for (auto& file : changedFiles)
+	{
+		printf("%s changed, rebuilding the programs that use it\n", file.first.c_str());
+		m_Sources[file.first] = file.second;
+
+		for (Entry * pEntry : m_Entries)
+		{
+			if (pEntry->vertexShaderFilename == file.first || pEntry->fragmentShaderFilename == file.first)
+			{
+				rebuild(pEntry);
+			}
+		}
+	}
+
+	//Swapping happens here, between frames, so a draw never sees a half updated program
+	for (Entry * pEntry : m_Entries)
+	{
+		if (pEntry->pending.programID == 0 || !isBuildFinished(pEntry->pending))
+		{
+			continue;
+		}
+
+		GLuint programID = finishBuild(pEntry->pending, pEntry->vertexShaderFilename, pEntry->fragmentShaderFilename);
+		if (programID != 0)
+		{
+			printf("Reloaded %s %s in %.2fms\n", pEntry->vertexShaderFilename.c_str(), pEntry->fragmentShaderFilename.c_str(), toMilliseconds(pEntry->pending.startTime));
+			saveBinary(programID, pEntry->pending.sourceHash);
+			swapProgram(pEntry, programID, pEntry->pending.sourceHash);
+		}
+		else
+		{
+			printf("Keeping the previous %s %s until the errors are fixed\n", pEntry->vertexShaderFilename.c_str(), pEntry->fragmentShaderFilename.c_str());
+		}
+		pEntry->pending.programID = 0;
+	}
+}
+
+const std::string * ShaderLibrary::getSource(const std::string & filename)
+{
+	auto iter = m_Sources.find(filename);
+	if (iter != m_Sources.end())
+	{
+		return &iter->second;
+	}
+
+	std::string shaderCode;
+	if (!readShaderFile(filename.c_str(), shaderCode))
+	{
+		printf("Impossible to open %s. Are you in the right directory ?\n", filename.c_str());
+		return nullptr;
+	}
+	return &(m_Sources[filename] = shaderCode);
+}
+
+bool ShaderLibrary::buildSources(const std::string & vertexShaderFilename, const std::string & fragmentShaderFilename, const std::string & defines,
+	std::string & vertexCode, std::string & fragmentCode)
+{
+	const std::string * pVertexSource = getSource(vertexShaderFilename);
+	const std::string * pFragmentSource = getSource(fragmentShaderFilename);
+	if (pVertexSource == nullptr || pFragmentSource == nullptr)
+	{
+		return false;
+	}
+
+	vertexCode = *pVertexSource;
+	fragmentCode = *pFragmentSource;
+	insertShaderDefines(vertexCode, defines.c_str());
+	insertShaderDefines(fragmentCode, defines.c_str());
+	return true;
+}
+
+ShaderLibrary::PendingBuild ShaderLibrary::beginBuild(const std::string & vertexCode, const std::string & fragmentCode, uint64_t sourceHash)
+{
+	PendingBuild build;
+	build.sourceHash = sourceHash;
+	build.startTime = SDL_GetPerformanceCounter();
+
+	const char * pVertexSource = vertexCode.c_str();
+	build.vertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(build.vertexShaderID, 1, &pVertexSource, NULL);
+	glCompileShader(build.vertexShaderID);
+
+	const char * pFragmentSource = fragmentCode.c_str();
+	build.fragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(build.fragmentShaderID, 1, &pFragmentSource, NULL);
+	glCompileShader(build.fragmentShaderID);
+
+	//Linking straight away is fine, the driver waits for the compiles itself and nothing is checked until finishBuild
+	build.programID = glCreateProgram();
+	glAttachShader(build.programID, build.vertexShaderID);
+	glAttachShader(build.programID, build.fragmentShaderID);
+	if (m_BinaryCache)
+	{
+		glProgramParameteri(build.programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(build.programID);
+
+	m_CompileCount++;
+	return build;
+}
+
+bool ShaderLibrary::isBuildFinished(const PendingBuild & build)
+{
+	if (!m_ParallelCompile)
+	{
+		return true;
+	}
+
+	GLint finished = GL_FALSE;
+	glGetProgramiv(build.programID, GL_COMPLETION_STATUS_ARB, &finished);
+	return finished == GL_TRUE;
+}
+
+GLuint ShaderLibrary::finishBuild(const PendingBuild & build, const std::string & vertexShaderFilename, const std::string & fragmentShaderFilename)
+{
+	//Check both so every error is printed, not just the first shader's
+	bool vertexCompiled = checkShaderCompile(build.vertexShaderID, vertexShaderFilename.c_str());
+	bool fragmentCompiled = checkShaderCompile(build.fragmentShaderID, fragmentShaderFilename.c_str());
+
+	GLint linked = GL_FALSE;
+	int infoLogLength = 0;
+	glGetProgramiv(build.programID, GL_LINK_STATUS, &linked);
+	glGetProgramiv(build.programID, GL_INFO_LOG_LENGTH, &infoLogLength);
+	if (infoLogLength > 1)
+	{
+		std::vector<char> programErrorMessage(infoLogLength + 1);
+		glGetProgramInfoLog(build.programID, infoLogLength, NULL, &programErrorMessage[0]);
+		printf("%s\n", &programErrorMessage[0]);
+	}
+
+	glDetachShader(build.programID, build.vertexShaderID);
+	glDetachShader(build.programID, build.fragmentShaderID);
+	glDeleteShader(build.vertexShaderID);
+	glDeleteShader(build.fragmentShaderID);
+
+	if (!vertexCompiled || !fragmentCompiled || linked != GL_TRUE)
+	{
+		glDeleteProgram(build.programID);
+		return 0;
+	}
+	return build.programID;
+}
+
+void ShaderLibrary::cancelBuild(PendingBuild & build)
+{
+	if (build.programID == 0)
+	{
+		return;
+	}
+
+	glDeleteShader(build.vertexShaderID);
+	glDeleteShader(build.fragmentShaderID);
+	glDeleteProgram(build.programID);
+	build.programID = 0;
+}
+
+void ShaderLibrary::rebuild(Entry * pEntry)
+{
+	std::string vertexCode;
+	std::string fragmentCode;
+	if (!buildSources(pEntry->vertexShaderFilename, pEntry->fragmentShaderFilename, pEntry->defines, vertexCode, fragmentCode))
+	{
+		return;
+	}
+
+	//A save that didn't change anything, or a second save while the first rebuild is still going
+	uint64_t sourceHash = hashSources(vertexCode, fragmentCode);
+	if (pEntry->pending.programID != 0)
+	{
+		if (pEntry->pending.sourceHash == sourceHash)
+		{
+			return;
+		}
+		cancelBuild(pEntry->pending);
+	}
+	if (sourceHash == pEntry->sourceHash)
+	{
+		return;
+	}
+
+	//Undoing an edit usually finds the old binary still in the cache
+	GLuint programID = loadBinary(sourceHash);
+	if (programID != 0)
+	{
+		printf("Reloaded %s %s from the binary cache\n", pEntry->vertexShaderFilename.c_str(), pEntry->fragmentShaderFilename.c_str());
+		swapProgram(pEntry, programID, sourceHash);
+		return;
+	}
+
+	pEntry->pending = beginBuild(vertexCode, fragmentCode, sourceHash);
+}
+
+void ShaderLibrary::swapProgram(Entry * pEntry, GLuint programID, uint64_t sourceHash)
+{
+	auto iter = m_EntriesBySource.find(pEntry->sourceHash);
+	if (iter != m_EntriesBySource.end() && iter->second == pEntry)
+	{
+		m_EntriesBySource.erase(iter);
+	}
+	//If another entry already has this source the two stay separate, new acquires get the other one
+	m_EntriesBySource.insert(std::make_pair(sourceHash, pEntry));
+	pEntry->sourceHash = sourceHash;
+
+	pEntry->program->setProgram(programID, pEntry->vertexShaderFilename, pEntry->fragmentShaderFilename, pEntry->defines);
+}
+
+std::string ShaderLibrary::getBinaryFilename(uint64_t sourceHash)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)sourceHash);
+	return m_CacheDirectory + "/" + name + SHADER_BINARY_EXTENSION;
+}
+
+GLuint ShaderLibrary::loadBinary(uint64_t sourceHash)
+{
+	if (!m_BinaryCache)
+	{
+		return 0;
+	}
+
+	MappedFile file;
+	if (!file.open(getBinaryFilename(sourceHash)) || file.getSize() < sizeof(ShaderBinaryHeader))
+	{
+		return 0;
+	}
+
+	const ShaderBinaryHeader * pHeader = (const ShaderBinaryHeader*)file.getData();
+	if (pHeader->magic != SHADER_BINARY_MAGIC || pHeader->version != SHADER_BINARY_VERSION || pHeader->driverHash != m_DriverHash ||
+		pHeader->sourceHash != sourceHash || sizeof(ShaderBinaryHeader) + pHeader->binarySize > file.getSize())
+	{
+		return 0;
+	}
+
+	GLuint programID = glCreateProgram();
+	glProgramBinary(programID, pHeader->binaryFormat, file.getData() + sizeof(ShaderBinaryHeader), pHeader->binarySize);
+
+	//The driver can still turn a binary down, it gets rebuilt from source and saved again
+	GLint linked = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		glDeleteProgram(programID);
+		return 0;
+	}
+
+	m_BinaryLoadCount++;
+	return programID;
+}
+
+void ShaderLibrary::saveBinary(GLuint programID, uint64_t sourceHash)
+{
+	if (!m_BinaryCache)
+	{
+		return;
+	}
+
+	GLint binarySize = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if (binarySize <= 0)
+	{
+		return;
+	}
+
+	std::vector<unsigned char> binary(binarySize);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(programID, binarySize, &binarySize, &binaryFormat, binary.data());
+
+	ShaderBinaryHeader header;
+	header.magic = SHADER_BINARY_MAGIC;
+	header.version = SHADER_BINARY_VERSION;
+	header.driverHash = m_DriverHash;
+	header.sourceHash = sourceHash;
+	header.binaryFormat = binaryFormat;
+	header.binarySize = (uint32_t)binarySize;
+
+	std::string filename = getBinaryFilename(sourceHash);
+	FILE * pFile = fopen(filename.c_str(), "wb");
+	if (pFile == nullptr)
+	{
+		printf("Unable to write program binary %s\n", filename.c_str());
+		return;
+	}
+	fwrite(&header, 1, sizeof(ShaderBinaryHeader), pFile);
+	fwrite(binary.data(), 1, binarySize, pFile);
+	fclose(pFile);
+}
+
+void ShaderLibrary::watchFile(const std::string & filename)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_WatchedFiles.find(filename) == m_WatchedFiles.end())
+	{
+		m_WatchedFiles[filename] = getModifiedTime(filename);
+	}
+}
+
+//Polls the modification times and reads the changed files here, so the GL thread only ever compiles
+void ShaderLibrary::watchThread()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (!m_QuitSignal.wait_for(lock, std::chrono::milliseconds(SHADER_WATCH_INTERVAL), [this] { return m_Quit; }))
+	{
+		std::map<std::string, time_t> watchedFiles = m_WatchedFiles;
+		lock.unlock();
+
+		std::map<std::string, std::string> changedFiles;
+		for (auto& file : watchedFiles)
+		{
+			time_t modifiedTime = getModifiedTime(file.first);
+			if (modifiedTime == file.second || modifiedTime == 0)
+			{
+				continue;
+			}
+
+			//Editors sometimes truncate before writing, an empty read is picked up again on the next poll
+			std::string shaderCode;
+			if (readShaderFile(file.first.c_str(), shaderCode) && !shaderCode.empty())
+			{
+				file.second = modifiedTime;
+				changedFiles[file.first] = shaderCode;
+			}
+		}
+
+		lock.lock();
+		for (auto& file : changedFiles)
+		{
+			m_WatchedFiles[file.first] = watchedFiles[file.first];
+			m_ChangedFiles[file.first] = file.second;
+		}
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+#include <SDL.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+
+#include "ShaderProgram.h"
+
+//Linked program binaries are kept here between runs, named by the hash of the source they were built from
+#define SHADER_CACHE_DIRECTORY "ShaderCache"
+#define SHADER_BINARY_EXTENSION ".bin"
+#define SHADER_BINARY_MAGIC 0x4E494250
+#define SHADER_BINARY_VERSION 1
+//How often the watcher thread checks the shader files for changes, in milliseconds
+#define SHADER_WATCH_INTERVAL 250
+
+struct ShaderBinaryHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	//Binaries only load on the driver that wrote them, this is a hash of its vendor, renderer and version strings
+	uint64_t driverHash;
+	uint64_t sourceHash;
+	uint32_t binaryFormat;
+	uint32_t binarySize;
+};
+
+//Owns every ShaderProgram. Programs are shared by a hash of their source and defines, so the same shader is only
+//ever built once, and the linked binary is saved so later runs skip compiling entirely. A watcher thread polls the
+//.glsl files, when one changes the programs using it are rebuilt without blocking and swapped into their existing
+//ShaderProgram between frames, so nothing holding one has to be told. A rebuild that fails keeps the old program
+class ShaderLibrary
+{
+public:
+	static ShaderLibrary& get();
+
+	//Needs a current GL context. Sets up the binary cache if the driver supports it and starts the watcher thread
+	void init(const std::string& cacheDirectory = SHADER_CACHE_DIRECTORY);
+	void destroy();
+
+	//Files with identical contents share one program, which is rebuilt from the files it was first loaded from
+	ShaderProgram * acquire(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename, const std::string& defines = "");
+	void release(ShaderProgram * pProgram);
+
+	//Starts rebuilding programs whose files changed and swaps in the ones that have finished, called once a frame on the GL thread
+	void update();
+
+	unsigned int getProgramCount()
+	{
+		return (unsigned int)m_Entries.size();
+	};
+
+	unsigned int getCompileCount()
+	{
+		return m_CompileCount;
+	};
+
+	unsigned int getBinaryLoadCount()
+	{
+		return m_BinaryLoadCount;
+	};
+
+private:
+	ShaderLibrary();
+	~ShaderLibrary();
+
+	//A program that has been handed to the driver to compile and link but not checked yet
+	struct PendingBuild
+	{
+		GLuint programID;
+		GLuint vertexShaderID;
+		GLuint fragmentShaderID;
+		uint64_t sourceHash;
+		Uint64 startTime;
+	};
+
+	struct Entry
+	{
+		ShaderProgram * program;
+		int refCount;
+		std::string vertexShaderFilename;
+		std::string fragmentShaderFilename;
+		std::string defines;
+		uint64_t sourceHash;
+		//Rebuild in flight after one of the files changed, programID is 0 when there isn't one
+		PendingBuild pending;
+	};
+
+	//Returns the file contents, read once and then kept up to date by the watcher
+	const std::string * getSource(const std::string& filename);
+	bool buildSources(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename, const std::string& defines,
+		std::string& vertexCode, std::string& fragmentCode);
+
+	PendingBuild beginBuild(const std::string& vertexCode, const std::string& fragmentCode, uint64_t sourceHash);
+	//Without parallel compile support every build counts as finished, and finishBuild waits for it
+	bool isBuildFinished(const PendingBuild& build);
+	//Prints the logs and returns the program if it compiled and linked, otherwise deletes it and returns 0
+	GLuint finishBuild(const PendingBuild& build, const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename);
+	void cancelBuild(PendingBuild& build);
+
+	void rebuild(Entry * pEntry);
+	void swapProgram(Entry * pEntry, GLuint programID, uint64_t sourceHash);
+
+	std::string getBinaryFilename(uint64_t sourceHash);
+	GLuint loadBinary(uint64_t sourceHash);
+	void saveBinary(GLuint programID, uint64_t sourceHash);
+
+	void watchFile(const std::string& filename);
+	void watchThread();
+
+	bool m_Initialised;
+	bool m_BinaryCache;
+	bool m_ParallelCompile;
+	//Set while destroying so programs releasing their variants don't touch the entry lists
+	bool m_Destroying;
+	std::string m_CacheDirectory;
+	uint64_t m_DriverHash;
+
+	unsigned int m_CompileCount;
+	unsigned int m_BinaryLoadCount;
+
+	std::vector<Entry*> m_Entries;
+	std::map<uint64_t, Entry*> m_EntriesBySource;
+	//Only touched on the GL thread
+	std::map<std::string, std::string> m_Sources;
+
+	std::thread m_WatchThread;
+	std::mutex m_Mutex;
+	std::condition_variable m_QuitSignal;
+	bool m_Quit;
+
+	//Both protected by m_Mutex. Every file in use with the modification time last seen, and the new contents of files that changed
+	std::map<std::string, time_t> m_WatchedFiles;
+	std::map<std::string, std::string> m_ChangedFiles;
+};
@@ -0,0 +1,178 @@
+#include "ShaderProgram.h"
+#include "UniformBuffer.h"
+#include "ShaderLibrary.h"
+#include "LightCuller.h"
+
+//Names of the uniforms in the UniformSlot enum, must be kept in the same order
+static const char * uniformSlotNames[UNIFORM_SLOT_COUNT] =
+{
+	"modelMatrix",
+	"baseTexture",
+	"ambientMaterialColour",
+	"diffuseMaterialColour",
+	"specularMaterialColour",
+	"specularPower",
+	"lightData",
+	"lightGrid",
+	"lightIndices"
+};
+
+ShaderProgram::ShaderProgram()
+{
+	static unsigned int nextSortID = 0;
+	m_SortID = nextSortID++;
+
+	m_ProgramID = 0;
+	for (int i = 0; i < UNIFORM_SLOT_COUNT; i++)
+	{
+		m_SlotLocations[i] = -1;
+	}
+}
+
+ShaderProgram::~ShaderProgram()
+{
+	destroy();
+}
+
+void ShaderProgram::setProgram(GLuint programID, const std::string & vertexShaderFilename, const std::string & fragmentShaderFilename, const std::string & defines)
+{
+	deleteProgram();
+
+	m_VertexShaderFilename = vertexShaderFilename;
+	m_FragmentShaderFilename = fragmentShaderFilename;
+	m_Defines = defines;
+
+	m_ProgramID = programID;
+	reflect();
+}
+
+ShaderProgram * ShaderProgram::getVariant(const VertexFormat & format)
+{
+	std::string defines = format.getShaderDefines();
+	if (defines == m_Defines)
+	{
+		return this;
+	}
+
+	auto iter = m_Variants.find(defines);
+	if (iter != m_Variants.end())
+	{
+		return iter->second;
+	}
+
+	ShaderProgram * pVariant = ShaderLibrary::get().acquire(m_VertexShaderFilename, m_FragmentShaderFilename, defines);
+	if (pVariant == nullptr)
+	{
+		//Fall back to the base program rather than drawing nothing
+		pVariant = this;
+	}
+	m_Variants[defines] = pVariant;
+	return pVariant;
+}
+
+void ShaderProgram::destroy()
+{
+	for (auto& variant : m_Variants)
+	{
+		if (variant.second != this)
+		{
+			ShaderLibrary::get().release(variant.second);
+		}
+	}
+	m_Variants.clear();
+
+	deleteProgram();
+}
+
+void ShaderProgram::deleteProgram()
+{
+	if (m_ProgramID != 0)
+	{
+		glDeleteProgram(m_ProgramID);
+		m_ProgramID = 0;
+	}
+	m_UniformLocations.clear();
+	for (int i = 0; i < UNIFORM_SLOT_COUNT; i++)
+	{
+		m_SlotLocations[i] = -1;
+	}
+}
+
+void ShaderProgram::use()
+{
+	glUseProgram(m_ProgramID);
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string & name) const
+{
+	auto iter = m_UniformLocations.find(name);
+	if (iter == m_UniformLocations.end())
+	{
+		return -1;
+	}
+	return iter->second;
+}
+
+//Queries every active uniform once so nothing has to be looked up by name while rendering
+void ShaderProgram::reflect()
+{
+	GLint numberOfUniforms = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(m_ProgramID, GL_ACTIVE_UNIFORMS, &numberOfUniforms);
+	glGetProgramiv(m_ProgramID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::string name;
+	name.resize(maxNameLength + 1);
+
+	for (GLuint i = 0; i < (GLuint)numberOfUniforms; i++)
+	{
+		//Uniforms inside a block have no location, they're fed by a uniform buffer instead
+		GLint blockIndex = -1;
+		glGetActiveUniformsiv(m_ProgramID, 1, &i, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+		if (blockIndex != -1)
+		{
+			continue;
+		}
+
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_ProgramID, i, maxNameLength, &nameLength, &size, &type, &name[0]);
+
+		//Arrays are reported as name[0], store them under their plain name
+		std::string uniformName(name.c_str(), nameLength);
+		size_t bracket = uniformName.find('[');
+		if (bracket != std::string::npos)
+		{
+			uniformName = uniformName.substr(0, bracket);
+		}
+
+		m_UniformLocations[uniformName] = glGetUniformLocation(m_ProgramID, uniformName.c_str());
+	}
+
+	for (int i = 0; i < UNIFORM_SLOT_COUNT; i++)
+	{
+		m_SlotLocations[i] = getUniformLocation(uniformSlotNames[i]);
+	}
+
+	//Attach the shared per frame block if the program declares it
+	GLuint perFrameBlockIndex = glGetUniformBlockIndex(m_ProgramID, PER_FRAME_BLOCK_NAME);
+	if (perFrameBlockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(m_ProgramID, perFrameBlockIndex, PER_FRAME_BINDING_POINT);
+	}
+
+	//The diffuse map always lives in texture unit 0 and the light buffers in theirs, so the samplers only need setting once
+	glUseProgram(m_ProgramID);
+	if (m_SlotLocations[UNIFORM_BASE_TEXTURE] != -1)
+	{
+		glUniform1i(m_SlotLocations[UNIFORM_BASE_TEXTURE], 0);
+	}
+	if (m_SlotLocations[UNIFORM_LIGHT_DATA] != -1)
+	{
+		glUniform1i(m_SlotLocations[UNIFORM_LIGHT_DATA], LIGHT_DATA_TEXTURE_UNIT);
+		glUniform1i(m_SlotLocations[UNIFORM_LIGHT_GRID], LIGHT_GRID_TEXTURE_UNIT);
+		glUniform1i(m_SlotLocations[UNIFORM_LIGHT_INDICES], LIGHT_INDEX_TEXTURE_UNIT);
+	}
+	glUseProgram(0);
+}
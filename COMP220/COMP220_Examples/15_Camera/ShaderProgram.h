@@ -0,0 +1,80 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <string>
+#include <map>
+
+#include "Shader.h"
+#include "VertexFormat.h"
+
+//Uniforms every object shader may use, their locations are looked up once when the program is linked
+enum UniformSlot
+{
+	UNIFORM_MODEL_MATRIX,
+	UNIFORM_BASE_TEXTURE,
+	UNIFORM_AMBIENT_MATERIAL_COLOUR,
+	UNIFORM_DIFFUSE_MATERIAL_COLOUR,
+	UNIFORM_SPECULAR_MATERIAL_COLOUR,
+	UNIFORM_SPECULAR_POWER,
+	UNIFORM_LIGHT_DATA,
+	UNIFORM_LIGHT_GRID,
+	UNIFORM_LIGHT_INDICES,
+	UNIFORM_SLOT_COUNT
+};
+
+//Wraps a linked shader program and caches the location of every active uniform
+class ShaderProgram
+{
+public:
+	ShaderProgram();
+	~ShaderProgram();
+
+	//Takes ownership of a linked program, deleting the one it replaces. Called by the ShaderLibrary when it first
+	//builds the program and again on hot reload, everything holding this ShaderProgram picks up the new one
+	void setProgram(GLuint programID, const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename, const std::string& defines);
+	void destroy();
+
+	//Returns the variant of this program compiled for a vertex format, acquired from the ShaderLibrary the first time it's asked for
+	ShaderProgram * getVariant(const VertexFormat& format);
+
+	void use();
+
+	//Returns the cached location of a uniform, -1 if the program doesn't use it
+	GLint getUniformLocation(const std::string& name) const;
+
+	GLint getUniformLocation(UniformSlot slot) const
+	{
+		return m_SlotLocations[slot];
+	};
+
+	GLuint getProgramID()
+	{
+		return m_ProgramID;
+	};
+
+	//Small number unique to this program, used in render queue sort keys
+	unsigned int getSortID()
+	{
+		return m_SortID;
+	};
+
+private:
+	void reflect();
+	void deleteProgram();
+
+	GLuint m_ProgramID;
+	unsigned int m_SortID;
+
+	std::string m_VertexShaderFilename;
+	std::string m_FragmentShaderFilename;
+	std::string m_Defines;
+
+	//Variants for other vertex formats keyed by their defines, released back to the library with this program
+	std::map<std::string, ShaderProgram*> m_Variants;
+
+	//Every active uniform outside of a uniform block, keyed by name
+	std::map<std::string, GLint> m_UniformLocations;
+	GLint m_SlotLocations[UNIFORM_SLOT_COUNT];
+};
@@ -0,0 +1,21 @@
+#include "SphereEmitter.h"
+
+SphereEmitter::SphereEmitter()
+{
+	m_Radius = 1.0f;
+	m_Hemisphere = false;
+}
+
+void SphereEmitter::emitParticles(unsigned int first, unsigned int count)
+{
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		glm::vec3 direction = randomDirection();
+		if (m_Hemisphere)
+		{
+			direction.y = glm::abs(direction.y);
+		}
+
+		setParticle(i, m_Position + direction * m_Radius, direction * randomRange(m_Settings.minSpeed, m_Settings.maxSpeed));
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ParticleEmitter.h"
+
+//Spawns particles on the surface of a sphere centred on the emitter, each flying straight out from the centre.
+//Explosions, sparks and fountains when given some gravity
+class SphereEmitter : public ParticleEmitter
+{
+public:
+	SphereEmitter();
+
+	void setRadius(float radius)
+	{
+		m_Radius = radius;
+	};
+
+	//Keeps only the upper half of the sphere, for fountains and anything sitting on the ground
+	void setHemisphere(bool hemisphere)
+	{
+		m_Hemisphere = hemisphere;
+	};
+
+protected:
+	void emitParticles(unsigned int first, unsigned int count) override;
+
+private:
+	float m_Radius;
+	bool m_Hemisphere;
+};
@@ -1,9 +1,24 @@
 #include "Texture.h"
+#include "TextureCooker.h"
+
+#include <cstring>
 
 GLuint loadTextureFromFile(const std::string& filename)
 {
 	GLuint textureID;
-	
+
+	//Cooked DXT textures with their full mip chain take a fraction of the memory, use them whenever the driver can
+	if (GLEW_EXT_texture_compression_s3tc)
+	{
+		CompressedTexture compressedTexture;
+		if (loadCompressedTexture(filename, compressedTexture))
+		{
+			glGenTextures(1, &textureID);
+			glBindTexture(GL_TEXTURE_2D, textureID);
+			uploadCompressedTexture(compressedTexture, compressedTexture.data.data());
+			return textureID;
+		}
+	}
 
 	GLenum	textureFormat = GL_RGB;
 	GLenum	internalFormat = GL_RGB8;
@@ -41,8 +56,9 @@ GLuint loadTextureFromFile(const std::string& filename)
 
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_2D, textureID);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, surface->w, surface->h, 0, textureFormat, GL_UNSIGNED_BYTE, surface->pixels);
+	glGenerateMipmap(GL_TEXTURE_2D);
 	
 
 	SDL_FreeSurface(surface);
@@ -50,6 +66,37 @@ GLuint loadTextureFromFile(const std::string& filename)
 	return textureID;
 }
 
+bool loadImagePixels(const std::string & filename, std::vector<unsigned char>& pixels, int & width, int & height)
+{
+	SDL_Surface * surface = IMG_Load(filename.c_str());
+	if (surface == nullptr)
+	{
+		printf("Could not load file %s", IMG_GetError());
+		return false;
+	}
+
+	SDL_Surface * rgbaSurface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+	SDL_FreeSurface(surface);
+	if (rgbaSurface == nullptr)
+	{
+		printf("Could not convert %s to RGBA %s", filename.c_str(), SDL_GetError());
+		return false;
+	}
+
+	width = rgbaSurface->w;
+	height = rgbaSurface->h;
+
+	//Surface rows may be padded, the copy drops the padding
+	int rowSize = width * 4;
+	pixels.resize(rowSize * height);
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(&pixels[y * rowSize], (unsigned char*)rgbaSurface->pixels + y * rgbaSurface->pitch, rowSize);
+	}
+	SDL_FreeSurface(rgbaSurface);
+	return true;
+}
+
 GLuint createTexture(int width, int height)
 {
 	GLuint textureID = 0;
@@ -61,3 +108,31 @@ GLuint createTexture(int width, int height)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
 	return textureID;
 }
+
+bool saveFrameBufferToPNG(const std::string & filename, int width, int height)
+{
+	std::vector<unsigned char> pixels(width * height * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	SDL_Surface * pSurface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+	if (pSurface == nullptr)
+	{
+		printf("Unable to create surface for %s %s\n", filename.c_str(), SDL_GetError());
+		return false;
+	}
+
+	//GL rows start at the bottom of the image
+	for (int y = 0; y < height; y++)
+	{
+		memcpy((unsigned char*)pSurface->pixels + y * pSurface->pitch, &pixels[(height - 1 - y) * width * 4], width * 4);
+	}
+
+	bool saved = IMG_SavePNG(pSurface, filename.c_str()) == 0;
+	if (!saved)
+	{
+		printf("Unable to save %s %s\n", filename.c_str(), IMG_GetError());
+	}
+	SDL_FreeSurface(pSurface);
+	return saved;
+}
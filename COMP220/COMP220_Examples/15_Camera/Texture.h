@@ -5,7 +5,13 @@
 #include "SDL_image.h"
 
 #include <string>
+#include <vector>
 
 GLuint loadTextureFromFile(const std::string& filename);
 
-GLuint createTexture(int width, int height);
\ No newline at end of file
+//Decodes an image into tightly packed RGBA8 rows, safe to call from any thread
+bool loadImagePixels(const std::string& filename, std::vector<unsigned char>& pixels, int& width, int& height);
+
+GLuint createTexture(int width, int height);
+//Reads back the current read frame buffer and saves it as a PNG, flipped so the top row comes first
+bool saveFrameBufferToPNG(const std::string& filename, int width, int height);
@@ -0,0 +1,271 @@
+#include "TextureCooker.h"
+#include "MappedFile.h"
+#include "MeshCooker.h"
+#include "Texture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+//SOIL's headers are plain C
+extern "C"
+{
+#include "image_DXT.h"
+#include "image_helper.h"
+}
+
+#define DDS_MAGIC 0x20534444
+
+std::string getCookedTextureFilename(const std::string & sourceFilename)
+{
+	return sourceFilename + COOKED_TEXTURE_EXTENSION;
+}
+
+//Only the alpha channel decides the format, DXT1 halves the size of anything fully opaque
+static bool hasTransparency(const unsigned char * pPixels, int width, int height)
+{
+	int numberOfPixels = width * height;
+	for (int i = 0; i < numberOfPixels; i++)
+	{
+		if (pPixels[i * 4 + 3] != 255)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool compressTexture(const unsigned char * pPixels, int width, int height, CompressedTexture & texture)
+{
+	bool useDXT5 = hasTransparency(pPixels, width, height);
+	texture.format = useDXT5 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	texture.data.clear();
+	texture.levels.clear();
+
+	std::vector<unsigned char> level(pPixels, pPixels + width * height * 4);
+	std::vector<unsigned char> nextLevel;
+	while (true)
+	{
+		int compressedSize = 0;
+		unsigned char * pCompressed = useDXT5 ?
+			convert_image_to_DXT5(level.data(), width, height, 4, &compressedSize) :
+			convert_image_to_DXT1(level.data(), width, height, 4, &compressedSize);
+		if (pCompressed == nullptr)
+		{
+			printf("Unable to compress %dx%d texture level\n", width, height);
+			return false;
+		}
+
+		CompressedLevel compressedLevel;
+		compressedLevel.width = width;
+		compressedLevel.height = height;
+		compressedLevel.offset = texture.data.size();
+		compressedLevel.size = compressedSize;
+		texture.levels.push_back(compressedLevel);
+		texture.data.insert(texture.data.end(), pCompressed, pCompressed + compressedSize);
+		free(pCompressed);
+
+		if (width == 1 && height == 1)
+		{
+			break;
+		}
+
+		//Halve each side that can still be halved, matching the level sizes GL expects
+		int blockX = width > 1 ? 2 : 1;
+		int blockY = height > 1 ? 2 : 1;
+		int nextWidth = width / blockX;
+		int nextHeight = height / blockY;
+		nextLevel.resize(nextWidth * nextHeight * 4);
+		mipmap_image(level.data(), width, height, 4, nextLevel.data(), blockX, blockY);
+
+		level.swap(nextLevel);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	return true;
+}
+
+bool writeDDSFile(const std::string & filename, const CompressedTexture & texture)
+{
+	if (texture.levels.empty())
+	{
+		return false;
+	}
+
+	DDS_header header;
+	memset(&header, 0, sizeof(header));
+	header.dwMagic = DDS_MAGIC;
+	header.dwSize = 124;
+	header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | DDSD_MIPMAPCOUNT;
+	header.dwWidth = texture.levels[0].width;
+	header.dwHeight = texture.levels[0].height;
+	header.dwPitchOrLinearSize = (unsigned int)texture.levels[0].size;
+	header.dwMipMapCount = (unsigned int)texture.levels.size();
+	header.sPixelFormat.dwSize = 32;
+	header.sPixelFormat.dwFlags = DDPF_FOURCC;
+	header.sPixelFormat.dwFourCC = texture.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? DDS_FOURCC_DXT5 : DDS_FOURCC_DXT1;
+	header.sCaps.dwCaps1 = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+	FILE * pFile = fopen(filename.c_str(), "wb");
+	if (pFile == nullptr)
+	{
+		printf("Unable to write cooked texture %s\n", filename.c_str());
+		return false;
+	}
+	fwrite(&header, sizeof(header), 1, pFile);
+	fwrite(texture.data.data(), 1, texture.data.size(), pFile);
+	fclose(pFile);
+	return true;
+}
+
+bool readDDSFile(const std::string & filename, CompressedTexture & texture)
+{
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		return false;
+	}
+
+	if (file.getSize() < sizeof(DDS_header))
+	{
+		printf("Cooked texture %s is truncated\n", filename.c_str());
+		return false;
+	}
+
+	DDS_header header;
+	memcpy(&header, file.getData(), sizeof(header));
+	if (header.dwMagic != DDS_MAGIC)
+	{
+		printf("%s is not a DDS file\n", filename.c_str());
+		return false;
+	}
+
+	size_t blockSize;
+	if (header.sPixelFormat.dwFourCC == DDS_FOURCC_DXT1)
+	{
+		texture.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		blockSize = 8;
+	}
+	else if (header.sPixelFormat.dwFourCC == DDS_FOURCC_DXT5)
+	{
+		texture.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		blockSize = 16;
+	}
+	else
+	{
+		printf("Cooked texture %s is not DXT1 or DXT5\n", filename.c_str());
+		return false;
+	}
+
+	int numberOfLevels = (header.dwFlags & DDSD_MIPMAPCOUNT) && header.dwMipMapCount > 0 ? header.dwMipMapCount : 1;
+	int width = header.dwWidth;
+	int height = header.dwHeight;
+	size_t offset = 0;
+	size_t dataSize = file.getSize() - sizeof(DDS_header);
+
+	texture.levels.clear();
+	for (int i = 0; i < numberOfLevels; i++)
+	{
+		CompressedLevel level;
+		level.width = width;
+		level.height = height;
+		level.offset = offset;
+		level.size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+		if (offset + level.size > dataSize)
+		{
+			printf("Cooked texture %s is truncated\n", filename.c_str());
+			return false;
+		}
+		texture.levels.push_back(level);
+
+		offset += level.size;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	const unsigned char * pData = (const unsigned char*)file.getData() + sizeof(DDS_header);
+	texture.data.assign(pData, pData + offset);
+	return true;
+}
+
+void uploadCompressedTexture(const CompressedTexture & texture, const unsigned char * pData)
+{
+	for (size_t i = 0; i < texture.levels.size(); i++)
+	{
+		const CompressedLevel& level = texture.levels[i];
+		glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, texture.format, level.width, level.height, 0, (GLsizei)level.size, pData + level.offset);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+bool isImageFile(const std::string & filename)
+{
+	size_t dot = filename.find_last_of('.');
+	if (dot == std::string::npos)
+	{
+		return false;
+	}
+
+	std::string extension = filename.substr(dot + 1);
+	for (char& c : extension)
+	{
+		c = (char)tolower(c);
+	}
+	return extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "tga" || extension == "bmp";
+}
+
+bool cookTextureFile(const std::string & sourceFilename)
+{
+	std::vector<unsigned char> pixels;
+	int width = 0;
+	int height = 0;
+	if (!loadImagePixels(sourceFilename, pixels, width, height))
+	{
+		return false;
+	}
+
+	CompressedTexture texture;
+	if (!compressTexture(pixels.data(), width, height, texture))
+	{
+		return false;
+	}
+
+	std::string cookedFilename = getCookedTextureFilename(sourceFilename);
+	if (!writeDDSFile(cookedFilename, texture))
+	{
+		return false;
+	}
+
+	printf("Cooked %s to %s, %dx%d %s with %d levels, %u bytes\n", sourceFilename.c_str(), cookedFilename.c_str(), width, height,
+		texture.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? "DXT5" : "DXT1", (int)texture.levels.size(), (unsigned int)texture.data.size());
+	return true;
+}
+
+bool loadCompressedTexture(const std::string & sourceFilename, CompressedTexture & texture)
+{
+	std::string cookedFilename = getCookedTextureFilename(sourceFilename);
+	if (!isCookedFileStale(sourceFilename, cookedFilename) && readDDSFile(cookedFilename, texture))
+	{
+		return true;
+	}
+
+	std::vector<unsigned char> pixels;
+	int width = 0;
+	int height = 0;
+	if (!loadImagePixels(sourceFilename, pixels, width, height))
+	{
+		return false;
+	}
+	if (!compressTexture(pixels.data(), width, height, texture))
+	{
+		return false;
+	}
+
+	writeDDSFile(cookedFilename, texture);
+	return true;
+}
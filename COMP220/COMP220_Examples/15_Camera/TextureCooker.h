@@ -0,0 +1,54 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <string>
+#include <vector>
+
+//Cooked textures are DDS files holding a full mip chain compressed to DXT1, or DXT5 when the image has any transparency.
+//The compression is done by SOIL's image_DXT and the mip levels are made with image_helper's box filter
+#define COOKED_TEXTURE_EXTENSION ".dds"
+
+//FourCC codes as they appear in the DDS pixel format
+#define DDS_FOURCC_DXT1 0x31545844
+#define DDS_FOURCC_DXT5 0x35545844
+
+struct CompressedLevel
+{
+	int width;
+	int height;
+	//Into CompressedTexture::data
+	size_t offset;
+	size_t size;
+};
+
+//Every mip level of one texture stored back to back, ready for glCompressedTexImage2D
+struct CompressedTexture
+{
+	GLenum format;
+	std::vector<unsigned char> data;
+	std::vector<CompressedLevel> levels;
+};
+
+std::string getCookedTextureFilename(const std::string& sourceFilename);
+
+//Builds the mip chain from tightly packed RGBA8 pixels and compresses every level
+bool compressTexture(const unsigned char * pPixels, int width, int height, CompressedTexture& texture);
+
+bool writeDDSFile(const std::string& filename, const CompressedTexture& texture);
+//Only DXT1 and DXT5 2D textures are accepted
+bool readDDSFile(const std::string& filename, CompressedTexture& texture);
+
+//Uploads every level and turns on trilinear filtering, the texture must already be bound.
+//pData is the address of the texture's data, or an offset when a pixel unpack buffer is bound
+void uploadCompressedTexture(const CompressedTexture& texture, const unsigned char * pData);
+
+//True for the image types SDL_image is used to load, judged by extension
+bool isImageFile(const std::string& filename);
+
+//Offline cook of a source image, writes the DDS file next to it
+bool cookTextureFile(const std::string& sourceFilename);
+
+//Reads the cooked DDS if it's up to date, otherwise compresses the source image and writes the DDS for next time
+bool loadCompressedTexture(const std::string& sourceFilename, CompressedTexture& texture);
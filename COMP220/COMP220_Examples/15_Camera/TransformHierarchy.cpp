@@ -0,0 +1,250 @@
+#include "TransformHierarchy.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+TransformHierarchy & TransformHierarchy::get()
+{
+	static TransformHierarchy instance;
+	return instance;
+}
+
+TransformHierarchy::TransformHierarchy()
+{
+	m_NeedsSort = false;
+}
+
+TransformHierarchy::~TransformHierarchy()
+{
+}
+
+TransformID TransformHierarchy::create()
+{
+	TransformID id;
+	if (!m_FreeIDs.empty())
+	{
+		id = m_FreeIDs.back();
+		m_FreeIDs.pop_back();
+	}
+	else
+	{
+		id = (TransformID)m_Indices.size();
+		m_Indices.push_back(INVALID_TRANSFORM);
+		m_Parents.push_back(INVALID_TRANSFORM);
+	}
+
+	//A root can go anywhere in depth order, so appending it doesn't need a re-sort
+	m_Indices[id] = (unsigned int)m_IDs.size();
+	m_Parents[id] = INVALID_TRANSFORM;
+
+	m_LocalMatrices.push_back(glm::mat4(1.0f));
+	m_WorldMatrices.push_back(glm::mat4(1.0f));
+	m_ParentIndices.push_back(INVALID_TRANSFORM);
+	m_Dirty.push_back(1);
+	m_Updated.push_back(0);
+	m_IDs.push_back(id);
+	return id;
+}
+
+void TransformHierarchy::destroy(TransformID id)
+{
+	if (id >= m_Indices.size() || m_Indices[id] == INVALID_TRANSFORM)
+	{
+		return;
+	}
+
+	for (TransformID child = 0; child < m_Parents.size(); child++)
+	{
+		if (m_Parents[child] == id)
+		{
+			m_Parents[child] = INVALID_TRANSFORM;
+			m_Dirty[m_Indices[child]] = 1;
+		}
+	}
+
+	//The slot is dropped from the arrays when they are next sorted
+	m_IDs[m_Indices[id]] = INVALID_TRANSFORM;
+	m_Indices[id] = INVALID_TRANSFORM;
+	m_Parents[id] = INVALID_TRANSFORM;
+	m_FreeIDs.push_back(id);
+	m_NeedsSort = true;
+}
+
+bool TransformHierarchy::setParent(TransformID id, TransformID parent)
+{
+	//Walk up from the new parent, finding the node on the way would make a loop
+	for (TransformID ancestor = parent; ancestor != INVALID_TRANSFORM; ancestor = m_Parents[ancestor])
+	{
+		if (ancestor == id)
+		{
+			printf("Unable to parent transform %u to its own descendant %u\n", id, parent);
+			return false;
+		}
+	}
+
+	m_Parents[id] = parent;
+	m_Dirty[m_Indices[id]] = 1;
+	m_NeedsSort = true;
+	return true;
+}
+
+TransformID TransformHierarchy::getParent(TransformID id)
+{
+	return m_Parents[id];
+}
+
+void TransformHierarchy::setLocalMatrix(TransformID id, const glm::mat4 & localMatrix)
+{
+	unsigned int index = m_Indices[id];
+	m_LocalMatrices[index] = localMatrix;
+	m_Dirty[index] = 1;
+}
+
+const glm::mat4 & TransformHierarchy::getLocalMatrix(TransformID id)
+{
+	return m_LocalMatrices[m_Indices[id]];
+}
+
+const glm::mat4 & TransformHierarchy::getWorldMatrix(TransformID id)
+{
+	return m_WorldMatrices[m_Indices[id]];
+}
+
+bool TransformHierarchy::wasUpdated(TransformID id)
+{
+	return m_Updated[m_Indices[id]] != 0;
+}
+
+void TransformHierarchy::update()
+{
+	if (m_NeedsSort)
+	{
+		sortByDepth();
+	}
+
+	//Parents are a level above, so their world matrix and updated flag are final by the time a child reads them
+	unsigned int numberOfNodes = (unsigned int)m_IDs.size();
+	unsigned int numberOfLevels = m_LevelStarts.empty() ? 1 : (unsigned int)m_LevelStarts.size();
+	for (unsigned int level = 0; level < numberOfLevels; level++)
+	{
+		unsigned int begin = m_LevelStarts.empty() ? 0 : m_LevelStarts[level];
+		unsigned int end = level + 1 < numberOfLevels ? m_LevelStarts[level + 1] : numberOfNodes;
+		JobSystem::get().parallelFor(begin, end, TRANSFORM_JOB_GRAIN, [this](unsigned int first, unsigned int last)
+		{
+			updateRange(first, last);
+		});
+	}
+}
+
+void TransformHierarchy::updateRange(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		unsigned int parentIndex = m_ParentIndices[i];
+		bool parentUpdated = parentIndex != INVALID_TRANSFORM && m_Updated[parentIndex];
+		if (m_Dirty[i] || parentUpdated)
+		{
+			if (parentIndex == INVALID_TRANSFORM)
+			{
+				m_WorldMatrices[i] = m_LocalMatrices[i];
+			}
+			else
+			{
+				m_WorldMatrices[i] = m_WorldMatrices[parentIndex] * m_LocalMatrices[i];
+			}
+			m_Dirty[i] = 0;
+			m_Updated[i] = 1;
+		}
+		else
+		{
+			m_Updated[i] = 0;
+		}
+	}
+}
+
+void TransformHierarchy::clear()
+{
+	m_LocalMatrices.clear();
+	m_WorldMatrices.clear();
+	m_ParentIndices.clear();
+	m_Dirty.clear();
+	m_Updated.clear();
+	m_IDs.clear();
+	m_LevelStarts.clear();
+	m_Indices.clear();
+	m_Parents.clear();
+	m_FreeIDs.clear();
+	m_NeedsSort = false;
+}
+
+//Only runs when the shape of the hierarchy changes, never for plain transform edits
+void TransformHierarchy::sortByDepth()
+{
+	//Depth of every live node, found by walking up to its root
+	std::vector<unsigned int> depths(m_Indices.size(), 0);
+	std::vector<TransformID> order;
+	order.reserve(m_IDs.size());
+	for (TransformID id : m_IDs)
+	{
+		if (id == INVALID_TRANSFORM)
+		{
+			continue;
+		}
+
+		unsigned int depth = 0;
+		for (TransformID ancestor = m_Parents[id]; ancestor != INVALID_TRANSFORM; ancestor = m_Parents[ancestor])
+		{
+			depth++;
+		}
+		depths[id] = depth;
+		order.push_back(id);
+	}
+
+	//Stable so siblings keep their relative order and the arrays don't churn
+	std::stable_sort(order.begin(), order.end(), [&depths](TransformID a, TransformID b)
+	{
+		return depths[a] < depths[b];
+	});
+
+	unsigned int numberOfNodes = (unsigned int)order.size();
+	std::vector<glm::mat4> localMatrices(numberOfNodes);
+	std::vector<glm::mat4> worldMatrices(numberOfNodes);
+	std::vector<unsigned char> dirty(numberOfNodes);
+	std::vector<unsigned char> updated(numberOfNodes, 0);
+	for (unsigned int i = 0; i < numberOfNodes; i++)
+	{
+		unsigned int oldIndex = m_Indices[order[i]];
+		localMatrices[i] = m_LocalMatrices[oldIndex];
+		worldMatrices[i] = m_WorldMatrices[oldIndex];
+		dirty[i] = m_Dirty[oldIndex];
+	}
+
+	for (unsigned int i = 0; i < numberOfNodes; i++)
+	{
+		m_Indices[order[i]] = i;
+	}
+
+	m_LevelStarts.clear();
+	for (unsigned int i = 0; i < numberOfNodes; i++)
+	{
+		if (i == 0 || depths[order[i]] != depths[order[i - 1]])
+		{
+			m_LevelStarts.push_back(i);
+		}
+	}
+
+	m_ParentIndices.resize(numberOfNodes);
+	for (unsigned int i = 0; i < numberOfNodes; i++)
+	{
+		TransformID parent = m_Parents[order[i]];
+		m_ParentIndices[i] = parent == INVALID_TRANSFORM ? INVALID_TRANSFORM : m_Indices[parent];
+	}
+
+	m_LocalMatrices.swap(localMatrices);
+	m_WorldMatrices.swap(worldMatrices);
+	m_Dirty.swap(dirty);
+	m_Updated.swap(updated);
+	m_IDs.swap(order);
+	m_NeedsSort = false;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include <glm\glm.hpp>
+
+//Nodes per job when a depth level is split across the JobSystem
+#define TRANSFORM_JOB_GRAIN 1024
+
+//Handle to a node in the hierarchy, stays valid while nodes are re-sorted
+typedef unsigned int TransformID;
+#define INVALID_TRANSFORM 0xFFFFFFFF
+
+//Parent/child transforms stored in flat arrays sorted by depth, so every parent comes before its children.
+//Only nodes whose local matrix changed, or whose ancestor's world matrix changed, are recomputed,
+//and the whole propagation is a single sweep over the arrays
+class TransformHierarchy
+{
+public:
+	static TransformHierarchy& get();
+
+	//New nodes are roots with an identity local matrix
+	TransformID create();
+	//Any children are left as roots
+	void destroy(TransformID id);
+
+	//INVALID_TRANSFORM makes the node a root, returns false if the parent is one of the node's descendants
+	bool setParent(TransformID id, TransformID parent);
+	TransformID getParent(TransformID id);
+
+	void setLocalMatrix(TransformID id, const glm::mat4& localMatrix);
+	const glm::mat4& getLocalMatrix(TransformID id);
+	const glm::mat4& getWorldMatrix(TransformID id);
+
+	//True if the node's world matrix was recomputed by the last update()
+	bool wasUpdated(TransformID id);
+
+	//Recomputes the world matrix of every dirty node and its descendants. Each depth level only reads the ones above it,
+	//so the levels are swept in order with the nodes of a level split across the JobSystem
+	void update();
+
+	//Frees every node, called once at shutdown
+	void clear();
+
+private:
+	TransformHierarchy();
+	~TransformHierarchy();
+
+	void sortByDepth();
+	void updateRange(unsigned int begin, unsigned int end);
+
+	//Per node, in depth order
+	std::vector<glm::mat4> m_LocalMatrices;
+	std::vector<glm::mat4> m_WorldMatrices;
+	std::vector<unsigned int> m_ParentIndices;
+	std::vector<unsigned char> m_Dirty;
+	std::vector<unsigned char> m_Updated;
+	std::vector<TransformID> m_IDs;
+	//Index of the first node at each depth, found by the last sort. Roots created since then are appended
+	//after the deepest level, which is safe as nothing can be their child until the next sort
+	std::vector<unsigned int> m_LevelStarts;
+
+	//Per handle
+	std::vector<unsigned int> m_Indices;
+	std::vector<TransformID> m_Parents;
+	std::vector<TransformID> m_FreeIDs;
+
+	//Set when a parent changes or a node is destroyed, the arrays are re-sorted on the next update
+	bool m_NeedsSort;
+};
@@ -0,0 +1,41 @@
+#include "UniformBuffer.h"
+
+UniformBuffer::UniformBuffer()
+{
+	m_UBO = 0;
+	m_Size = 0;
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	destroy();
+}
+
+void UniformBuffer::init(GLsizeiptr size, GLuint bindingPoint)
+{
+	m_Size = size;
+
+	glGenBuffers(1, &m_UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::update(const void * pData, GLsizeiptr size)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+	//Orphan the old storage so we don't stall on a frame the GPU is still reading
+	glBufferData(GL_UNIFORM_BUFFER, m_Size, NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, pData);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::destroy()
+{
+	if (m_UBO != 0)
+	{
+		glDeleteBuffers(1, &m_UBO);
+		m_UBO = 0;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <glm\glm.hpp>
+
+//Name and binding point of the block shared by every object shader
+#define PER_FRAME_BLOCK_NAME "PerFrame"
+#define PER_FRAME_BINDING_POINT 0
+
+//Mirrors the std140 layout of the PerFrame block, only vec4 and mat4 are used so no padding is needed
+struct PerFrameUniforms
+{
+	glm::mat4 viewMatrix;
+	glm::mat4 projectionMatrix;
+	glm::vec4 cameraPosition;
+	glm::vec4 lightDirection;
+	glm::vec4 ambientLightColour;
+	glm::vec4 diffuseLightColour;
+	glm::vec4 specularLightColour;
+	//Scale and bias from gl_FragCoord and view depth to a light cluster, see LightCuller
+	glm::vec4 clusterParameters;
+};
+
+//A uniform buffer object attached to a fixed binding point
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+	~UniformBuffer();
+
+	void init(GLsizeiptr size, GLuint bindingPoint);
+	void update(const void *pData, GLsizeiptr size);
+	void destroy();
+
+private:
+	GLuint m_UBO;
+	GLsizeiptr m_Size;
+};
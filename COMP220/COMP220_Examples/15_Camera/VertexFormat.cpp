@@ -0,0 +1,86 @@
+#include "VertexFormat.h"
+
+#include <cstddef>
+
+#include <glm\glm.hpp>
+#include <glm\gtc\packing.hpp>
+
+GLsizei VertexFormat::getVertexSize() const
+{
+	GLsizei size = sizeof(PackedVertex);
+	if (hasColourStream())
+	{
+		size += sizeof(PackedColour);
+	}
+	return size;
+}
+
+void VertexFormat::setupAttributes(GLuint vertexBuffer, GLuint colourBuffer) const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+	glEnableVertexAttribArray(VERTEX_ATTRIBUTE_POSITION);
+	glVertexAttribPointer(VERTEX_ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, x));
+
+	//Packed types always have four components, the shader only reads xyz
+	glEnableVertexAttribArray(VERTEX_ATTRIBUTE_NORMAL);
+	glVertexAttribPointer(VERTEX_ATTRIBUTE_NORMAL, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+
+	glEnableVertexAttribArray(VERTEX_ATTRIBUTE_TEXTURE_COORD);
+	glVertexAttribPointer(VERTEX_ATTRIBUTE_TEXTURE_COORD, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, textureCoords));
+
+	if (hasColourStream())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, colourBuffer);
+		glEnableVertexAttribArray(VERTEX_ATTRIBUTE_COLOUR);
+		glVertexAttribPointer(VERTEX_ATTRIBUTE_COLOUR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedColour), (void*)0);
+	}
+	else
+	{
+		glDisableVertexAttribArray(VERTEX_ATTRIBUTE_COLOUR);
+	}
+}
+
+std::string VertexFormat::getShaderDefines() const
+{
+	std::string defines;
+	if (hasColourStream())
+	{
+		defines += "#define HAS_VERTEX_COLOUR\n";
+	}
+	return defines;
+}
+
+void packVertices(const Vertex * pVerts, unsigned int numberOfVerts, const VertexFormat & format, std::vector<PackedVertex>& packedVerts, std::vector<PackedColour>& packedColours)
+{
+	packedVerts.resize(numberOfVerts);
+	packedColours.clear();
+	if (format.hasColourStream())
+	{
+		packedColours.resize(numberOfVerts);
+	}
+
+	for (unsigned int i = 0; i < numberOfVerts; i++)
+	{
+		const Vertex& vertex = pVerts[i];
+		PackedVertex& packed = packedVerts[i];
+
+		packed.x = vertex.x;
+		packed.y = vertex.y;
+		packed.z = vertex.z;
+		//Normals must be unit length to survive the snorm packing, degenerate ones are left as zero
+		glm::vec3 normal(vertex.normalX, vertex.normalY, vertex.normalZ);
+		float normalLength = glm::length(normal);
+		if (normalLength > 0.0f)
+		{
+			normal /= normalLength;
+		}
+		packed.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+		packed.textureCoords = glm::packHalf2x16(glm::vec2(vertex.tu, vertex.tv));
+
+		if (format.hasColourStream())
+		{
+			packedColours[i] = glm::packUnorm4x8(glm::vec4(vertex.r, vertex.g, vertex.b, vertex.a));
+		}
+	}
+}
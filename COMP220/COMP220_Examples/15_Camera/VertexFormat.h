@@ -0,0 +1,75 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <SDL_opengl.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "vertex.h"
+
+//Attribute locations shared by every object vertex shader
+#define VERTEX_ATTRIBUTE_POSITION 0
+#define VERTEX_ATTRIBUTE_COLOUR 1
+#define VERTEX_ATTRIBUTE_TEXTURE_COORD 2
+#define VERTEX_ATTRIBUTE_NORMAL 3
+
+//Optional parts of a vertex layout
+enum VertexFormatFlags
+{
+	//Per vertex colour in its own RGBA8 stream, without it shaders use white
+	VERTEX_FORMAT_COLOUR = 1 << 0
+};
+
+//Main vertex stream, 20 bytes. Normals are snorm 10:10:10:2 and texture coordinates are two halfs
+struct PackedVertex
+{
+	float x, y, z;
+	uint32_t normal;
+	uint32_t textureCoords;
+};
+
+//RGBA8, only present when the format has VERTEX_FORMAT_COLOUR
+typedef uint32_t PackedColour;
+
+//Describes how a mesh's vertex streams are laid out, sets up the matching attribute pointers
+//and the defines that select the matching shader variant
+class VertexFormat
+{
+public:
+	VertexFormat(unsigned int flags = 0)
+	{
+		m_Flags = flags;
+	};
+
+	unsigned int getFlags() const
+	{
+		return m_Flags;
+	};
+
+	bool hasColourStream() const
+	{
+		return (m_Flags & VERTEX_FORMAT_COLOUR) != 0;
+	};
+
+	//Bytes per vertex across every stream
+	GLsizei getVertexSize() const;
+
+	//Sets the attribute pointers for the bound vertex array, colourBuffer is ignored if there's no colour stream
+	void setupAttributes(GLuint vertexBuffer, GLuint colourBuffer) const;
+
+	//#define lines inserted after the #version of every shader compiled for this format
+	std::string getShaderDefines() const;
+
+	bool operator==(const VertexFormat& other) const
+	{
+		return m_Flags == other.m_Flags;
+	};
+
+private:
+	unsigned int m_Flags;
+};
+
+//Converts full float vertices into the packed streams, colours are only written if the format has a colour stream
+void packVertices(const Vertex * pVerts, unsigned int numberOfVerts, const VertexFormat& format, std::vector<PackedVertex>& packedVerts, std::vector<PackedColour>& packedColours);
@@ -2,17 +2,85 @@
 
 in vec4 vertexColourOut;
 in vec2 vertexTextureCoordOut;
-in vec4 diffuse;
-in vec4 specular;
-in vec4 ambient;
+in vec3 worldPositionOut;
+in vec3 worldNormalOut;
+in float viewDepthOut;
+
+flat in vec4 ambientMaterialColour;
+flat in vec4 diffuseMaterialColour;
+flat in vec4 specularMaterialColour;
+flat in float specularPower;
 
 out vec4 colour;
 
+//Camera and lighting, shared by every object and uploaded once per frame
+layout(std140) uniform PerFrame
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightDirection;
+	vec4 ambientLightColour;
+	vec4 diffuseLightColour;
+	vec4 specularLightColour;
+	vec4 clusterParameters;
+};
+
+//Must match the cluster grid in LightCuller.h
+const ivec3 clusterCount=ivec3(16,9,24);
+
 uniform vec4 fragColour=vec4(1.0,1.0,1.0,1.0);
 
 uniform sampler2D baseTexture;
 
+//Two texels a light, position and radius then colour premultiplied by intensity
+uniform samplerBuffer lightData;
+//Offset into lightIndices and number of lights for each cluster
+uniform usamplerBuffer lightGrid;
+uniform usamplerBuffer lightIndices;
+
 void main()
 {
+	vec3 normal=normalize(worldNormalOut);
+	vec3 viewDirection=normalize(cameraPosition.xyz-worldPositionOut);
+
+	//calculate ambient
+	vec4 ambient=ambientMaterialColour*ambientLightColour;
+
+	//Directional light
+	float nDotl=clamp(dot(normal,lightDirection.xyz),0,1);
+	vec3 diffuseLight=diffuseLightColour.rgb*nDotl;
+	vec3 halfWay=normalize(lightDirection.xyz+viewDirection);
+	float nDoth=clamp(dot(normal,halfWay),0,1);
+	vec3 specularLight=specularLightColour.rgb*pow(nDoth,specularPower);
+
+	//Only the point lights binned into this pixel's cluster can reach it
+	ivec3 cluster=ivec3(gl_FragCoord.xy*clusterParameters.xy,log(viewDepthOut)*clusterParameters.z+clusterParameters.w);
+	cluster=clamp(cluster,ivec3(0),clusterCount-1);
+	uvec2 lightRange=texelFetch(lightGrid,(cluster.z*clusterCount.y+cluster.y)*clusterCount.x+cluster.x).xy;
+
+	for (uint i=0u;i<lightRange.y;i++)
+	{
+		int lightIndex=int(texelFetch(lightIndices,int(lightRange.x+i)).r);
+		vec4 positionAndRadius=texelFetch(lightData,lightIndex*2);
+		vec3 lightColour=texelFetch(lightData,lightIndex*2+1).rgb;
+
+		vec3 toLight=positionAndRadius.xyz-worldPositionOut;
+		float distance=length(toLight);
+		vec3 pointLightDirection=toLight/max(distance,0.0001f);
+
+		//Inverse square falloff windowed so it reaches zero exactly at the radius the light was binned with
+		float window=clamp(1.0f-pow(distance/positionAndRadius.w,4.0f),0.0f,1.0f);
+		float attenuation=window*window/(distance*distance+1.0f);
+
+		float pointNDotl=clamp(dot(normal,pointLightDirection),0,1);
+		diffuseLight+=lightColour*pointNDotl*attenuation;
+
+		vec3 pointHalfWay=normalize(pointLightDirection+viewDirection);
+		specularLight+=lightColour*pow(clamp(dot(normal,pointHalfWay),0,1),specularPower)*attenuation*pointNDotl;
+	}
+
+	vec4 diffuse=diffuseMaterialColour*vec4(diffuseLight,diffuseLightColour.a);
+	vec4 specular=specularMaterialColour*vec4(specularLight,specularLightColour.a);
 	colour=ambient+(diffuse*texture(baseTexture,vertexTextureCoordOut))+specular;
 }
\ No newline at end of file
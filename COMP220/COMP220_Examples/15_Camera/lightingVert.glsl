@@ -1,62 +1,66 @@
 #version 330 core
 
 layout(location=0) in vec3 vertexPosition;
+//Only meshes with a colour stream feed this attribute, everything else is white
+#ifdef HAS_VERTEX_COLOUR
 layout(location=1) in vec4 vertexColour;
+#else
+const vec4 vertexColour=vec4(1.0f,1.0f,1.0f,1.0f);
+#endif
 layout(location=2) in vec2 vertexTextureCoord;
 layout(location=3) in vec3 vertexNormals;
 
-uniform float time=0.0f;
-
-uniform mat4 modelMatrix=mat4(1.0f);
-uniform mat4 viewMatrix=mat4(1.0f);
-uniform mat4 projectionMatrix=mat4(1.0f);
+//Per instance data, streamed from the instance buffer
+layout(location=4) in mat4 instanceModelMatrix;
+layout(location=8) in vec4 instanceAmbientMaterialColour;
+layout(location=9) in vec4 instanceDiffuseMaterialColour;
+layout(location=10) in vec4 instanceSpecularMaterialColour;
+layout(location=11) in float instanceSpecularPower;
 
-//Camera position
-uniform vec3 cameraPosition;
-
-//Lighting
-uniform vec3 lightDirection;
-uniform vec4 ambientLightColour;
-uniform vec4 diffuseLightColour;
-uniform vec4 specularLightColour;
+uniform float time=0.0f;
 
-//Material
-uniform vec4 ambientMaterialColour;
-uniform vec4 diffuseMaterialColour;
-uniform vec4 specularMaterialColour;
-uniform float specularPower;
+//Camera and lighting, shared by every object and uploaded once per frame
+layout(std140) uniform PerFrame
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightDirection;
+	vec4 ambientLightColour;
+	vec4 diffuseLightColour;
+	vec4 specularLightColour;
+	vec4 clusterParameters;
+};
 
 out vec4 vertexColourOut;
 out vec2 vertexTextureCoordOut;
-out vec4 diffuse;
-out vec4 specular;
-out vec4 ambient;
+out vec3 worldPositionOut;
+out vec3 worldNormalOut;
+//Distance in front of the camera, picks the light cluster's depth slice
+out float viewDepthOut;
+
+//Lighting is worked out per pixel, so the material is passed on untouched
+flat out vec4 ambientMaterialColour;
+flat out vec4 diffuseMaterialColour;
+flat out vec4 specularMaterialColour;
+flat out float specularPower;
 
 void main()
 {
-	mat4 MVPMatrix=projectionMatrix*viewMatrix*modelMatrix;
-	vec4 worldNormals=normalize(modelMatrix*vec4(vertexNormals,0.0f));
-	
 	//World position of vertex
-	vec4 worldPosition=modelMatrix*vec4(vertexPosition,1.0f);
-
-	vec3 viewDirection=normalize(cameraPosition-worldPosition.xyz);
-
-	//calculate ambient
-	ambient=ambientMaterialColour*ambientLightColour;
+	vec4 worldPosition=instanceModelMatrix*vec4(vertexPosition,1.0f);
+	vec4 viewPosition=viewMatrix*worldPosition;
 
-	//Calculate Diffuse lighting
-	float nDotl=clamp(dot(worldNormals.xyz,lightDirection),0,1);
-	diffuse=diffuseMaterialColour*diffuseLightColour*nDotl;
+	worldPositionOut=worldPosition.xyz;
+	worldNormalOut=(instanceModelMatrix*vec4(vertexNormals,0.0f)).xyz;
+	viewDepthOut=-viewPosition.z;
 
-	//Calculate Specular lighting
-	vec3 halfWay=normalize(lightDirection+viewDirection);
-	float nDoth=clamp(dot(worldNormals.xyz,halfWay),0,1);
-	float specularInstensity=pow(nDoth,specularPower);
-	specular=specularMaterialColour*specularLightColour*specularInstensity;
-	
+	ambientMaterialColour=instanceAmbientMaterialColour;
+	diffuseMaterialColour=instanceDiffuseMaterialColour;
+	specularMaterialColour=instanceSpecularMaterialColour;
+	specularPower=instanceSpecularPower;
 
-	gl_Position=MVPMatrix*vec4(vertexPosition,1.0f);
+	gl_Position=projectionMatrix*viewPosition;
 	vertexColourOut=vertexColour;
 	vertexTextureCoordOut=vertexTextureCoord;
 }
\ No newline at end of file
@@ -6,44 +6,110 @@
 #pragma region "Initilisation"
 int main(int argc, char* args[])
 {
-	//Initialises the SDL Library, passing in SDL_INIT_VIDEO to only initialise the video subsystems
-	//https://wiki.libsdl.org/SDL_Init
-	if (SDL_Init(SDL_INIT_VIDEO) < 0)
+	//Offline cooker, "15_Camera -cook Tank1.FBX armoredrecon.fbx Tank1DF.png" writes the cooked meshes, collision trees and textures and exits without opening a window
+	if (argc > 1 && std::string(args[1]) == "-cook")
 	{
-		//Display an error message box
-		//https://wiki.libsdl.org/SDL_ShowSimpleMessageBox
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, SDL_GetError(), "SDL_Init failed", NULL);
-		return 1;
+		int failedCooks = 0;
+		for (int i = 2; i < argc; i++)
+		{
+			bool cooked = isImageFile(args[i]) ? cookTextureFile(args[i]) : cookMeshFile(args[i]) && cookCollisionFile(args[i]);
+			if (!cooked)
+			{
+				failedCooks++;
+			}
+		}
+		return failedCooks == 0 ? 0 : 1;
 	}
 
-	//Create an SDL2 Window
-	//https://wiki.libsdl.org/SDL_CreateWindow
-	SDL_Window* window = SDL_CreateWindow("SDL2 Window", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 800, 640, SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
-	//Checks to see if the window has been created, the pointer will have a value of some kind
-	if (window == nullptr)
+	//"15_Camera -bench-entities" compares the GameObject and EntityStore update paths and exits
+	if (argc > 1 && std::string(args[1]) == "-bench-entities")
 	{
-		//Shows error if creation of Window Fails
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, SDL_GetError(), "SDL_CreateWindow failed", NULL);
-		//Close the SDL Library
-		//https://wiki.libsdl.org/SDL_Quit
-		SDL_Quit();
-		return 1;
+		return runEntityBenchmark();
 	}
 
-	//Gets 3.2 version of OPENGL
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	//"15_Camera -bench-jobs" shows how the entity update, culling and submission scale with the number of job threads
+	if (argc > 1 && std::string(args[1]) == "-bench-jobs")
+	{
+		return runJobBenchmark();
+	}
 
-	//SDL Context/Window is created here
-	SDL_GLContext GL_Context = SDL_GL_CreateContext(window);
-	if (GL_Context == nullptr)
+	//"15_Camera -bench-particles" measures how many particles a millisecond of update gets through
+	if (argc > 1 && std::string(args[1]) == "-bench-particles")
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, SDL_GetError(), "SDL GL Create Context failed", NULL);
-		SDL_DestroyWindow(window);
-		SDL_Quit();
-		return 1;
+		return runParticleBenchmark();
+	}
+
+	//"15_Camera -bench-physics" compares Bullet's step time across thread counts on the JobSystem and OpenMP
+	if (argc > 1 && std::string(args[1]) == "-bench-physics")
+	{
+		return runPhysicsBenchmark();
+	}
+
+	//"15_Camera -bench-textures Tank1DF.png armoredrecon_diff.png" compares texture memory and sampling cost with and without mips and DXT
+	if (argc > 1 && std::string(args[1]) == "-bench-textures")
+	{
+		return runTextureBenchmark(argc - 2, args + 2);
+	}
+
+	//"15_Camera -headless -frames 600 -capture 120 -report frames.csv -trace profile.json" renders the scene offscreen along a scripted camera
+	//path with no visible window or input, then prints frame time statistics. Needs a display, on a Linux server Xvfb will do
+	HeadlessBenchmarkSettings headlessSettings;
+	bool headless = parseHeadlessBenchmarkSettings(argc, args, headlessSettings);
+
+	SDL_Window* window = nullptr;
+	SDL_GLContext GL_Context = nullptr;
+	HeadlessContext headlessContext;
+	if (headless)
+	{
+		//Only for the timers, the headless context starts video itself
+		SDL_Init(SDL_INIT_TIMER);
+		if (!headlessContext.create())
+		{
+			SDL_Quit();
+			return 1;
+		}
+	}
+	else
+	{
+		//Initialises the SDL Library, passing in SDL_INIT_VIDEO to only initialise the video subsystems
+		//https://wiki.libsdl.org/SDL_Init
+		if (SDL_Init(SDL_INIT_VIDEO) < 0)
+		{
+			//Display an error message box
+			//https://wiki.libsdl.org/SDL_ShowSimpleMessageBox
+			SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, SDL_GetError(), "SDL_Init failed", NULL);
+			return 1;
+		}
+
+		//Create an SDL2 Window
+		//https://wiki.libsdl.org/SDL_CreateWindow
+		window = SDL_CreateWindow("SDL2 Window", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 800, 640, SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
+		//Checks to see if the window has been created, the pointer will have a value of some kind
+		if (window == nullptr)
+		{
+			//Shows error if creation of Window Fails
+			SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, SDL_GetError(), "SDL_CreateWindow failed", NULL);
+			//Close the SDL Library
+			//https://wiki.libsdl.org/SDL_Quit
+			SDL_Quit();
+			return 1;
+		}
+
+		//Gets 3.2 version of OPENGL
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+
+		//SDL Context/Window is created here
+		GL_Context = SDL_GL_CreateContext(window);
+		if (GL_Context == nullptr)
+		{
+			SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, SDL_GetError(), "SDL GL Create Context failed", NULL);
+			SDL_DestroyWindow(window);
+			SDL_Quit();
+			return 1;
+		}
 	}
 	
 	//Initialize GLEW
@@ -78,6 +144,50 @@ int main(int argc, char* args[])
 	vec4 diffuseLightColour = vec4(2.0f, 2.0f, 2.0f, 2.0f);
 	vec4 specularLightColour = vec4(2.0f, 2.0f, 2.0f, 2.0f);
 
+	//Point lights drifting in circles over the trees, each keeps the centre of its circle and a phase in pointLightOrbits
+	std::vector<PointLight> pointLights;
+	std::vector<vec4> pointLightOrbits;
+	srand(42);
+	for (int i = 0; i < 256; i++)
+	{
+		PointLight light;
+		light.position = vec3(rand() % 114 - 57.0f, -6.0f + (rand() % 40) / 10.0f, rand() % 114 - 57.0f);
+		light.radius = 8.0f;
+		light.colour = normalize(vec3(rand() % 100 + 10, rand() % 100 + 10, rand() % 100 + 10));
+		light.intensity = 6.0f;
+		pointLights.push_back(light);
+		pointLightOrbits.push_back(vec4(light.position, (rand() % 628) / 100.0f));
+	}
+	bool pointLightsEnabled = true;
+	float pointLightTime = 0.0f;
+
+	//Textures are decoded on worker threads from here on, objects show a placeholder until theirs is uploaded
+	AsyncTextureLoader::get().init();
+
+	//Programs are shared and cached as binaries from here on, and rebuilt when their .glsl files are saved
+	ShaderLibrary::get().init();
+
+	//Every frame is profiled from here on, F1 writes the last few seconds out as a Chrome trace and F2 pauses profiling
+	Profiler::get().init();
+	Profiler::get().setThreadName("Main");
+
+	//One worker per spare core runs the frame's jobs, and Bullet's parallel loops go through the same workers
+	JobSystem::get().init();
+	JobTaskScheduler jobTaskScheduler;
+	btSetTaskScheduler(&jobTaskScheduler);
+
+	//Shared buffer for the PerFrame uniform block
+	UniformBuffer perFrameBuffer;
+	perFrameBuffer.init(sizeof(PerFrameUniforms), PER_FRAME_BINDING_POINT);
+
+	//Collects and sorts the frame's draws, then the renderer draws them with as few state changes as possible
+	FrustumCuller frustumCuller;
+	LightCuller lightCuller;
+	lightCuller.init();
+	RenderQueue renderQueue;
+	InstancedRenderer instancedRenderer;
+	instancedRenderer.init();
+
 #pragma endregion 
 	
 #pragma region "GameObjects"	
@@ -101,61 +211,84 @@ int main(int argc, char* args[])
 	Tank1->setRotation(vec3(0.0f, 1.6f, 0.0f));
 	gameObjectList.push_back(Tank1);
 
+	//Scenery that never needs a hierarchy or per object code lives in the entity store's packed arrays instead
+	EntityStore entityStore;
+	for (int x = 0; x < 20; x++)
+	{
+		for (int z = 0; z < 20; z++)
+		{
+			Entity tree = entityStore.createEntity(vec3(x * 6.0f - 57.0f, -8.0f, z * 6.0f - 57.0f));
+			entityStore.addRenderable(tree, AssetCache::get().acquireMeshes("lowpolytree.fbx"),
+				AssetCache::get().acquireShaderProgram("lightingVert.glsl", "lightingFrag.glsl"), 0);
+			entityStore.addMaterial(tree, vec4(0.1f, 0.4f, 0.1f, 1.0f), vec4(0.2f, 0.6f, 0.2f, 1.0f), vec4(0.1f, 0.1f, 0.1f, 1.0f), 5.0f);
+		}
+	}
+
+	//Snow drifting down over the whole tree field
+	ParticleSettings snowSettings = {};
+	snowSettings.maxParticles = 100000;
+	snowSettings.emissionRate = 10000.0f;
+	snowSettings.minLifetime = 8.0f;
+	snowSettings.maxLifetime = 10.0f;
+	snowSettings.minSpeed = 1.0f;
+	snowSettings.maxSpeed = 2.0f;
+	snowSettings.acceleration = vec3(0.2f, 0.0f, 0.0f);
+	snowSettings.startSize = 0.05f;
+	snowSettings.endSize = 0.05f;
+	snowSettings.startColour = vec4(1.0f, 1.0f, 1.0f, 0.8f);
+	snowSettings.endColour = vec4(1.0f, 1.0f, 1.0f, 0.0f);
+	CubeEmitter snowEmitter;
+	snowEmitter.init(snowSettings);
+	snowEmitter.setPosition(vec3(0.0f, 10.0f, 0.0f));
+	snowEmitter.setHalfExtents(vec3(57.0f, 1.0f, 57.0f));
+	snowEmitter.setDirection(vec3(0.0f, -1.0f, 0.0f), 0.3f);
+
+	//Sparks fountaining up beside the tanks and falling back down
+	ParticleSettings sparkSettings = {};
+	sparkSettings.maxParticles = 50000;
+	sparkSettings.emissionRate = 15000.0f;
+	sparkSettings.minLifetime = 1.5f;
+	sparkSettings.maxLifetime = 3.0f;
+	sparkSettings.minSpeed = 6.0f;
+	sparkSettings.maxSpeed = 9.0f;
+	sparkSettings.acceleration = vec3(0.0f, -9.81f, 0.0f);
+	sparkSettings.startSize = 0.08f;
+	sparkSettings.endSize = 0.02f;
+	sparkSettings.startColour = vec4(1.0f, 0.8f, 0.3f, 1.0f);
+	sparkSettings.endColour = vec4(1.0f, 0.1f, 0.0f, 0.0f);
+	SphereEmitter sparkEmitter;
+	sparkEmitter.init(sparkSettings);
+	sparkEmitter.setPosition(vec3(10.0f, -8.0f, 10.0f));
+	sparkEmitter.setRadius(0.3f);
+	sparkEmitter.setHemisphere(true);
+
 
 
 #pragma endregion	
 	
 #pragma region Buffer and Screen Declerations
-	//Colour Buffer Texture
-	GLuint colourBufferID = createTexture(800, 640);
-
-	//Create Depth Buffer
-	GLuint depthRenderBufferID;
-	glGenRenderbuffers(1, &depthRenderBufferID);
-	glBindRenderbuffer(GL_RENDERBUFFER, depthRenderBufferID);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, 800, 640);
-
-	//Create Framebuffer
-	GLuint frameBufferID;
-	glGenFramebuffers(1, &frameBufferID);
-	glBindFramebuffer(GL_FRAMEBUFFER, frameBufferID);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderBufferID);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colourBufferID, 0);
-
-	//Error checking for Frame Buffer for PP
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	//The scene is drawn offscreen and run through the post processing passes on its way to the window.
+	//Bloom works at half and quarter resolution, black and white is off until toggled with B
+	PostProcessChain postProcessChain;
+	if (!postProcessChain.init(800, 640))
 	{
 		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Unable to create frame buffer for post processing", "Frame Buffer Error", NULL);
 	}
-
-	//Create Screen Sized Texture for Post Processing 
-	GLfloat screenVerts[] =
+	postProcessChain.addPass("bloomBrightPass", "passThroughVert.glsl", "postBrightPassFrag.glsl", 2);
+	postProcessChain.addPass("bloomBlurHorizontal", "passThroughVert.glsl", "postBlurFrag.glsl", 4, false, "#define HORIZONTAL\n");
+	postProcessChain.addPass("bloomBlurVertical", "passThroughVert.glsl", "postBlurFrag.glsl", 4);
+	postProcessChain.addPass("bloomCombine", "passThroughVert.glsl", "postBloomCombineFrag.glsl", 1, true);
+	postProcessChain.addPass("blackAndWhite", "passThroughVert.glsl", "postBlackAndWhite.glsl");
+	postProcessChain.setPassEnabled("blackAndWhite", false);
+
+	//Headless contexts have no back buffer, the chain finishes in a target of its own that captures are read from
+	RenderTargetPool headlessTargets;
+	RenderTarget * pHeadlessOutput = nullptr;
+	if (headless)
 	{
-		-1, -1,
-		1, -1,
-		-1, 1,
-		1, 1
-	};
-
-	//Creates Screen Quad for PP
-	GLuint screenQuadVBOID;
-	glGenBuffers(1, &screenQuadVBOID);
-	glBindBuffer(GL_ARRAY_BUFFER, screenQuadVBOID);
-	glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(GLfloat), screenVerts, GL_STATIC_DRAW);
-
-	//Creates Vertex Array for PP
-	GLuint screenVAO;
-	glGenVertexArrays(1, &screenVAO);
-	glBindVertexArray(screenVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, screenQuadVBOID);
-
-	//Enable Vertex Array
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
-
-	//Loads Post Proccesing Shaders and Texture it is loaded onto 
-	GLuint postProcessingProgramID = LoadShaders("passThroughVert.glsl", "postBlackAndWhite.glsl");
-	GLint texture0Location = glGetUniformLocation(postProcessingProgramID, "texture0");
+		pHeadlessOutput = headlessTargets.acquire(800, 640);
+		postProcessChain.setOutputFrameBuffer(pHeadlessOutput->frameBufferID);
+	}
 #pragma endregion	
 #pragma region Physics
 
@@ -164,16 +297,24 @@ int main(int argc, char* args[])
 	///collision configuration contains default setup for memory, collision setup. Advanced users can create their own configuration.
 	btDefaultCollisionConfiguration* collisionConfiguration = new btDefaultCollisionConfiguration();
 
-	///use the default collision dispatcher. For parallel processing you can use a diffent dispatcher (see Extras/BulletMultiThreaded)
-	btCollisionDispatcher* dispatcher = new btCollisionDispatcher(collisionConfiguration);
-
 	///btDbvtBroadphase is a good general purpose broadphase. You can also try out btAxis3Sweep.
 	btBroadphaseInterface* overlappingPairCache = new btDbvtBroadphase();
 
+#if BT_THREADSAFE
+	//A thread safe Bullet runs the narrowphase, island solving and integration as parallel loops on the JobSystem.
+	//None of the project's configurations define it, see JobTaskScheduler.h
+	btCollisionDispatcher* dispatcher = new btCollisionDispatcherMt(collisionConfiguration);
+	btConstraintSolver* solver = new btConstraintSolverPoolMt(JobSystem::get().getThreadCount());
+	btDiscreteDynamicsWorld* dynamicsWorld = new btDiscreteDynamicsWorldMt(dispatcher, overlappingPairCache, (btConstraintSolverPoolMt*)solver, collisionConfiguration);
+#else
+	///use the default collision dispatcher. For parallel processing you can use a diffent dispatcher (see Extras/BulletMultiThreaded)
+	btCollisionDispatcher* dispatcher = new btCollisionDispatcher(collisionConfiguration);
+
 	///the default constraint solver. For parallel processing you can use a different solver (see Extras/BulletMultiThreaded)
-	btSequentialImpulseConstraintSolver* solver = new btSequentialImpulseConstraintSolver;
+	btConstraintSolver* solver = new btSequentialImpulseConstraintSolver;
 
 	btDiscreteDynamicsWorld* dynamicsWorld = new btDiscreteDynamicsWorld(dispatcher, overlappingPairCache, solver, collisionConfiguration);
+#endif
 
 	//Sets 
 	dynamicsWorld->setGravity(btVector3(0, -2, 0));
@@ -199,8 +340,20 @@ int main(int argc, char* args[])
 	//add the body to the dynamics world, dynamicworld holds all the simulations
 	dynamicsWorld->addRigidBody(GroundRigidbody);
 
-	//Creates Hitbox for Car
-	btCollisionShape* carCollisionShape = new btBoxShape(btVector3(2, 2, 2));
+	//Collision shapes come from the same models that are drawn, a hull for the car and the exact triangles for the static tank.
+	//Shapes made by a CollisionMesh belong to it, only the fallback box is handed to the car to delete
+	CollisionMesh carCollisionMesh;
+	btCollisionShape* carCollisionShape = nullptr;
+	btCollisionShape* carFallbackShape = nullptr;
+	if (carCollisionMesh.load(pCar->getMeshFilename()))
+	{
+		carCollisionShape = carCollisionMesh.createConvexHullShape(pCar->getScale());
+	}
+	if (carCollisionShape == nullptr)
+	{
+		carFallbackShape = new btBoxShape(btVector3(2, 2, 2));
+		carCollisionShape = carFallbackShape;
+	}
 
 	//Sets car position to current Model position for Physics 
 	glm::vec3 carPosition = pCar->getPosition();
@@ -216,7 +369,8 @@ int main(int argc, char* args[])
 	carCollisionShape->calculateLocalInertia(carMass, carInertia);
 
 	//using motionstate is recommended, it provides interpolation capabilities, and only synchronizes 'active' objects
-	btDefaultMotionState* carMotionState = new btDefaultMotionState(carTransform);
+	//The car's motion state writes straight into its model matrix whenever Bullet moves it
+	GameObjectMotionState* carMotionState = new GameObjectMotionState(pCar, carTransform);
 	btRigidBody::btRigidBodyConstructionInfo carRbInfo(carMass, carMotionState, carCollisionShape, carInertia);
 	btRigidBody* carRigidbody = new btRigidBody(carRbInfo);
 	carRigidbody->setActivationState(DISABLE_DEACTIVATION);
@@ -224,10 +378,29 @@ int main(int argc, char* args[])
 	//Adds Car Ridgidbody to Dynamicworld 
 	dynamicsWorld->addRigidBody(carRigidbody);
 
+	//Tank1 never moves, so it can use its full triangle mesh with the BVH cooked next to the model
+	CollisionMesh tankCollisionMesh;
+	btRigidBody* tankRigidbody = nullptr;
+	if (tankCollisionMesh.load(Tank1->getMeshFilename()))
+	{
+		btCollisionShape* tankCollisionShape = tankCollisionMesh.createTriangleMeshShape(Tank1->getScale());
+		glm::vec3 tankPosition = Tank1->getPosition();
+		glm::quat tankOrientation = Tank1->getOrientation();
+
+		btTransform tankTransform;
+		tankTransform.setIdentity();
+		tankTransform.setOrigin(btVector3(tankPosition.x, tankPosition.y, tankPosition.z));
+		tankTransform.setRotation(btQuaternion(tankOrientation.x, tankOrientation.y, tankOrientation.z, tankOrientation.w));
+
+		btRigidBody::btRigidBodyConstructionInfo tankRbInfo(0.0f, new btDefaultMotionState(tankTransform), tankCollisionShape, btVector3(0, 0, 0));
+		tankRigidbody = new btRigidBody(tankRbInfo);
+		dynamicsWorld->addRigidBody(tankRigidbody);
+	}
+
 	//Sets Impulse Direction 
 	int InvertGravity = -10;
 	pCar->SetRigidbody(carRigidbody);
-	pCar->SetCollision(carCollisionShape);
+	pCar->SetCollision(carFallbackShape);
 
 	
 	
@@ -268,13 +441,51 @@ int main(int argc, char* args[])
 #pragma endregion
 	
 	//Locks cursor to OPENGL screen 
-	SDL_SetRelativeMouseMode(SDL_bool(SDL_ENABLE));
+	if (!headless)
+	{
+		SDL_SetRelativeMouseMode(SDL_bool(SDL_ENABLE));
+	}
 
 	
 	
 	//Timing Declarations
-	int lastTicks = SDL_GetTicks();
+	//Physics runs at a fixed 60Hz whatever the frame rate, the limiter stops us rendering frames nobody sees
+	FrameTimer frameTimer;
+	frameTimer.init(1.0f / 60.0f, 4);
+	int frameRateLimit = 144;
+	frameTimer.setFrameRateLimit(frameRateLimit);
+	dynamicsWorld->setLatencyMotionStateInterpolation(true);
 	int currentTicks = SDL_GetTicks();
+	int lastStatsTicks = SDL_GetTicks();
+	int physicsSteps = 0;
+
+	//Headless runs follow a camera path instead of input, by default a slow orbit of the tanks with the trees behind them.
+	//They always simulate one fixed step per frame so every run computes the same frames whatever the machine's speed
+	CameraPath cameraPath;
+	FrameReport frameReport;
+	int headlessFrame = 0;
+	if (headless)
+	{
+		if (headlessSettings.cameraPathFilename.empty() || !cameraPath.loadFromFile(headlessSettings.cameraPathFilename))
+		{
+			for (int i = 0; i <= 8; i++)
+			{
+				float angle = radians(i * 45.0f);
+				cameraPath.addKeyframe(i * 1.25f, vec3(cos(angle) * 30.0f, 6.0f + 4.0f * sin(angle * 2.0f), sin(angle) * 30.0f), vec3(0.0f, -4.0f, 0.0f));
+			}
+		}
+
+		frameRateLimit = 0;
+		frameTimer.setFrameRateLimit(frameRateLimit);
+
+		//Nothing is measured until every texture is in, otherwise the first frames draw placeholders
+		while (AsyncTextureLoader::get().getPendingCount() > 0)
+		{
+			AsyncTextureLoader::get().update();
+			SDL_Delay(1);
+		}
+		printf("Headless benchmark on %s, %s\n", headlessContext.getBackendName(), (const char*)glGetString(GL_RENDERER));
+	}
 
 
 	//Event loop, we will loop until running is set to false, usually if escape has been pressed or window is closed
@@ -283,9 +494,12 @@ int main(int argc, char* args[])
 	SDL_Event ev;
 	while (running)
 	{
+		Uint64 frameStart = SDL_GetPerformanceCounter();
+		Profiler::get().beginFrame();
+
 		//Poll for the events which have happened in this frame
 		//https://wiki.libsdl.org/SDL_PollEvent
-		while (SDL_PollEvent(&ev))
+		while (!headless && SDL_PollEvent(&ev))
 		{
 			//Switch case for every message we are intereted in
 			switch (ev.type)
@@ -362,7 +576,13 @@ int main(int argc, char* args[])
 					break;
 					
 
-					//Changes post proccesing effects 
+				case SDLK_l:
+					//Toggles the frame rate limiter
+					frameRateLimit = frameRateLimit == 0 ? 144 : 0;
+					frameTimer.setFrameRateLimit(frameRateLimit);
+					break;
+
+					//Changes post proccesing effects, the program being swapped out is released and comes back from the binary cache next time
 				case SDLK_p:
 					pCar->loadShaderProgram("passThroughVert.glsl", "postBlackAndWhite.glsl");
 					break;
@@ -372,6 +592,38 @@ int main(int argc, char* args[])
 					pCar->loadShaderProgram("textureVert.glsl", "textureFrag.glsl");
 					break;
 
+				//Writes the profiler history out, open it in chrome://tracing or ui.perfetto.dev
+				case SDLK_F1:
+					printf("Worst frame in the trace %.2fms\n", Profiler::get().getWorstFrameMilliseconds());
+					Profiler::get().exportChromeTrace("profile.json");
+					break;
+
+				//Pauses and resumes profiling, the trace keeps whatever was recorded before the pause
+				case SDLK_F2:
+					Profiler::get().setEnabled(!Profiler::get().isEnabled());
+					printf("Profiling %s\n", Profiler::get().isEnabled() ? "on" : "off");
+					break;
+
+				//Toggles the point lights, the directional light stays on
+				case SDLK_k:
+					pointLightsEnabled = !pointLightsEnabled;
+					break;
+
+				//Toggles the bloom passes and the black and white pass
+				case SDLK_b:
+					postProcessChain.setPassEnabled("blackAndWhite", !postProcessChain.isPassEnabled("blackAndWhite"));
+					break;
+
+				case SDLK_n:
+				{
+					bool bloom = !postProcessChain.isPassEnabled("bloomBrightPass");
+					postProcessChain.setPassEnabled("bloomBrightPass", bloom);
+					postProcessChain.setPassEnabled("bloomBlurHorizontal", bloom);
+					postProcessChain.setPassEnabled("bloomBlurVertical", bloom);
+					postProcessChain.setPassEnabled("bloomCombine", bloom);
+					break;
+				}
+
 				case SDLK_LCTRL:
 					//Raycast Controls
 					glm::vec3 out_direction = cameraTarget - cameraPosition;
@@ -408,68 +660,231 @@ int main(int argc, char* args[])
 		}
 
 		//Gets Tick and Steps through simulation
+		//Bullet accumulates the clamped frame time, runs however many fixed steps are due and
+		//interpolates the motion states between the last two steps for rendering
+		frameTimer.beginFrame();
 		currentTicks = SDL_GetTicks();
-		float deltaTime = (float)(currentTicks - lastTicks) / 1000.0f;
-		dynamicsWorld->stepSimulation(1.f / 60.f, 10);
+		float deltaTime = headless ? frameTimer.getFixedTimeStep() : frameTimer.getDeltaTime();
+
+		if (headless)
+		{
+			cameraPath.evaluate(headlessFrame * frameTimer.getFixedTimeStep(), cameraPosition, cameraTarget);
+		}
 
 		//Sets View Matrix
 		viewMatrix = lookAt(cameraPosition, cameraTarget, cameraUp);
 
-		//Iterates through game objects in the list then updates the render command 
-		for (GameObject * pObj : gameObjectList)
+		//The lights only depend on the camera, so they're binned on the workers while this thread gets on with
+		//physics, uploads and the scene update, and picked up just before drawing
+		pointLightTime += deltaTime;
+		for (unsigned int i = 0; i < pointLights.size(); i++)
+		{
+			float angle = pointLightTime * 0.5f + pointLightOrbits[i].w;
+			pointLights[i].position = vec3(pointLightOrbits[i]) + vec3(cos(angle), 0.0f, sin(angle)) * 3.0f;
+		}
+		static const std::vector<PointLight> noPointLights;
+		lightCuller.setProjection(projectionMatrix, 800, 640);
+		lightCuller.beginCull(pointLightsEnabled ? pointLights : noPointLights, viewMatrix);
+
+		{
+			//Bullet's own zones show up nested inside this one
+			PROFILE_SCOPE("Physics");
+			physicsSteps += dynamicsWorld->stepSimulation(deltaTime, frameTimer.getMaxSubSteps(), frameTimer.getFixedTimeStep());
+		}
+
+		{
+			//Uploads any textures that finished decoding since the last frame
+			PROFILE_SCOPE("Texture uploads");
+			AsyncTextureLoader::get().update();
+		}
+
+		{
+			//Swaps in any shaders that were edited and have finished rebuilding
+			PROFILE_SCOPE("Shader reloads");
+			ShaderLibrary::get().update();
+		}
+
+		{
+			PROFILE_SCOPE("Update objects");
+
+			//Iterates through game objects in the list then updates the render command 
+			JobSystem::get().parallelFor(0, (unsigned int)gameObjectList.size(), GAME_OBJECT_JOB_GRAIN, [&gameObjectList](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int i = begin; i < end; i++)
+				{
+					gameObjectList[i]->update();
+				}
+			});
+
+			//Propagates the changed transforms down the hierarchy, then objects that moved refresh their bounds
+			TransformHierarchy::get().update();
+			JobSystem::get().parallelFor(0, (unsigned int)gameObjectList.size(), GAME_OBJECT_JOB_GRAIN, [&gameObjectList](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int i = begin; i < end; i++)
+				{
+					gameObjectList[i]->syncWorldTransform();
+				}
+			});
+			entityStore.update();
+		}
+
 		{
-			pObj->update();
+			PROFILE_SCOPE("Particles");
+			snowEmitter.update(deltaTime);
+			sparkEmitter.update(deltaTime);
 		}
 	
+		//Everything from the clear to the last scene draw is timed on the GPU as one pass, which
+		//has to be closed before the post process passes time themselves
+		bool sceneGpuZone = Profiler::get().beginGpuZone("Scene");
+
 		//Enables Depth Test and backface culling to save on processing 
 		glEnable(GL_DEPTH_TEST);
 		glEnable(GL_CULL_FACE);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		postProcessChain.beginScene();
 		
 		//Changes Background Colour
 		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 		glClearDepth(1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		//Passes through GameObject list and renders each of them 
-		for (GameObject * pObj : gameObjectList)
+		//Uploads the point lights binned into view space clusters, the scene shaders look up the lights for each pixel's cluster
+		lightCuller.finishCull();
+
+		//Camera and light state is the same for every object, so upload it once per frame
+		PerFrameUniforms perFrame;
+		perFrame.viewMatrix = viewMatrix;
+		perFrame.projectionMatrix = projectionMatrix;
+		perFrame.cameraPosition = vec4(cameraPosition, 1.0f);
+		perFrame.lightDirection = vec4(lightDirection, 0.0f);
+		perFrame.ambientLightColour = ambientLightColour;
+		perFrame.diffuseLightColour = diffuseLightColour;
+		perFrame.specularLightColour = specularLightColour;
+		perFrame.clusterParameters = lightCuller.getClusterParameters();
+		perFrameBuffer.update(&perFrame, sizeof(PerFrameUniforms));
+
+		//Passes through GameObject list, sorts the draws by state and batches objects sharing a mesh, program and texture into instanced draws
+		//Objects whose bounds are completely outside the view frustum are never submitted
+		unsigned int firstEntityCullIndex;
+		{
+			PROFILE_SCOPE("Cull");
+			frustumCuller.begin(projectionMatrix * viewMatrix);
+			for (GameObject * pObj : gameObjectList)
+			{
+				frustumCuller.addSphere(pObj->getWorldBoundingSphere());
+			}
+			firstEntityCullIndex = entityStore.addToCuller(frustumCuller);
+			frustumCuller.cull();
+		}
+
+		{
+			PROFILE_SCOPE("Submit");
+			renderQueue.begin(viewMatrix, projectionMatrix, 100.0f);
+			for (unsigned int i = 0; i < gameObjectList.size(); i++)
+			{
+				if (frustumCuller.isVisible(i))
+				{
+					renderQueue.submit(gameObjectList[i]);
+				}
+			}
+			entityStore.submit(renderQueue, frustumCuller, firstEntityCullIndex);
+			renderQueue.sort();
+		}
+
+		{
+			PROFILE_SCOPE("Render");
+			lightCuller.bind();
+			instancedRenderer.render(renderQueue);
+		}
+
+		{
+			//Blended on top of the opaque scene, one instanced draw per emitter
+			PROFILE_SCOPE("Render particles");
+			snowEmitter.render();
+			sparkEmitter.render();
+		}
+		if (sceneGpuZone)
 		{
-			pObj->preRender();
-			GLuint currentProgramID = pObj->getShaderProgramID();
-
-			//retrieve the shader values
-			GLint viewMatrixLocation = glGetUniformLocation(currentProgramID, "viewMatrix");
-			GLint projectionMatrixLocation = glGetUniformLocation(currentProgramID, "projectionMatrix");
-			GLint lightDirectionLocation = glGetUniformLocation(currentProgramID, "lightDirection");
-			GLint ambientLightColourLocation = glGetUniformLocation(currentProgramID, "ambientLightColour");
-			GLint diffuseLightColourLocation = glGetUniformLocation(currentProgramID, "diffuseLightColour");
-			GLint specularLightColourLocation = glGetUniformLocation(currentProgramID, "specularLightColour");
-
-			//send shader values
-			glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, value_ptr(viewMatrix));
-			glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, value_ptr(projectionMatrix));
-
-			glUniform3fv(lightDirectionLocation, 1, value_ptr(lightDirection));
-			glUniform4fv(ambientLightColourLocation, 1, value_ptr(ambientLightColour));
-			glUniform4fv(diffuseLightColourLocation, 1, value_ptr(diffuseLightColour));
-			glUniform4fv(specularLightColourLocation, 1, value_ptr(specularLightColour));
-
-			pObj->render();
+			Profiler::get().endGpuZone();
 		}
 
+		//Runs the enabled post processing passes into the back buffer
+		postProcessChain.render();
+
+
+		if (headless)
+		{
+			//CPU time is everything up to handing the last command over, frame time also waits for the GPU to draw it
+			const RenderStats& stats = instancedRenderer.getStats();
+			FrameSample sample;
+			sample.cpuMilliseconds = (double)(SDL_GetPerformanceCounter() - frameStart) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+			glFinish();
+			sample.frameMilliseconds = (double)(SDL_GetPerformanceCounter() - frameStart) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+			sample.drawCalls = stats.drawCalls;
+			sample.instances = stats.instances;
+			sample.triangles = stats.triangles;
+			sample.fullDetailTriangles = stats.fullDetailTriangles;
+
+			int recordedFrame = headlessFrame - headlessSettings.warmupFrames;
+			if (recordedFrame >= 0)
+			{
+				frameReport.addFrame(sample);
+				if (headlessSettings.captureInterval > 0 && recordedFrame % headlessSettings.captureInterval == 0)
+				{
+					char captureFilename[64];
+					snprintf(captureFilename, sizeof(captureFilename), "capture_%04d.png", recordedFrame);
+					glBindFramebuffer(GL_READ_FRAMEBUFFER, pHeadlessOutput->frameBufferID);
+					saveFrameBufferToPNG(captureFilename, pHeadlessOutput->width, pHeadlessOutput->height);
+				}
+			}
 
-		//Swaps Window for next rendered window 
-		SDL_GL_SwapWindow(window);
+			headlessFrame++;
+			running = headlessFrame < headlessSettings.warmupFrames + headlessSettings.frames;
+		}
+		else
+		{
+			//Swaps Window for next rendered window 
+			PROFILE_SCOPE("Swap");
+			SDL_GL_SwapWindow(window);
+		}
 		
-		//Updated Last tick to current ticks 
-		lastTicks = currentTicks;
+		//Shows last frame's render counters in the title bar once a second
+		if (!headless && currentTicks - lastStatsTicks >= 1000)
+		{
+			const RenderStats& stats = instancedRenderer.getStats();
+			char title[256];
+			snprintf(title, sizeof(title), "SDL2 Window - %.2fms physics steps %d draws %u instances %u triangles %u (%u without LODs) culled %u lights %u particles %u program switches %u texture switches %u VAO switches %u",
+				frameTimer.getFrameTimeMilliseconds(), physicsSteps, stats.drawCalls, stats.instances, stats.triangles, stats.fullDetailTriangles, frustumCuller.getCulledCount(), lightCuller.getVisibleLightCount(),
+				snowEmitter.getParticleCount() + sparkEmitter.getParticleCount(),
+				stats.programSwitches, stats.textureSwitches, stats.vertexArraySwitches);
+			SDL_SetWindowTitle(window, title);
+			lastStatsTicks = currentTicks;
+			physicsSteps = 0;
+		}
+
+		//Sleeps off the rest of the frame if the limiter is on
+		frameTimer.endFrame();
+		Profiler::get().endFrame();
+	}
+	
+	if (headless)
+	{
+		frameReport.print((const char*)glGetString(GL_RENDERER));
+		if (!headlessSettings.reportFilename.empty())
+		{
+			frameReport.writeCSV(headlessSettings.reportFilename);
+		}
+		if (!headlessSettings.traceFilename.empty())
+		{
+			Profiler::get().exportChromeTrace(headlessSettings.traceFilename);
+		}
 	}
 	
 #pragma region "Delete"	
-	//Remove Rigidbodys from simulation
+	//Remove Rigidbodys from simulation before the GameObjects delete theirs, from the back as removing shuffles the array
 	int NoOfCollisionObjects=dynamicsWorld->getNumCollisionObjects();
 
-	for (int i = 0; i < NoOfCollisionObjects -1; i++)
+	for (int i = NoOfCollisionObjects - 1; i >= 0; i--)
 	{
 		btCollisionObject* obj = dynamicsWorld->getCollisionObjectArray()[i];
 		dynamicsWorld->removeCollisionObject(obj);
@@ -487,16 +902,32 @@ int main(int argc, char* args[])
 		}
 	}
 	
+	entityStore.clear();
+
+	//Anything the GameObjects didn't release is freed with the cache
+	AssetCache::get().clear();
+	GeometryArena::destroyAll();
+	AsyncTextureLoader::get().destroy();
+	TransformHierarchy::get().clear();
+	postProcessChain.destroy();
+	snowEmitter.destroy();
+	sparkEmitter.destroy();
+	Profiler::get().destroy();
+	headlessTargets.destroy();
+	ShaderLibrary::get().destroy();
+
 	//All the deleting goes on down here 
-	glDeleteProgram(postProcessingProgramID);
-	glDeleteVertexArrays(1, &screenVAO);
-	glDeleteBuffers(1, &screenQuadVBOID);
-	glDeleteFramebuffers(1, &frameBufferID);
-	glDeleteRenderbuffers(1, &depthRenderBufferID);
-	glDeleteTextures(1, &colourBufferID);
+	perFrameBuffer.destroy();
+	lightCuller.destroy();
+	instancedRenderer.destroy();
+	JobSystem::get().destroy();
 
 	//Deletes GL_CONTEXT/Window
-	SDL_GL_DeleteContext(GL_Context);
+	if (GL_Context != nullptr)
+	{
+		SDL_GL_DeleteContext(GL_Context);
+	}
+	headlessContext.destroy();
 	
 	// Delete Ground
 		delete groundShape;
@@ -506,6 +937,15 @@ int main(int argc, char* args[])
 	}
 	delete GroundRigidbody;
 
+	//Bodies go before the shapes they use, the car's body went with the car
+	if (tankRigidbody != nullptr)
+	{
+		delete tankRigidbody->getMotionState();
+		delete tankRigidbody;
+	}
+	tankCollisionMesh.destroy();
+	carCollisionMesh.destroy();
+
 	//delete solver
 	delete solver;
 
@@ -520,7 +960,10 @@ int main(int argc, char* args[])
 
 	//Destroy the window and quit SDL2
 	//https://wiki.libsdl.org/SDL_DestroyWindow
-	SDL_DestroyWindow(window);
+	if (window != nullptr)
+	{
+		SDL_DestroyWindow(window);
+	}
 	//https://wiki.libsdl.org/SDL_Quit
 	SDL_Quit();
 
@@ -15,9 +15,33 @@
 #include "vertex.h"
 #include "Model.h"
 #include "Shader.h"
+#include "ShaderProgram.h"
+#include "UniformBuffer.h"
 #include "Texture.h"
+#include "TextureCooker.h"
+#include "ShaderLibrary.h"
+#include "PostProcessChain.h"
+#include "HeadlessContext.h"
+#include "CameraPath.h"
+#include "Profiler.h"
 
+#include "AssetCache.h"
 #include "GameObject.h"
+#include "GameObjectMotionState.h"
+#include "FrustumCuller.h"
+#include "LightCuller.h"
+#include "RenderQueue.h"
+#include "InstancedRenderer.h"
+#include "FrameTimer.h"
+#include "EntityStore.h"
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "JobTaskScheduler.h"
+#include "CubeEmitter.h"
+#include "SphereEmitter.h"
+#include "CollisionCooker.h"
 
 #include <btBulletDynamicsCommon.h>
+#include <BulletDynamics\Dynamics\btDiscreteDynamicsWorldMt.h>
+#include <BulletCollision\CollisionDispatch\btCollisionDispatcherMt.h>
 using namespace glm;
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec4 vertexColourOut;
+in vec2 cornerOut;
+
+out vec4 colour;
+
+void main()
+{
+	//Round soft edged particle, fading out towards the rim of the quad
+	float falloff=clamp(1.0f-dot(cornerOut,cornerOut),0.0f,1.0f);
+	colour=vec4(vertexColourOut.rgb,vertexColourOut.a*falloff*falloff);
+}
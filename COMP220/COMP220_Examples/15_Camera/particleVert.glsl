@@ -0,0 +1,35 @@
+#version 330 core
+
+//Per instance data, streamed from the emitter's instance buffer
+layout(location=0) in vec4 instancePositionAndSize;
+layout(location=1) in vec4 instanceColour;
+
+//Camera and lighting, shared by every object and uploaded once per frame
+layout(std140) uniform PerFrame
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightDirection;
+	vec4 ambientLightColour;
+	vec4 diffuseLightColour;
+	vec4 specularLightColour;
+	vec4 clusterParameters;
+};
+
+out vec4 vertexColourOut;
+out vec2 cornerOut;
+
+void main()
+{
+	//Four vertices per instance make a strip, the corner is worked out from the vertex number
+	vec2 corner=vec2(float(gl_VertexID&1),float(gl_VertexID>>1))*2.0f-1.0f;
+
+	//Offset in view space so the quad always faces the camera
+	vec4 viewPosition=viewMatrix*vec4(instancePositionAndSize.xyz,1.0f);
+	viewPosition.xy+=corner*instancePositionAndSize.w;
+
+	gl_Position=projectionMatrix*viewPosition;
+	vertexColourOut=instanceColour;
+	cornerOut=corner;
+}
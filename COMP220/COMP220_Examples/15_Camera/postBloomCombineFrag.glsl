@@ -0,0 +1,18 @@
+#version 330 core
+
+in vec2 textureCoordsOut;
+
+out vec4 colour;
+
+//The blurred bright parts and the original scene
+uniform sampler2D texture0;
+uniform sampler2D texture1;
+
+const float bloomStrength=0.8f;
+
+void main()
+{
+	vec3 sceneColour=texture(texture1,textureCoordsOut).rgb;
+	vec3 bloomColour=texture(texture0,textureCoordsOut).rgb;
+	colour=vec4(sceneColour+bloomColour*bloomStrength,1.0f);
+}
@@ -0,0 +1,29 @@
+#version 330 core
+
+in vec2 textureCoordsOut;
+
+out vec4 colour;
+
+uniform sampler2D texture0;
+uniform vec2 texelSize;
+
+//9 tap gaussian done in 5 fetches by sampling between texels, built with HORIZONTAL defined for the first half of a separable blur
+const float offsets[3]=float[](0.0f,1.3846153846f,3.2307692308f);
+const float weights[3]=float[](0.2270270270f,0.3162162162f,0.0702702703f);
+
+void main()
+{
+#ifdef HORIZONTAL
+	vec2 direction=vec2(texelSize.x,0.0f);
+#else
+	vec2 direction=vec2(0.0f,texelSize.y);
+#endif
+
+	vec4 sum=texture(texture0,textureCoordsOut)*weights[0];
+	for (int i=1;i<3;i++)
+	{
+		sum+=texture(texture0,textureCoordsOut+direction*offsets[i])*weights[i];
+		sum+=texture(texture0,textureCoordsOut-direction*offsets[i])*weights[i];
+	}
+	colour=sum;
+}
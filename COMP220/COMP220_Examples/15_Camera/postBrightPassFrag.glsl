@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec2 textureCoordsOut;
+
+out vec4 colour;
+
+uniform sampler2D texture0;
+
+//Keeps only the parts of the image bright enough to bloom, fading in over a small range so edges don't flicker
+void main()
+{
+	vec4 textureColour=texture(texture0,textureCoordsOut);
+	float luminance=dot(textureColour.rgb,vec3(0.2126f,0.7152f,0.0722f));
+	colour=vec4(textureColour.rgb*smoothstep(0.6f,0.9f,luminance),1.0f);
+}
@@ -1,21 +1,41 @@
 #version 330 core
 
 layout(location=0) in vec3 vertexPosition;
+//Only meshes with a colour stream feed this attribute, everything else is white
+#ifdef HAS_VERTEX_COLOUR
 layout(location=1) in vec4 vertexColour;
+#else
+const vec4 vertexColour=vec4(1.0f,1.0f,1.0f,1.0f);
+#endif
 layout(location=2) in vec2 vertexTextureCoord;
 
+//Per instance data, streamed from the instance buffer
+layout(location=4) in mat4 instanceModelMatrix;
+layout(location=8) in vec4 instanceAmbientMaterialColour;
+layout(location=9) in vec4 instanceDiffuseMaterialColour;
+layout(location=10) in vec4 instanceSpecularMaterialColour;
+layout(location=11) in float instanceSpecularPower;
+
 uniform float time=0.0f;
 
-uniform mat4 modelMatrix=mat4(1.0f);
-uniform mat4 viewMatrix=mat4(1.0f);
-uniform mat4 projectionMatrix=mat4(1.0f);
+layout(std140) uniform PerFrame
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightDirection;
+	vec4 ambientLightColour;
+	vec4 diffuseLightColour;
+	vec4 specularLightColour;
+	vec4 clusterParameters;
+};
 
 out vec4 vertexColourOut;
 out vec2 vertexTextureCoordOut;
 
 void main()
 {
-	mat4 MVPMatrix=projectionMatrix*viewMatrix*modelMatrix;
+	mat4 MVPMatrix=projectionMatrix*viewMatrix*instanceModelMatrix;
 
 	gl_Position=MVPMatrix*vec4(vertexPosition,1.0f);
 	vertexColourOut=vertexColour;
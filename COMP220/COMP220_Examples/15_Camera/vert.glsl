@@ -6,8 +6,17 @@ layout(location=1) in vec4 vertexColour;
 uniform float time=0.0f;
 
 uniform mat4 modelMatrix=mat4(1.0f);
-uniform mat4 viewMatrix=mat4(1.0f);
-uniform mat4 projectionMatrix=mat4(1.0f);
+layout(std140) uniform PerFrame
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightDirection;
+	vec4 ambientLightColour;
+	vec4 diffuseLightColour;
+	vec4 specularLightColour;
+	vec4 clusterParameters;
+};
 
 out vec4 vertexColourOut;
 